@@ -30,9 +30,14 @@
 #include "vulkan/radv_shader_args.h"
 
 #include "util/memstream.h"
+#include "util/os_time.h"
 
+#include <algorithm>
 #include <array>
+#include <cinttypes>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <vector>
 
 static const std::array<aco_compiler_statistic_info, aco::num_statistics> statistic_infos = []()
@@ -63,6 +68,109 @@ static const std::array<aco_compiler_statistic_info, aco::num_statistics> statis
 const unsigned aco_num_statistics = aco::num_statistics;
 const aco_compiler_statistic_info* aco_statistic_infos = statistic_infos.data();
 
+namespace {
+
+typedef std::vector<std::pair<const char*, int64_t>> pass_times;
+
+static void
+add_pass_time(pass_times& times, const char* name, int64_t time)
+{
+   auto it = std::find_if(times.begin(), times.end(),
+                          [name](const auto& t) { return !strcmp(t.first, name); });
+   if (it == times.end())
+      times.emplace_back(name, time);
+   else
+      it->second += time;
+}
+
+/* ACO_DEBUG=passtime totals over every shader compiled by the process,
+ * printed once when it exits (or the driver is unloaded).
+ */
+class pass_time_totals {
+public:
+   ~pass_time_totals()
+   {
+      if (!num_shaders)
+         return;
+
+      fprintf(stderr, "ACO pass times over %u shaders:\n", num_shaders);
+      for (const auto& t : times)
+         fprintf(stderr, "    %s: %.3f ms\n", t.first, t.second / 1000000.0);
+      fprintf(stderr, "    instruction memory: %" PRIu64 " bytes\n", instruction_memory);
+   }
+
+   void add(const pass_times& shader_times, size_t memory)
+   {
+      std::lock_guard<std::mutex> guard(lock);
+
+      for (const auto& t : shader_times)
+         add_pass_time(times, t.first, t.second);
+      instruction_memory += memory;
+      num_shaders++;
+   }
+
+private:
+   std::mutex lock;
+   pass_times times;
+   uint64_t instruction_memory = 0;
+   unsigned num_shaders = 0;
+};
+
+pass_time_totals pass_totals;
+
+/* Per-pass compile time accounting for ACO_DEBUG=passtime/passtimereport.
+ * end() attributes the time since the previous end() to the named pass,
+ * report() adds the shader to the process totals or hands its times to the
+ * debug callback, for tools that collect them.
+ */
+class pass_timer {
+public:
+   pass_timer() : enabled(aco::debug_flags & (aco::DEBUG_PASS_TIME | aco::DEBUG_PASS_TIME_REPORT))
+   {
+      start = enabled ? os_time_get_nano() : 0;
+   }
+
+   void end(const char* name)
+   {
+      if (!enabled)
+         return;
+
+      int64_t now = os_time_get_nano();
+      add_pass_time(times, name, now - start);
+      start = now;
+   }
+
+   void report(aco::Program* program)
+   {
+      if (!enabled)
+         return;
+
+      size_t memory = program->m.allocated_size();
+
+      if (aco::debug_flags & aco::DEBUG_PASS_TIME)
+         pass_totals.add(times, memory);
+
+      /* Only through the callback: printing this for every shader would
+       * bury everything else.
+       */
+      if ((aco::debug_flags & aco::DEBUG_PASS_TIME_REPORT) && program->debug.func) {
+         std::string msg = "pass times:";
+         for (const auto& t : times)
+            msg += "\n    " + std::string(t.first) + ": " + std::to_string(t.second) + " ns";
+         msg += "\n    instruction memory: " + std::to_string(memory) + " bytes";
+         program->debug.func(program->debug.private_data, ACO_COMPILER_DEBUG_LEVEL_INFO,
+                             msg.c_str());
+      }
+   }
+
+private:
+   bool enabled;
+   int64_t start;
+   pass_times times;
+};
+
+} /* end namespace */
+
 static void
 validate(aco::Program* program)
 {
@@ -112,6 +220,7 @@ aco_compile_shader(const struct aco_compiler_options* options,
 {
    aco::init();
 
+   pass_timer timer;
    ac_shader_config config = {0};
    std::unique_ptr<aco::Program> program{new aco::Program};
 
@@ -129,6 +238,7 @@ aco_compile_shader(const struct aco_compiler_options* options,
       aco::select_trap_handler_shader(program.get(), shaders[0], &config, options, info, args);
    else
       aco::select_program(program.get(), shader_count, shaders, &config, options, info, args);
+   timer.end("isel");
    if (options->dump_preoptir)
       aco_print_program(program.get(), stderr);
 
@@ -136,25 +246,35 @@ aco_compile_shader(const struct aco_compiler_options* options,
    if (!args->is_trap_handler_shader) {
       /* Phi lowering */
       aco::lower_phis(program.get());
+      timer.end("lower_phis");
       aco::dominator_tree(program.get());
+      timer.end("dominator_tree");
       validate(program.get());
+      timer.end("validate");
 
       /* Optimization */
       if (!options->key.optimisations_disabled) {
          if (!(aco::debug_flags & aco::DEBUG_NO_VN))
             aco::value_numbering(program.get());
+         timer.end("value_numbering");
          if (!(aco::debug_flags & aco::DEBUG_NO_OPT))
             aco::optimize(program.get());
+         timer.end("optimize");
       }
 
       /* cleanup and exec mask handling */
       aco::setup_reduce_temp(program.get());
+      timer.end("setup_reduce_temp");
       aco::insert_exec_mask(program.get());
+      timer.end("insert_exec_mask");
       validate(program.get());
+      timer.end("validate");
 
       /* spilling and scheduling */
       live_vars = aco::live_var_analysis(program.get());
+      timer.end("live_var_analysis");
       aco::spill(program.get(), live_vars);
+      timer.end("spill");
    }
 
    std::string llvm_ir;
@@ -172,20 +292,25 @@ aco_compile_shader(const struct aco_compiler_options* options,
       llvm_ir = std::string(data, data + size);
       free(data);
    }
+   timer.end("record_ir");
 
    if (program->collect_statistics)
       aco::collect_presched_stats(program.get());
 
    if ((aco::debug_flags & aco::DEBUG_LIVE_INFO) && options->dump_shader)
       aco_print_program(program.get(), stderr, live_vars, aco::print_live_vars | aco::print_kill);
+   timer.end("statistics");
 
    if (!args->is_trap_handler_shader) {
       if (!options->key.optimisations_disabled && !(aco::debug_flags & aco::DEBUG_NO_SCHED))
          aco::schedule_program(program.get(), live_vars);
+      timer.end("schedule_program");
       validate(program.get());
+      timer.end("validate");
 
       /* Register Allocation */
       aco::register_allocation(program.get(), live_vars.live_out);
+      timer.end("register_allocation");
 
       if (aco::validate_ra(program.get())) {
          aco_print_program(program.get(), stderr);
@@ -195,35 +320,48 @@ aco_compile_shader(const struct aco_compiler_options* options,
       }
 
       validate(program.get());
+      timer.end("validate");
 
       /* Optimization */
       if (!options->key.optimisations_disabled && !(aco::debug_flags & aco::DEBUG_NO_OPT)) {
          aco::optimize_postRA(program.get());
+         timer.end("optimize_postRA");
          validate(program.get());
+         timer.end("validate");
       }
 
       aco::ssa_elimination(program.get());
+      timer.end("ssa_elimination");
    }
 
    /* Lower to HW Instructions */
    aco::lower_to_hw_instr(program.get());
+   timer.end("lower_to_hw_instr");
 
    /* Insert Waitcnt */
    aco::insert_wait_states(program.get());
+   timer.end("insert_wait_states");
    aco::insert_NOPs(program.get());
+   timer.end("insert_NOPs");
 
    if (program->gfx_level >= GFX10)
       aco::form_hard_clauses(program.get());
+   timer.end("form_hard_clauses");
 
    if (program->collect_statistics || (aco::debug_flags & aco::DEBUG_PERF_INFO))
       aco::collect_preasm_stats(program.get());
+   timer.end("statistics");
 
    /* Assembly */
    std::vector<uint32_t> code;
    unsigned exec_size = aco::emit_program(program.get(), code);
+   timer.end("emit_program");
 
    if (program->collect_statistics)
       aco::collect_postasm_stats(program.get(), code);
+   timer.end("statistics");
+
+   timer.report(program.get());
 
    bool get_disasm = options->dump_shader || options->record_ir;
 
@@ -32,6 +32,8 @@
 
 namespace aco {
 
+thread_local aco::monotonic_buffer_resource* instruction_buffer = nullptr;
+
 uint64_t debug_flags = 0;
 
 static const struct debug_control aco_debug_options[] = {{"validateir", DEBUG_VALIDATE_IR},
@@ -43,6 +45,8 @@ static const struct debug_control aco_debug_options[] = {{"validateir", DEBUG_VA
                                                          {"nosched", DEBUG_NO_SCHED},
                                                          {"perfinfo", DEBUG_PERF_INFO},
                                                          {"liveinfo", DEBUG_LIVE_INFO},
+                                                         {"passtime", DEBUG_PASS_TIME},
+                                                         {"passtimereport", DEBUG_PASS_TIME_REPORT},
                                                          {NULL, 0}};
 
 static once_flag init_once_flag = ONCE_FLAG_INIT;
@@ -53,6 +53,8 @@ enum {
    DEBUG_NO_SCHED = 0x40,
    DEBUG_PERF_INFO = 0x80,
    DEBUG_LIVE_INFO = 0x100,
+   DEBUG_PASS_TIME = 0x200,
+   DEBUG_PASS_TIME_REPORT = 0x400,
 };
 
 /**
@@ -1695,8 +1697,16 @@ struct Pseudo_reduction_instruction : public Instruction {
 static_assert(sizeof(Pseudo_reduction_instruction) == sizeof(Instruction) + 4,
               "Unexpected padding");
 
+/* Instructions are allocated from the arena of the Program which is currently
+ * being compiled on this thread and are freed all at once together with it.
+ */
+extern thread_local aco::monotonic_buffer_resource* instruction_buffer;
+
 struct instr_deleter_functor {
-   void operator()(void* p) { free(p); }
+   /* Don't yet free any instructions. They will be de-allocated
+    * all at once after compilation finished.
+    */
+   void operator()(void* p) { return; }
 };
 
 template <typename T> using aco_ptr = std::unique_ptr<T, instr_deleter_functor>;
@@ -1708,7 +1718,9 @@ create_instruction(aco_opcode opcode, Format format, uint32_t num_operands,
 {
    std::size_t size =
       sizeof(T) + num_operands * sizeof(Operand) + num_definitions * sizeof(Definition);
-   char* data = (char*)calloc(1, size);
+   assert(instruction_buffer);
+   char* data = (char*)instruction_buffer->allocate(size, alignof(T));
+   memset(data, 0, size);
    T* inst = (T*)data;
 
    inst->opcode = opcode;
@@ -2048,6 +2060,15 @@ enum class CompilationProgress {
 
 class Program final {
 public:
+   Program() { instruction_buffer = &m; }
+   ~Program()
+   {
+      if (instruction_buffer == &m)
+         instruction_buffer = nullptr;
+   }
+
+   /* Arena for all instructions of this program, see create_instruction(). */
+   aco::monotonic_buffer_resource m{65536};
    std::vector<Block> blocks;
    std::vector<RegClass> temp_rc = {s1};
    RegisterDemand max_reg_demand = RegisterDemand();
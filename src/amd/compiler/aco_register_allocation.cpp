@@ -70,12 +70,14 @@ struct ra_ctx {
 
    Program* program;
    Block* block = NULL;
+   /* backs the hash maps below, which are only ever added to */
+   aco::monotonic_buffer_resource memory;
    std::vector<assignment> assignments;
-   std::vector<std::unordered_map<unsigned, Temp>> renames;
+   std::vector<aco::unordered_map<unsigned, Temp>> renames;
    std::vector<uint32_t> loop_header;
-   std::unordered_map<unsigned, Temp> orig_names;
-   std::unordered_map<unsigned, Instruction*> vectors;
-   std::unordered_map<unsigned, Instruction*> split_vectors;
+   aco::unordered_map<unsigned, Temp> orig_names;
+   aco::unordered_map<unsigned, Instruction*> vectors;
+   aco::unordered_map<unsigned, Instruction*> split_vectors;
    aco_ptr<Instruction> pseudo_dummy;
    aco_ptr<Instruction> phi_dummy;
    uint16_t max_used_sgpr = 0;
@@ -89,7 +91,8 @@ struct ra_ctx {
 
    ra_ctx(Program* program_, ra_test_policy policy_)
        : program(program_), assignments(program->peekAllocationId()),
-         renames(program->blocks.size()), policy(policy_)
+         renames(program->blocks.size(), aco::unordered_map<unsigned, Temp>(memory)),
+         orig_names(memory), vectors(memory), split_vectors(memory), policy(policy_)
    {
       pseudo_dummy.reset(
          create_instruction<Instruction>(aco_opcode::p_parallelcopy, Format::PSEUDO, 0, 0));
@@ -2018,7 +2021,7 @@ get_reg_phi(ra_ctx& ctx, IDSet& live_in, RegisterFile& register_file,
       }
 
       /* rename */
-      std::unordered_map<unsigned, Temp>::iterator orig_it = ctx.orig_names.find(pc.first.tempId());
+      auto orig_it = ctx.orig_names.find(pc.first.tempId());
       Temp orig = pc.first.getTemp();
       if (orig_it != ctx.orig_names.end())
          orig = orig_it->second;
@@ -2136,7 +2139,7 @@ get_regs_for_phis(ra_ctx& ctx, Block& block, RegisterFile& register_file,
 Temp
 read_variable(ra_ctx& ctx, Temp val, unsigned block_idx)
 {
-   std::unordered_map<unsigned, Temp>::iterator it = ctx.renames[block_idx].find(val.id());
+   auto it = ctx.renames[block_idx].find(val.id());
    if (it == ctx.renames[block_idx].end())
       return val;
    else
@@ -2246,7 +2249,7 @@ handle_loop_phis(ra_ctx& ctx, const IDSet& live_in, uint32_t loop_header_idx,
          /* Find the original name, since this operand might not use the original name if the phi
           * was created after init_reg_file().
           */
-         std::unordered_map<unsigned, Temp>::iterator it = ctx.orig_names.find(op.tempId());
+         auto it = ctx.orig_names.find(op.tempId());
          Temp orig = it != ctx.orig_names.end() ? it->second : op.getTemp();
 
          op.setTemp(read_variable(ctx, orig, preds[j]));
@@ -2905,8 +2908,7 @@ register_allocation(Program* program, std::vector<IDSet>& live_out_per_block, ra
 
                /* it might happen that the operand is already renamed. we have to restore the
                 * original name. */
-               std::unordered_map<unsigned, Temp>::iterator it =
-                  ctx.orig_names.find(pc->operands[i].tempId());
+               auto it = ctx.orig_names.find(pc->operands[i].tempId());
                Temp orig = it != ctx.orig_names.end() ? it->second : pc->operands[i].getTemp();
                ctx.orig_names[pc->definitions[i].tempId()] = orig;
                ctx.renames[block.index][orig.id()] = pc->definitions[i].getTemp();
@@ -143,6 +143,7 @@ struct aco_shader_info {
 enum aco_compiler_debug_level {
    ACO_COMPILER_DEBUG_LEVEL_PERFWARN,
    ACO_COMPILER_DEBUG_LEVEL_ERROR,
+   ACO_COMPILER_DEBUG_LEVEL_INFO,
 };
 
 struct aco_stage_input {
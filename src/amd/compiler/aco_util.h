@@ -27,10 +27,16 @@
 #define ACO_UTIL_H
 
 #include "util/bitscan.h"
+#include "util/macros.h"
+#include "util/u_math.h"
 
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
+#include <functional>
 #include <iterator>
+#include <map>
+#include <unordered_map>
 #include <vector>
 
 namespace aco {
@@ -379,6 +385,148 @@ IDSet::Iterator::operator*() const
    return (word << 6) | bit;
 }
 
+/*
+ * Light-weight memory resource which hands out memory sequentially from a
+ * chain of growing buffers. Individual allocations are never freed: all
+ * memory is returned at once by release() or the destructor.
+ *
+ * This is meant for objects whose lifetime is bounded by a compilation, such
+ * as instructions or pass-local bookkeeping, where per-object malloc/free
+ * traffic is pure overhead. The resource is not thread-safe.
+ *
+ * The interface resembles a subset of std::pmr::monotonic_buffer_resource.
+ */
+class monotonic_buffer_resource final {
+public:
+   explicit monotonic_buffer_resource(size_t size = initial_size)
+   {
+      /* The size parameter refers to the total size of the first buffer,
+       * including its header.
+       */
+      size = MAX2(size, minimum_size);
+      buffer = (Buffer*)malloc(size);
+      buffer->next = nullptr;
+      buffer->data_size = size - sizeof(Buffer);
+      buffer->current_idx = 0;
+   }
+
+   ~monotonic_buffer_resource()
+   {
+      release();
+      free(buffer);
+   }
+
+   monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
+   monotonic_buffer_resource& operator=(const monotonic_buffer_resource&) = delete;
+
+   void* allocate(size_t size, size_t alignment)
+   {
+      buffer->current_idx = align64(buffer->current_idx, alignment);
+      if (buffer->current_idx + size <= buffer->data_size) {
+         uint8_t* ptr = &buffer->data[buffer->current_idx];
+         buffer->current_idx += size;
+         return ptr;
+      }
+
+      /* create a new buffer, at least twice as large as the previous one */
+      size_t total_size = buffer->data_size + sizeof(Buffer);
+      do {
+         total_size *= 2;
+      } while (total_size - sizeof(Buffer) < size + alignment);
+
+      Buffer* next = buffer;
+      buffer = (Buffer*)malloc(total_size);
+      buffer->next = next;
+      buffer->data_size = total_size - sizeof(Buffer);
+      buffer->current_idx = 0;
+
+      return allocate(size, alignment);
+   }
+
+   /* Frees all buffers but the first one, which is kept for reuse. */
+   void release()
+   {
+      while (buffer->next) {
+         Buffer* next = buffer->next;
+         free(buffer);
+         buffer = next;
+      }
+      buffer->current_idx = 0;
+   }
+
+   /* Returns the number of bytes handed out since the last release(). */
+   size_t allocated_size() const
+   {
+      size_t size = 0;
+      for (const Buffer* b = buffer; b; b = b->next)
+         size += b->current_idx;
+      return size;
+   }
+
+   bool operator==(const monotonic_buffer_resource& other) const
+   {
+      return buffer == other.buffer;
+   }
+
+private:
+   struct Buffer {
+      Buffer* next;
+      size_t current_idx;
+      size_t data_size;
+      alignas(16) uint8_t data[];
+   };
+
+   Buffer* buffer;
+   static constexpr size_t initial_size = 4096;
+   static constexpr size_t minimum_size = 128;
+   static_assert(minimum_size > sizeof(Buffer), "minimum_size too small");
+};
+
+/*
+ * Small std::allocator-compatible wrapper around monotonic_buffer_resource.
+ * deallocate() is a no-op, memory is returned when the resource is released.
+ */
+template <typename T> class monotonic_allocator {
+public:
+   monotonic_allocator() = delete;
+   monotonic_allocator(monotonic_buffer_resource& m) : memory_resource(m) {}
+   template <typename U>
+   monotonic_allocator(const monotonic_allocator<U>& rhs) : memory_resource(rhs.memory_resource)
+   {}
+
+   using value_type = T;
+
+   T* allocate(size_t size)
+   {
+      return (T*)memory_resource.get().allocate(size * sizeof(T), alignof(T));
+   }
+
+   void deallocate(T* ptr, size_t size) {}
+
+   template <typename U> bool operator==(const monotonic_allocator<U>& rhs) const
+   {
+      return &memory_resource.get() == &rhs.memory_resource.get();
+   }
+   template <typename U> bool operator!=(const monotonic_allocator<U>& rhs) const
+   {
+      return !(*this == rhs);
+   }
+
+private:
+   std::reference_wrapper<monotonic_buffer_resource> memory_resource;
+
+   template <typename> friend class monotonic_allocator;
+};
+
+/* Containers backed by a monotonic_buffer_resource. */
+template <typename Key, typename T, typename Hash = std::hash<Key>,
+          typename Pred = std::equal_to<Key>>
+using unordered_map =
+   std::unordered_map<Key, T, Hash, Pred, monotonic_allocator<std::pair<const Key, T>>>;
+
+template <typename Key, typename T, typename Compare = std::less<Key>>
+using map = std::map<Key, T, Compare, monotonic_allocator<std::pair<const Key, T>>>;
+
 } // namespace aco
 
 #endif // ACO_UTIL_H
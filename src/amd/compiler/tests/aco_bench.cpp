@@ -0,0 +1,593 @@
+/*
+ * Copyright © 2022 Valve Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * Compile-time benchmark for ACO.
+ *
+ * Compiles a corpus of SPIR-V compute shaders through RADV without a GPU
+ * (like aco_tests, using RADV_FORCE_FAMILY) and reports the time spent per
+ * shader and per ACO pass, the memory used for instructions and the pipeline
+ * statistics of every shader.
+ *
+ * Per-pass times are collected with ACO_DEBUG=passtimereport, which makes ACO
+ * report them for every shader through the VK_EXT_debug_report callback.
+ */
+
+#include "vulkan/vulkan.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+PFN_vkVoidFunction VKAPI_CALL vk_icdGetInstanceProcAddr(
+	VkInstance                                  instance,
+	const char*                                 pName);
+}
+
+#define FUNCTION_LIST                                                                             \
+   ITEM(CreateInstance)                                                                           \
+   ITEM(DestroyInstance)                                                                          \
+   ITEM(EnumeratePhysicalDevices)                                                                 \
+   ITEM(CreateDevice)                                                                             \
+   ITEM(DestroyDevice)                                                                            \
+   ITEM(CreateDebugReportCallbackEXT)                                                             \
+   ITEM(DestroyDebugReportCallbackEXT)                                                            \
+   ITEM(CreateShaderModule)                                                                       \
+   ITEM(DestroyShaderModule)                                                                      \
+   ITEM(CreateDescriptorSetLayout)                                                                \
+   ITEM(DestroyDescriptorSetLayout)                                                               \
+   ITEM(CreatePipelineLayout)                                                                     \
+   ITEM(DestroyPipelineLayout)                                                                    \
+   ITEM(CreateComputePipelines)                                                                   \
+   ITEM(DestroyPipeline)                                                                          \
+   ITEM(GetPipelineExecutablePropertiesKHR)                                                       \
+   ITEM(GetPipelineExecutableStatisticsKHR)
+
+#define ITEM(n) static PFN_vk##n n;
+FUNCTION_LIST
+#undef ITEM
+
+static const char* help_message =
+   "Usage: %s [-h] [-f <family>] [-n <iterations>] [-s] shader.spv...\n"
+   "\n"
+   "Compile SPIR-V compute shaders with ACO and report compile times.\n"
+   "\n"
+   "Optional arguments:\n"
+   "  -h, --help                Print this help message.\n"
+   "  -f, --family <family>     Chip to compile for, as accepted by\n"
+   "                            RADV_FORCE_FAMILY (default: navi21).\n"
+   "  -n, --iterations <n>      Compile every shader n times (default: 5).\n"
+   "  -s, --stats               Print the pipeline statistics of every shader.\n";
+
+/* Accumulated over everything compiled while 'collecting' is set. */
+static bool collecting = false;
+static std::vector<std::pair<std::string, uint64_t>> pass_times;
+static uint64_t instruction_memory = 0;
+static unsigned num_reports = 0;
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL
+debug_report_cb(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT object_type,
+                uint64_t object, size_t location, int32_t message_code,
+                const char* layer_prefix, const char* message, void* user_data)
+{
+   if (!collecting || !strstr(message, "pass times:"))
+      return VK_FALSE;
+
+   num_reports++;
+   for (const char* line = message; line; line = strchr(line, '\n')) {
+      char name[128];
+      uint64_t value;
+      char c;
+
+      line += *line == '\n';
+      if (sscanf(line, " instruction memory: %" SCNu64 " byte%c", &value, &c) == 2) {
+         instruction_memory += value;
+      } else if (sscanf(line, " %127[^:]: %" SCNu64 " n%c", name, &value, &c) == 3 && c == 's') {
+         auto it = std::find_if(pass_times.begin(), pass_times.end(),
+                                [&name](const auto& p) { return p.first == name; });
+         if (it == pass_times.end())
+            pass_times.emplace_back(name, value);
+         else
+            it->second += value;
+      }
+   }
+
+   return VK_FALSE;
+}
+
+struct spirv_binding {
+   VkDescriptorType type;
+   uint32_t count;
+};
+
+/* Minimal SPIR-V reflection: the entry point name and the descriptor bindings
+ * a compute shader declares, so that a compatible pipeline layout can be
+ * created for arbitrary shaders.
+ */
+struct spirv_module {
+   std::vector<uint32_t> words;
+   std::string entrypoint;
+   std::map<uint32_t, std::map<uint32_t, spirv_binding>> sets;
+
+   bool reflect(std::string& error);
+};
+
+bool
+spirv_module::reflect(std::string& error)
+{
+   enum {
+      OpEntryPoint = 15,
+      OpTypeImage = 25,
+      OpTypeSampler = 26,
+      OpTypeSampledImage = 27,
+      OpTypeArray = 28,
+      OpTypeRuntimeArray = 29,
+      OpTypeStruct = 30,
+      OpTypePointer = 32,
+      OpConstant = 43,
+      OpVariable = 59,
+      OpDecorate = 71,
+   };
+   enum {
+      DecorationBlock = 2,
+      DecorationBufferBlock = 3,
+      DecorationBinding = 33,
+      DecorationDescriptorSet = 34,
+   };
+   enum {
+      StorageClassUniformConstant = 0,
+      StorageClassUniform = 2,
+      StorageClassStorageBuffer = 12,
+   };
+   enum { ExecutionModelGLCompute = 5 };
+   enum { DimBuffer = 5 };
+
+   struct id_info {
+      uint32_t opcode = 0;
+      uint32_t operands[3] = {};
+      int32_t set = -1;
+      int32_t binding = -1;
+      bool block = false;
+      bool buffer_block = false;
+   };
+
+   if (words.size() < 5 || words[0] != 0x07230203) {
+      error = "not a SPIR-V module";
+      return false;
+   }
+
+   std::vector<id_info> ids(words[3]);
+   std::vector<uint32_t> variables;
+
+   for (size_t i = 5; i < words.size();) {
+      uint32_t opcode = words[i] & 0xffff;
+      uint32_t count = words[i] >> 16;
+      if (!count || i + count > words.size()) {
+         error = "malformed SPIR-V module";
+         return false;
+      }
+      const uint32_t* ops = &words[i + 1];
+
+      switch (opcode) {
+      case OpEntryPoint:
+         if (ops[0] == ExecutionModelGLCompute && entrypoint.empty())
+            entrypoint = (const char*)&ops[2];
+         break;
+      case OpDecorate:
+         if (ops[1] == DecorationDescriptorSet)
+            ids[ops[0]].set = ops[2];
+         else if (ops[1] == DecorationBinding)
+            ids[ops[0]].binding = ops[2];
+         else if (ops[1] == DecorationBlock)
+            ids[ops[0]].block = true;
+         else if (ops[1] == DecorationBufferBlock)
+            ids[ops[0]].buffer_block = true;
+         break;
+      case OpTypeImage:
+         ids[ops[0]].opcode = opcode;
+         ids[ops[0]].operands[0] = ops[2]; /* Dim */
+         ids[ops[0]].operands[1] = ops[6]; /* Sampled */
+         break;
+      case OpTypeSampler:
+      case OpTypeSampledImage:
+      case OpTypeStruct:
+         ids[ops[0]].opcode = opcode;
+         break;
+      case OpTypeArray:
+      case OpTypeRuntimeArray:
+         ids[ops[0]].opcode = opcode;
+         ids[ops[0]].operands[0] = ops[1]; /* element type */
+         ids[ops[0]].operands[1] = opcode == OpTypeArray ? ops[2] : 0; /* length */
+         break;
+      case OpTypePointer:
+         ids[ops[0]].opcode = opcode;
+         ids[ops[0]].operands[0] = ops[1]; /* storage class */
+         ids[ops[0]].operands[1] = ops[2]; /* pointee */
+         break;
+      case OpConstant:
+         ids[ops[1]].opcode = opcode;
+         ids[ops[1]].operands[0] = ops[2];
+         break;
+      case OpVariable:
+         ids[ops[1]].opcode = opcode;
+         ids[ops[1]].operands[0] = ops[0]; /* pointer type */
+         ids[ops[1]].operands[1] = ops[2]; /* storage class */
+         variables.push_back(ops[1]);
+         break;
+      default:
+         break;
+      }
+
+      i += count;
+   }
+
+   if (entrypoint.empty()) {
+      error = "no compute entry point";
+      return false;
+   }
+
+   for (uint32_t var : variables) {
+      const id_info& info = ids[var];
+      if (info.set < 0 || info.binding < 0)
+         continue;
+
+      uint32_t storage = info.operands[1];
+      uint32_t type = ids[info.operands[0]].operands[1];
+      uint32_t count = 1;
+      if (ids[type].opcode == OpTypeArray || ids[type].opcode == OpTypeRuntimeArray) {
+         if (ids[type].opcode == OpTypeArray)
+            count = ids[ids[type].operands[1]].operands[0];
+         type = ids[type].operands[0];
+      }
+
+      const id_info& t = ids[type];
+      VkDescriptorType desc_type;
+      if (storage == StorageClassStorageBuffer) {
+         desc_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      } else if (storage == StorageClassUniform) {
+         desc_type = t.buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                    : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      } else if (storage == StorageClassUniformConstant && t.opcode == OpTypeSampler) {
+         desc_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+      } else if (storage == StorageClassUniformConstant && t.opcode == OpTypeSampledImage) {
+         desc_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      } else if (storage == StorageClassUniformConstant && t.opcode == OpTypeImage) {
+         bool storage_image = t.operands[1] == 2;
+         if (t.operands[0] == DimBuffer)
+            desc_type = storage_image ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                                      : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+         else
+            desc_type = storage_image ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                                      : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+      } else {
+         error = "unsupported resource type for set " + std::to_string(info.set) +
+                 ", binding " + std::to_string(info.binding);
+         return false;
+      }
+
+      sets[info.set][info.binding] = spirv_binding{desc_type, count};
+   }
+
+   return true;
+}
+
+static bool
+read_spirv(const char* filename, std::vector<uint32_t>& words)
+{
+   FILE* f = fopen(filename, "rb");
+   if (!f)
+      return false;
+
+   fseek(f, 0, SEEK_END);
+   long size = ftell(f);
+   fseek(f, 0, SEEK_SET);
+
+   words.resize(size / 4);
+   bool ok = size > 0 && fread(words.data(), 4, words.size(), f) == words.size();
+   fclose(f);
+   return ok;
+}
+
+static void
+print_statistics(VkDevice device, VkPipeline pipeline)
+{
+   VkPipelineExecutableInfoKHR exec_info = {};
+   exec_info.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_INFO_KHR;
+   exec_info.pipeline = pipeline;
+   exec_info.executableIndex = 0;
+
+   uint32_t count = 0;
+   GetPipelineExecutableStatisticsKHR(device, &exec_info, &count, NULL);
+   std::vector<VkPipelineExecutableStatisticKHR> stats(count);
+   for (VkPipelineExecutableStatisticKHR& stat : stats)
+      stat.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_STATISTIC_KHR;
+   GetPipelineExecutableStatisticsKHR(device, &exec_info, &count, stats.data());
+
+   for (const VkPipelineExecutableStatisticKHR& stat : stats) {
+      printf("    %-24s ", stat.name);
+      switch (stat.format) {
+      case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_BOOL32_KHR:
+         printf("%s\n", stat.value.b32 ? "true" : "false");
+         break;
+      case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_INT64_KHR:
+         printf("%" PRIi64 "\n", stat.value.i64);
+         break;
+      case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_UINT64_KHR:
+         printf("%" PRIu64 "\n", stat.value.u64);
+         break;
+      case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_FLOAT64_KHR:
+         printf("%f\n", stat.value.f64);
+         break;
+      default:
+         printf("?\n");
+         break;
+      }
+   }
+}
+
+/* Returns the average compile time in ns, or -1 on failure. */
+static int64_t
+bench_shader(VkDevice device, const char* filename, unsigned iterations, bool stats)
+{
+   spirv_module module;
+   std::string error;
+
+   if (!read_spirv(filename, module.words)) {
+      fprintf(stderr, "%s: could not read file\n", filename);
+      return -1;
+   }
+   if (!module.reflect(error)) {
+      fprintf(stderr, "%s: %s\n", filename, error.c_str());
+      return -1;
+   }
+
+   std::vector<VkDescriptorSetLayout> set_layouts;
+   uint32_t num_sets = module.sets.empty() ? 0 : module.sets.rbegin()->first + 1;
+   for (uint32_t set = 0; set < num_sets; set++) {
+      std::vector<VkDescriptorSetLayoutBinding> bindings;
+      for (const auto& b : module.sets[set]) {
+         VkDescriptorSetLayoutBinding binding = {};
+         binding.binding = b.first;
+         binding.descriptorType = b.second.type;
+         binding.descriptorCount = b.second.count;
+         binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+         bindings.push_back(binding);
+      }
+
+      VkDescriptorSetLayoutCreateInfo set_info = {};
+      set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+      set_info.bindingCount = bindings.size();
+      set_info.pBindings = bindings.data();
+
+      VkDescriptorSetLayout layout;
+      CreateDescriptorSetLayout(device, &set_info, NULL, &layout);
+      set_layouts.push_back(layout);
+   }
+
+   VkPushConstantRange push_constants = {VK_SHADER_STAGE_COMPUTE_BIT, 0, 128};
+   VkPipelineLayoutCreateInfo layout_info = {};
+   layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+   layout_info.setLayoutCount = set_layouts.size();
+   layout_info.pSetLayouts = set_layouts.data();
+   layout_info.pushConstantRangeCount = 1;
+   layout_info.pPushConstantRanges = &push_constants;
+
+   VkPipelineLayout pipeline_layout;
+   CreatePipelineLayout(device, &layout_info, NULL, &pipeline_layout);
+
+   VkShaderModuleCreateInfo module_info = {};
+   module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+   module_info.codeSize = module.words.size() * 4;
+   module_info.pCode = module.words.data();
+
+   VkShaderModule shader_module;
+   CreateShaderModule(device, &module_info, NULL, &shader_module);
+
+   VkComputePipelineCreateInfo pipeline_info = {};
+   pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+   pipeline_info.flags = VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR;
+   pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+   pipeline_info.stage.module = shader_module;
+   pipeline_info.stage.pName = module.entrypoint.c_str();
+   pipeline_info.layout = pipeline_layout;
+
+   int64_t total = 0;
+   VkPipeline pipeline = VK_NULL_HANDLE;
+   for (unsigned i = 0; i < iterations; i++) {
+      if (pipeline)
+         DestroyPipeline(device, pipeline, NULL);
+
+      auto start = std::chrono::steady_clock::now();
+      VkResult result =
+         CreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &pipeline);
+      auto end = std::chrono::steady_clock::now();
+
+      if (result != VK_SUCCESS) {
+         fprintf(stderr, "%s: pipeline creation failed (%d)\n", filename, result);
+         total = -1;
+         pipeline = VK_NULL_HANDLE;
+         break;
+      }
+      total += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+   }
+
+   if (total >= 0) {
+      printf("%-48s %10.3f ms\n", filename, total / (iterations * 1e6));
+      if (stats)
+         print_statistics(device, pipeline);
+   }
+
+   if (pipeline)
+      DestroyPipeline(device, pipeline, NULL);
+   DestroyShaderModule(device, shader_module, NULL);
+   DestroyPipelineLayout(device, pipeline_layout, NULL);
+   for (VkDescriptorSetLayout layout : set_layouts)
+      DestroyDescriptorSetLayout(device, layout, NULL);
+
+   return total < 0 ? -1 : total / iterations;
+}
+
+static void
+append_env(const char* name, const char* value)
+{
+   const char* old = getenv(name);
+   std::string str = old && *old ? std::string(old) + "," + value : value;
+   setenv(name, str.c_str(), 1);
+}
+
+int
+main(int argc, char** argv)
+{
+   const char* family = "navi21";
+   unsigned iterations = 5;
+   int print_stats = 0;
+   const struct option opts[] = {
+      {"help", no_argument, NULL, 'h'},
+      {"family", required_argument, NULL, 'f'},
+      {"iterations", required_argument, NULL, 'n'},
+      {"stats", no_argument, NULL, 's'},
+      {NULL, 0, NULL, 0},
+   };
+
+   int c;
+   while ((c = getopt_long(argc, argv, "hf:n:s", opts, NULL)) != -1) {
+      switch (c) {
+      case 'f': family = optarg; break;
+      case 'n': iterations = std::max(atoi(optarg), 1); break;
+      case 's': print_stats = 1; break;
+      case 'h':
+      default: fprintf(stderr, help_message, argv[0]); return c == 'h' ? 0 : 99;
+      }
+   }
+
+   if (optind >= argc) {
+      fprintf(stderr, help_message, argv[0]);
+      return 99;
+   }
+
+   /* Compile on the CPU only, never hit the shader cache, and have ACO report
+    * its per-pass times.
+    */
+   setenv("RADV_FORCE_FAMILY", family, 1);
+   append_env("RADV_DEBUG", "nocache");
+   append_env("ACO_DEBUG", "passtimereport");
+
+   VkApplicationInfo app_info = {};
+   app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+   app_info.pApplicationName = "aco_bench";
+   app_info.apiVersion = VK_API_VERSION_1_2;
+
+   static const char* instance_extensions[] = {"VK_EXT_debug_report"};
+   VkInstanceCreateInfo instance_info = {};
+   instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+   instance_info.pApplicationInfo = &app_info;
+   instance_info.enabledExtensionCount = 1;
+   instance_info.ppEnabledExtensionNames = instance_extensions;
+
+   VkInstance instance;
+   if (((PFN_vkCreateInstance)vk_icdGetInstanceProcAddr(NULL, "vkCreateInstance"))(
+          &instance_info, NULL, &instance) != VK_SUCCESS) {
+      fprintf(stderr, "Failed to create a Vulkan instance.\n");
+      return 1;
+   }
+
+#define ITEM(n) n = (PFN_vk##n)vk_icdGetInstanceProcAddr(instance, "vk" #n);
+   FUNCTION_LIST
+#undef ITEM
+
+   VkDebugReportCallbackCreateInfoEXT callback_info = {};
+   callback_info.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
+   callback_info.flags = VK_DEBUG_REPORT_INFORMATION_BIT_EXT | VK_DEBUG_REPORT_DEBUG_BIT_EXT;
+   callback_info.pfnCallback = debug_report_cb;
+
+   VkDebugReportCallbackEXT callback;
+   CreateDebugReportCallbackEXT(instance, &callback_info, NULL, &callback);
+
+   uint32_t device_count = 1;
+   VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+   EnumeratePhysicalDevices(instance, &device_count, &physical_device);
+   if (physical_device == VK_NULL_HANDLE) {
+      fprintf(stderr, "No physical device for family '%s'.\n", family);
+      return 1;
+   }
+
+   static const char* device_extensions[] = {"VK_KHR_pipeline_executable_properties"};
+   VkDeviceCreateInfo device_info = {};
+   device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+   device_info.enabledExtensionCount = 1;
+   device_info.ppEnabledExtensionNames = device_extensions;
+
+   VkDevice device;
+   if (CreateDevice(physical_device, &device_info, NULL, &device) != VK_SUCCESS) {
+      fprintf(stderr, "Failed to create a Vulkan device.\n");
+      return 1;
+   }
+
+   int64_t total = 0;
+   unsigned failed = 0;
+   collecting = true;
+   for (int i = optind; i < argc; i++) {
+      int64_t time = bench_shader(device, argv[i], iterations, print_stats);
+      if (time < 0)
+         failed++;
+      else
+         total += time;
+   }
+   collecting = false;
+
+   printf("\n%-48s %10.3f ms\n", "Total (average per iteration)", total / 1e6);
+
+   if (num_reports) {
+      uint64_t pass_total = 0;
+      for (const auto& p : pass_times)
+         pass_total += p.second;
+
+      std::sort(pass_times.begin(), pass_times.end(),
+                [](const auto& a, const auto& b) { return a.second > b.second; });
+
+      printf("\nACO passes (%u compiles):\n", num_reports);
+      for (const auto& p : pass_times) {
+         printf("    %-28s %10.3f ms  %5.1f%%\n", p.first.c_str(),
+                p.second / (iterations * 1e6), p.second * 100.0 / pass_total);
+      }
+      printf("    %-28s %10.3f ms\n", "total", pass_total / (iterations * 1e6));
+      printf("    %-28s %10.1f KiB per compile\n", "instruction memory",
+             instruction_memory / (num_reports * 1024.0));
+   }
+
+   DestroyDevice(device, NULL);
+   DestroyDebugReportCallbackEXT(instance, callback, NULL);
+   DestroyInstance(instance, NULL);
+
+   return failed ? 1 : 0;
+}
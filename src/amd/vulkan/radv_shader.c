@@ -283,6 +283,7 @@ radv_compiler_debug(void *private_data, enum aco_compiler_debug_level level, con
    static const VkDebugReportFlagsEXT vk_flags[] = {
       [ACO_COMPILER_DEBUG_LEVEL_PERFWARN] = VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT,
       [ACO_COMPILER_DEBUG_LEVEL_ERROR] = VK_DEBUG_REPORT_ERROR_BIT_EXT,
+      [ACO_COMPILER_DEBUG_LEVEL_INFO] = VK_DEBUG_REPORT_INFORMATION_BIT_EXT,
    };
 
    /* VK_DEBUG_REPORT_DEBUG_BIT_EXT specifies diagnostic information
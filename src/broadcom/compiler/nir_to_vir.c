@@ -4537,14 +4537,15 @@ v3d_nir_to_vir(struct v3d_compile *c)
 
         vir_check_payload_w(c);
 
-        /* XXX perf: On VC4, we do a VIR-level instruction scheduling here.
-         * We used that on that platform to pipeline TMU writes and reduce the
-         * number of thread switches, as well as try (mostly successfully) to
-         * reduce maximum register pressure to allow more threads.  We should
-         * do something of that sort for V3D -- either instruction scheduling
-         * here, or delay the the THRSW and LDTMUs from our texture
-         * instructions until the results are needed.
+        /* Try to reduce the maximum register pressure to allow more threads.
+         *
+         * XXX perf: On VC4, the VIR-level scheduling also pipelined TMU
+         * writes to reduce the number of thread switches.  We should do
+         * something of that sort for V3D too -- either here, or delay the
+         * THRSW and LDTMUs from our texture instructions until the results
+         * are needed.
          */
+        vir_pressure_schedule(c);
 
         if (V3D_DEBUG & (V3D_DEBUG_VIR |
                          v3d_debug_flag_for_shader_stage(c->s->info.stage))) {
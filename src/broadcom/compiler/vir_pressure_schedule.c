@@ -0,0 +1,422 @@
+/*
+ * Copyright © 2022 Raspberry Pi Ltd
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file vir_pressure_schedule.c
+ *
+ * Bottom-up VIR scheduler that runs before register allocation and only tries
+ * to reduce register pressure, so more shaders can be allocated at 4 threads
+ * without spilling.  Latency is left to qpu_schedule.c after RA.
+ *
+ * VIR has a lot of implicit state (flags, accumulators written by signals,
+ * the TMU/TLB/VPM FIFOs, thread switches...), so instead of modeling all of
+ * it we only reorder plain ALU instructions that write a temp and read temps,
+ * uniforms or immediates.  Any other instruction acts as a barrier, splitting
+ * each block into segments which are scheduled independently.  Since none of
+ * the implicit state can change inside a segment, the only dependencies we
+ * need to track are the ones on temps.
+ */
+
+#include <limits.h>
+
+#include "util/dag.h"
+#include "v3d_compiler.h"
+
+struct sched_node {
+        struct dag_node dag;
+
+        struct qinst *inst;
+
+        /* Position in the original program order within the segment */
+        uint32_t index;
+};
+
+struct sched_state {
+        struct v3d_compile *c;
+        void *mem_ctx;
+
+        /* Last reader/writer of each temp in the segment being built */
+        struct sched_node **last_read;
+        struct sched_node **last_write;
+
+        /* Live set while walking the block bottom-up, live set at the end of
+         * the current segment, and scratch space for scheduling it.
+         */
+        BITSET_WORD *block_live;
+        BITSET_WORD *seg_live;
+        BITSET_WORD *live;
+        uint32_t bitset_words;
+
+        /* Current segment, in reverse program order */
+        struct util_dynarray segment;
+
+        bool progress;
+};
+
+static bool
+vir_inst_is_schedulable(struct v3d_compile *c, struct qinst *inst)
+{
+        if (inst->qpu.type != V3D_QPU_INSTR_TYPE_ALU)
+                return false;
+
+        if (vir_has_side_effects(c, inst))
+                return false;
+
+        if (inst->dst.file != QFILE_TEMP)
+                return false;
+
+        /* Conditional writes read the flags and only partially define their
+         * destination, any flag update changes the implicit state.
+         */
+        if (inst->qpu.flags.ac != V3D_QPU_COND_NONE ||
+            inst->qpu.flags.mc != V3D_QPU_COND_NONE ||
+            inst->qpu.flags.apf != V3D_QPU_PF_NONE ||
+            inst->qpu.flags.mpf != V3D_QPU_PF_NONE ||
+            inst->qpu.flags.auf != V3D_QPU_UF_NONE ||
+            inst->qpu.flags.muf != V3D_QPU_UF_NONE) {
+                return false;
+        }
+
+        /* The uniform stream is rebuilt after scheduling, so ldunif is fine,
+         * but other signals have implicit destinations or sources.
+         */
+        const struct v3d_qpu_sig *sig = &inst->qpu.sig;
+        if (sig->ldunifa || sig->ldunifarf || sig->ldtmu || sig->ldvary ||
+            sig->ldvpm || sig->ldtlb || sig->ldtlbu || sig->ucb ||
+            sig->rotate || sig->wrtmuc || sig->thrsw) {
+                return false;
+        }
+
+        switch (inst->qpu.alu.add.op) {
+        case V3D_QPU_A_FLAPUSH:
+        case V3D_QPU_A_FLBPUSH:
+        case V3D_QPU_A_FLPOP:
+                return false;
+        default:
+                break;
+        }
+
+        if (v3d_qpu_reads_vpm(&inst->qpu))
+                return false;
+
+        for (int i = 0; i < vir_get_nsrc(inst); i++) {
+                switch (inst->src[i].file) {
+                case QFILE_REG:
+                case QFILE_MAGIC:
+                case QFILE_VPM:
+                        return false;
+                default:
+                        break;
+                }
+        }
+
+        return true;
+}
+
+/* Updates the live set for walking bottom-up over inst */
+static void
+update_live(struct qinst *inst, BITSET_WORD *live)
+{
+        if (inst->dst.file == QFILE_TEMP &&
+            (inst->qpu.type != V3D_QPU_INSTR_TYPE_ALU ||
+             (inst->qpu.flags.ac == V3D_QPU_COND_NONE &&
+              inst->qpu.flags.mc == V3D_QPU_COND_NONE))) {
+                BITSET_CLEAR(live, inst->dst.index);
+        }
+
+        for (int i = 0; i < vir_get_nsrc(inst); i++) {
+                if (inst->src[i].file == QFILE_TEMP)
+                        BITSET_SET(live, inst->src[i].index);
+        }
+}
+
+/*
+ * Calculate the difference in the number of live temps before and after a
+ * schedulable instruction, given the live set after it:
+ *
+ *      live_in = (live_out - KILL) + GEN
+ */
+static int
+pressure_delta(struct qinst *inst, BITSET_WORD *live)
+{
+        uint32_t dst = inst->dst.index;
+        int delta = BITSET_TEST(live, dst) ? -1 : 0;
+
+        for (int i = 0; i < vir_get_nsrc(inst); i++) {
+                if (inst->src[i].file != QFILE_TEMP)
+                        continue;
+
+                uint32_t src = inst->src[i].index;
+
+                bool dupe = false;
+                for (int j = 0; j < i; j++) {
+                        if (inst->src[j].file == QFILE_TEMP &&
+                            inst->src[j].index == src) {
+                                dupe = true;
+                                break;
+                        }
+                }
+
+                if (!dupe && (src == dst || !BITSET_TEST(live, src)))
+                        delta++;
+        }
+
+        return delta;
+}
+
+static void
+add_dep(struct sched_node *after, struct sched_node *before)
+{
+        if (after && before)
+                dag_add_edge(&after->dag, &before->dag, 0);
+}
+
+static bool
+reads_temp(struct qinst *inst, uint32_t temp)
+{
+        for (int s = 0; s < vir_get_nsrc(inst); s++) {
+                if (inst->src[s].file == QFILE_TEMP &&
+                    inst->src[s].index == temp) {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+static struct dag *
+create_dag(struct sched_state *state, struct qinst **insts, uint32_t count)
+{
+        struct dag *dag = dag_create(state->mem_ctx);
+        struct sched_node **nodes =
+                ralloc_array(state->mem_ctx, struct sched_node *, count);
+
+        /* insts is in reverse program order */
+        for (uint32_t i = 0; i < count; i++) {
+                struct qinst *inst = insts[count - 1 - i];
+                struct sched_node *n = rzalloc(state->mem_ctx, struct sched_node);
+
+                n->inst = inst;
+                n->index = i;
+                dag_init_node(dag, &n->dag);
+                nodes[i] = n;
+
+                /* Reads depend on writes */
+                for (int s = 0; s < vir_get_nsrc(inst); s++) {
+                        if (inst->src[s].file != QFILE_TEMP)
+                                continue;
+
+                        add_dep(n, state->last_write[inst->src[s].index]);
+                }
+
+                /* Writes depend on reads and writes.  Most temps are only
+                 * written once, so only look for all the earlier readers when
+                 * a temp that has been read is redefined.
+                 */
+                uint32_t dst = inst->dst.index;
+                if (state->last_read[dst]) {
+                        for (uint32_t j = 0; j < i; j++) {
+                                if (reads_temp(nodes[j]->inst, dst))
+                                        add_dep(n, nodes[j]);
+                        }
+                }
+                add_dep(n, state->last_write[dst]);
+                state->last_write[dst] = n;
+
+                for (int s = 0; s < vir_get_nsrc(inst); s++) {
+                        if (inst->src[s].file == QFILE_TEMP)
+                                state->last_read[inst->src[s].index] = n;
+                }
+        }
+
+        /* Reset the tracking for the next segment */
+        for (uint32_t i = 0; i < count; i++) {
+                struct qinst *inst = insts[i];
+
+                state->last_write[inst->dst.index] = NULL;
+                state->last_read[inst->dst.index] = NULL;
+                for (int s = 0; s < vir_get_nsrc(inst); s++) {
+                        if (inst->src[s].file == QFILE_TEMP)
+                                state->last_read[inst->src[s].index] = NULL;
+                }
+        }
+
+        return dag;
+}
+
+/*
+ * Choose the next instruction, bottom-up: the one with the best effect on
+ * liveness, or the latest one in program order on a tie to avoid gratuitous
+ * changes that would cost latency for nothing.
+ */
+static struct sched_node *
+choose_inst(struct dag *dag, BITSET_WORD *live)
+{
+        struct sched_node *best = NULL;
+        int best_delta = INT_MAX;
+
+        list_for_each_entry(struct sched_node, n, &dag->heads, dag.link) {
+                int delta = pressure_delta(n->inst, live);
+
+                if (delta < best_delta ||
+                    (delta == best_delta && n->index > best->index)) {
+                        best = n;
+                        best_delta = delta;
+                }
+        }
+
+        return best;
+}
+
+static void
+schedule_segment(struct sched_state *state, struct list_head *after)
+{
+        uint32_t count = util_dynarray_num_elements(&state->segment,
+                                                    struct qinst *);
+        struct qinst **insts = util_dynarray_begin(&state->segment);
+
+        if (count < 3)
+                return;
+
+        /* Pressure of the original order, off by a constant */
+        int pressure = 0, orig_max_pressure = 0;
+        memcpy(state->live, state->seg_live,
+               state->bitset_words * sizeof(BITSET_WORD));
+        for (uint32_t i = 0; i < count; i++) {
+                pressure += pressure_delta(insts[i], state->live);
+                orig_max_pressure = MAX2(pressure, orig_max_pressure);
+                update_live(insts[i], state->live);
+        }
+
+        struct dag *dag = create_dag(state, insts, count);
+        struct qinst **schedule = ralloc_array(state->mem_ctx, struct qinst *,
+                                               count);
+        int max_pressure = 0;
+        uint32_t n = 0;
+        bool changed = false;
+
+        pressure = 0;
+        memcpy(state->live, state->seg_live,
+               state->bitset_words * sizeof(BITSET_WORD));
+        while (!list_is_empty(&dag->heads)) {
+                struct sched_node *node = choose_inst(dag, state->live);
+
+                pressure += pressure_delta(node->inst, state->live);
+                max_pressure = MAX2(pressure, max_pressure);
+                update_live(node->inst, state->live);
+                dag_prune_head(dag, &node->dag);
+
+                changed |= node->inst != insts[n];
+                schedule[n++] = node->inst;
+        }
+
+        assert(n == count);
+
+        /* Bail if it doesn't help */
+        if (!changed || max_pressure >= orig_max_pressure)
+                return;
+
+        for (uint32_t i = 0; i < count; i++)
+                list_del(&schedule[i]->link);
+
+        for (uint32_t i = 0; i < count; i++) {
+                list_addtail(&schedule[i]->link, after);
+                after = &schedule[i]->link;
+        }
+
+        state->progress = true;
+}
+
+static void
+pressure_schedule_block(struct sched_state *state, struct qblock *block)
+{
+        BITSET_WORD *live = state->block_live;
+        memcpy(live, block->live_out,
+               state->bitset_words * sizeof(BITSET_WORD));
+
+        struct list_head *seg_end = &block->instructions;
+        util_dynarray_clear(&state->segment);
+
+        vir_for_each_inst_rev(inst, block) {
+                if (vir_inst_is_schedulable(state->c, inst)) {
+                        if (!util_dynarray_num_elements(&state->segment,
+                                                        struct qinst *)) {
+                                memcpy(state->seg_live, live,
+                                       state->bitset_words *
+                                       sizeof(BITSET_WORD));
+                        }
+
+                        util_dynarray_append(&state->segment,
+                                             struct qinst *, inst);
+                } else {
+                        /* Only instructions after inst are reordered, so
+                         * walking backwards is safe.
+                         */
+                        schedule_segment(state, seg_end);
+                        util_dynarray_clear(&state->segment);
+                        seg_end = &inst->link;
+                }
+
+                update_live(inst, live);
+        }
+
+        schedule_segment(state, seg_end);
+        util_dynarray_clear(&state->segment);
+}
+
+bool
+vir_pressure_schedule(struct v3d_compile *c)
+{
+        if (V3D_DEBUG & V3D_DEBUG_NO_PSCHED)
+                return false;
+
+        vir_calculate_live_intervals(c);
+
+        struct sched_state state = {
+                .c = c,
+                .mem_ctx = ralloc_context(NULL),
+                .bitset_words = BITSET_WORDS(c->num_temps),
+        };
+
+        state.last_read = rzalloc_array(state.mem_ctx, struct sched_node *,
+                                        c->num_temps);
+        state.last_write = rzalloc_array(state.mem_ctx, struct sched_node *,
+                                         c->num_temps);
+        state.block_live = ralloc_array(state.mem_ctx, BITSET_WORD,
+                                        state.bitset_words);
+        state.live = ralloc_array(state.mem_ctx, BITSET_WORD,
+                                  state.bitset_words);
+        state.seg_live = ralloc_array(state.mem_ctx, BITSET_WORD,
+                                      state.bitset_words);
+        util_dynarray_init(&state.segment, state.mem_ctx);
+
+        vir_for_each_block(block, c)
+                pressure_schedule_block(&state, block);
+
+        ralloc_free(state.mem_ctx);
+
+        if (state.progress)
+                c->live_intervals_valid = false;
+
+        return state.progress;
+}
@@ -1724,6 +1724,8 @@ unsigned ir3_delayslots_with_repeat(struct ir3_instruction *assigner,
                                     unsigned assigner_n, unsigned consumer_n);
 unsigned ir3_delay_calc(struct ir3_block *block,
                         struct ir3_instruction *instr, bool mergedregs);
+unsigned ir3_delay_cycles(struct ir3_instruction *instr);
+unsigned ir3_issue_cycles(struct ir3_instruction *instr);
 
 /* estimated (ss)/(sy) delay calculation */
 
@@ -251,6 +251,7 @@ enum ir3_shader_debug {
    IR3_DBG_NOCACHE = BITFIELD_BIT(11),
    IR3_DBG_SPILLALL = BITFIELD_BIT(12),
    IR3_DBG_NOPREAMBLE = BITFIELD_BIT(13),
+   IR3_DBG_SCHEDLATENCY = BITFIELD_BIT(14),
 
    /* DEBUG-only options: */
    IR3_DBG_SCHEDMSGS = BITFIELD_BIT(20),
@@ -26,6 +26,7 @@
 
 #include <stdarg.h>
 
+#include "util/os_time.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_string.h"
@@ -4593,6 +4594,18 @@ collect_tex_prefetches(struct ir3_context *ctx, struct ir3 *ir)
    }
 }
 
+static void
+end_phase(struct ir3_shader_variant *so, enum ir3_compile_phase phase,
+          int64_t *start)
+{
+   if (!so->phase_times)
+      return;
+
+   int64_t now = os_time_get_nano();
+   so->phase_times[phase] += now - *start;
+   *start = now;
+}
+
 int
 ir3_compile_shader_nir(struct ir3_compiler *compiler,
                        struct ir3_shader *shader,
@@ -4602,6 +4615,7 @@ ir3_compile_shader_nir(struct ir3_compiler *compiler,
    struct ir3 *ir;
    int ret = 0, max_bary;
    bool progress;
+   int64_t phase_start = so->phase_times ? os_time_get_nano() : 0;
 
    assert(!so->ir);
 
@@ -4800,6 +4814,8 @@ ir3_compile_shader_nir(struct ir3_compiler *compiler,
    ir3_debug_print(ir, "AFTER: nir->ir3");
    ir3_validate(ir);
 
+   end_phase(so, IR3_PHASE_NIR_TO_IR3, &phase_start);
+
    IR3_PASS(ir, ir3_remove_unreachable);
 
    IR3_PASS(ir, ir3_array_to_ssa);
@@ -4832,6 +4848,8 @@ ir3_compile_shader_nir(struct ir3_compiler *compiler,
    /* At this point, all the dead code should be long gone: */
    assert(!IR3_PASS(ir, ir3_dce, so));
 
+   end_phase(so, IR3_PHASE_OPT, &phase_start);
+
    ret = ir3_sched(ir);
    if (ret) {
       DBG("SCHED failed!");
@@ -4895,6 +4913,8 @@ ir3_compile_shader_nir(struct ir3_compiler *compiler,
       }
    }
 
+   end_phase(so, IR3_PHASE_SCHED, &phase_start);
+
    ret = ir3_ra(so);
 
    if (ret) {
@@ -4902,10 +4922,14 @@ ir3_compile_shader_nir(struct ir3_compiler *compiler,
       goto out;
    }
 
+   end_phase(so, IR3_PHASE_RA, &phase_start);
+
    IR3_PASS(ir, ir3_postsched, so);
 
    IR3_PASS(ir, ir3_lower_subgroups);
 
+   end_phase(so, IR3_PHASE_POSTSCHED, &phase_start);
+
    if (so->type == MESA_SHADER_FRAGMENT)
       pack_inlocs(ctx);
 
@@ -4963,6 +4987,8 @@ ir3_compile_shader_nir(struct ir3_compiler *compiler,
     */
    IR3_PASS(ir, ir3_legalize, so, &max_bary);
 
+   end_phase(so, IR3_PHASE_LEGALIZE, &phase_start);
+
    /* Set (ss)(sy) on first TCS and GEOMETRY instructions, since we don't
     * know what we might have to wait on when coming in from VS chsh.
     */
@@ -106,6 +106,45 @@ count_instruction(struct ir3_instruction *n)
           (is_flow(n) && (n->opc != OPC_JUMP) && (n->opc != OPC_B));
 }
 
+/* The number of cycles that issuing an instruction contributes towards
+ * satisfying the delay slots of later consumers.  This is the same accounting
+ * that ir3_delay_calc() uses when walking backwards to insert nop's, so the
+ * schedulers should use it too in order to agree with legalize about when a
+ * value is actually ready.
+ */
+unsigned
+ir3_delay_cycles(struct ir3_instruction *instr)
+{
+   if (!count_instruction(instr))
+      return 0;
+
+   return 1 + instr->repeat + instr->nop;
+}
+
+/* Estimated number of cycles it takes to issue an instruction, used to count
+ * down the soft (ss)/(sy) delays.  Unlike ir3_delay_cycles() every real
+ * instruction counts here, since anything issued while waiting on an sfu or
+ * tex result helps hide its latency.  Pre-RA we also account for the mov's
+ * that a collect of immed/const srcs turns into.
+ */
+unsigned
+ir3_issue_cycles(struct ir3_instruction *instr)
+{
+   if (instr->opc == OPC_META_COLLECT) {
+      /* Assume that only immed/const sources produce moves */
+      unsigned n = 0;
+      foreach_src (src, instr) {
+         if (src->flags & (IR3_REG_IMMED | IR3_REG_CONST))
+            n++;
+      }
+      return n;
+   } else if (is_meta(instr)) {
+      return 0;
+   } else {
+      return 1 + instr->repeat + instr->nop;
+   }
+}
+
 /* Post-RA, we don't have arrays any more, so we have to be a bit careful here
  * and have to handle relative accesses specially.
  */
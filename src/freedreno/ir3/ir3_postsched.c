@@ -115,9 +115,14 @@ schedule(struct ir3_postsched_ctx *ctx, struct ir3_instruction *instr)
 
    di(instr, "schedule");
 
+   /* Only use legalize's cycle accounting with IR3_SHADER_DEBUG=schedlatency,
+    * so that default schedules don't change:
+    */
+   bool latency = ir3_shader_debug & IR3_DBG_SCHEDLATENCY;
    bool counts_for_delay = is_alu(instr) || is_flow(instr);
 
-   unsigned delay_cycles = counts_for_delay ? 1 + instr->repeat : 0;
+   unsigned delay_cycles = latency ? ir3_delay_cycles(instr) :
+                           counts_for_delay ? 1 + instr->repeat : 0;
 
    struct ir3_postsched_node *n = instr->data;
 
@@ -140,12 +145,14 @@ schedule(struct ir3_postsched_ctx *ctx, struct ir3_instruction *instr)
    if (is_meta(instr) && (instr->opc != OPC_META_TEX_PREFETCH))
       return;
 
+   unsigned cycles = latency ? ir3_issue_cycles(instr) : 1;
+
    if (is_ss_producer(instr)) {
       ctx->ss_delay = soft_ss_delay(instr);
    } else if (has_ss_src(instr)) {
       ctx->ss_delay = 0;
    } else if (ctx->ss_delay > 0) {
-      ctx->ss_delay--;
+      ctx->ss_delay -= MIN2(cycles, ctx->ss_delay);
    }
 
    if (is_sy_producer(instr)) {
@@ -153,7 +160,7 @@ schedule(struct ir3_postsched_ctx *ctx, struct ir3_instruction *instr)
    } else if (has_sy_src(instr)) {
       ctx->sy_delay = 0;
    } else if (ctx->sy_delay > 0) {
-      ctx->sy_delay--;
+      ctx->sy_delay -= MIN2(cycles, ctx->sy_delay);
    }
 }
 
@@ -29,6 +29,7 @@
 
 #include "ir3.h"
 #include "ir3_compiler.h"
+#include "ir3_ra.h"
 
 #ifdef DEBUG
 #define SCHED_DEBUG (ir3_shader_debug & IR3_DBG_SCHEDMSGS)
@@ -111,6 +112,16 @@ struct ir3_sched_ctx {
    int sy_delay;
    int ss_delay;
 
+   /* Estimated number of live scalar registers within the current block, and
+    * the number we can have live before we start losing waves.  While below
+    * the budget the scheduler favors hiding latency over reducing pressure.
+    * Only with IR3_SHADER_DEBUG=schedlatency, which also computes the
+    * liveness used to seed the estimate at the start of each block.
+    */
+   int live_regs;
+   int reg_budget;
+   struct ir3_liveness *live;
+
    /* We order the scheduled (sy)/(ss) producers, and keep track of the
     * index of the last waited on instruction, so we can know which
     * instructions are still outstanding (and therefore would require us to
@@ -176,6 +187,7 @@ static void sched_node_init(struct ir3_sched_ctx *ctx,
                             struct ir3_instruction *instr);
 static void sched_node_add_dep(struct ir3_instruction *instr,
                                struct ir3_instruction *src, int i);
+static int live_effect(struct ir3_instruction *instr);
 
 static bool
 is_scheduled(struct ir3_instruction *instr)
@@ -240,9 +252,28 @@ is_outstanding_ss(struct ir3_instruction *instr, struct ir3_sched_ctx *ctx)
    return n->ss_index >= ctx->first_outstanding_ss_index;
 }
 
+/* With IR3_SHADER_DEBUG=schedlatency we use the same cycle accounting as
+ * legalize, otherwise keep the estimates the scheduler has always used so
+ * that default schedules don't change.
+ */
+static unsigned
+delay_cycle_count(struct ir3_instruction *instr)
+{
+   if (ir3_shader_debug & IR3_DBG_SCHEDLATENCY)
+      return ir3_delay_cycles(instr);
+
+   bool counts_for_delay = is_alu(instr) || is_flow(instr);
+
+   /* TODO: switch to "cycles". For now try to match ir3_delay. */
+   return counts_for_delay ? 1 + instr->repeat : 0;
+}
+
 static unsigned
 cycle_count(struct ir3_instruction *instr)
 {
+   if (ir3_shader_debug & IR3_DBG_SCHEDLATENCY)
+      return ir3_issue_cycles(instr);
+
    if (instr->opc == OPC_META_COLLECT) {
       /* Assume that only immed/const sources produce moves */
       unsigned n = 0;
@@ -267,6 +298,11 @@ schedule(struct ir3_sched_ctx *ctx, struct ir3_instruction *instr)
     */
    list_delinit(&instr->node);
 
+   /* Values live in from other blocks and dying in this one aren't counted,
+    * so freeing them can drive the estimate negative:
+    */
+   ctx->live_regs = MAX2(ctx->live_regs + live_effect(instr), 0);
+
    if (writes_addr0(instr)) {
       debug_assert(ctx->addr0 == NULL);
       ctx->addr0 = instr;
@@ -308,10 +344,7 @@ schedule(struct ir3_sched_ctx *ctx, struct ir3_instruction *instr)
       }
    }
 
-   bool counts_for_delay = is_alu(instr) || is_flow(instr);
-
-   /* TODO: switch to "cycles". For now try to match ir3_delay. */
-   unsigned delay_cycles = counts_for_delay ? 1 + instr->repeat : 0;
+   unsigned delay_cycles = delay_cycle_count(instr);
 
    /* We insert any nop's needed to get to earliest_ip, then advance
     * delay_cycles by scheduling the instruction.
@@ -856,6 +889,46 @@ dump_state(struct ir3_sched_ctx *ctx)
    }
 }
 
+/**
+ * While we are below the register budget, additional live values are free
+ * (they don't cost us any waves), so pick the ready instruction on the
+ * longest path to the end of the block, to avoid nop's and keep the critical
+ * path moving.  Once the budget is reached we fall back to the CSR
+ * heuristic in choose_instr_dec()/choose_instr_inc().
+ */
+static struct ir3_sched_node *
+choose_instr_ready(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes)
+{
+   struct ir3_sched_node *chosen = NULL;
+
+   foreach_sched_node (n, &ctx->dag->heads) {
+      if (n->output)
+         continue;
+
+      if (node_delay(ctx, n) > 0)
+         continue;
+
+      if (should_defer(ctx, n->instr))
+         continue;
+
+      if (ctx->live_regs + live_effect(n->instr) > ctx->reg_budget)
+         continue;
+
+      if (!check_instr(ctx, notes, n->instr))
+         continue;
+
+      if (!chosen || chosen->max_delay < n->max_delay)
+         chosen = n;
+   }
+
+   if (chosen) {
+      di(chosen->instr, "ready: chose (live=%d)", ctx->live_regs);
+      return chosen;
+   }
+
+   return NULL;
+}
+
 /* find instruction to schedule: */
 static struct ir3_instruction *
 choose_instr(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes)
@@ -868,6 +941,12 @@ choose_instr(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes)
    if (chosen)
       return chosen->instr;
 
+   if (ctx->live) {
+      chosen = choose_instr_ready(ctx, notes);
+      if (chosen)
+         return chosen->instr;
+   }
+
    chosen = choose_instr_dec(ctx, notes, true);
    if (chosen)
       return chosen->instr;
@@ -1169,9 +1248,30 @@ sched_block(struct ir3_sched_ctx *ctx, struct ir3_block *block)
    ctx->pred = NULL;
    ctx->sy_delay = 0;
    ctx->ss_delay = 0;
+   ctx->live_regs = 0;
    ctx->sy_index = ctx->first_outstanding_sy_index = 0;
    ctx->ss_index = ctx->first_outstanding_ss_index = 0;
 
+   /* Values live through the block hold their registers all along.  Values
+    * live in but dying within the block are left out: live_effect() only
+    * frees sources defined in the same block, so counting them would keep
+    * them live until the end of the block.  Leaving them out under-counts
+    * until their last use instead, which only lets choose_instr_ready()
+    * run a little longer before the CSR heuristic takes over.
+    */
+   if (ctx->live) {
+      unsigned name;
+
+      BITSET_FOREACH_SET (name, ctx->live->live_in[block->index],
+                          ctx->live->definitions_count) {
+         struct ir3_register *def = ctx->live->definitions[name];
+
+         if (BITSET_TEST(ctx->live->live_out[block->index], name) &&
+             !(def->flags & IR3_REG_SHARED))
+            ctx->live_regs += reg_elems(def);
+      }
+   }
+
    /* move all instructions to the unscheduled list, and
     * empty the block's instruction list (to which we will
     * be inserting).
@@ -1271,6 +1371,16 @@ int
 ir3_sched(struct ir3 *ir)
 {
    struct ir3_sched_ctx *ctx = rzalloc(NULL, struct ir3_sched_ctx);
+   const struct ir3_compiler *compiler = ir->compiler;
+
+   /* Number of scalar registers we can use before the register file, rather
+    * than anything else, starts limiting the number of waves:
+    */
+   ctx->reg_budget = compiler->reg_size_vec4 * compiler->wave_granularity /
+                     compiler->max_waves * 4;
+
+   if (ir3_shader_debug & IR3_DBG_SCHEDLATENCY)
+      ctx->live = ir3_calc_liveness(ctx, ir);
 
    foreach_block (block, &ir->block_list) {
       foreach_instr (instr, &block->instr_list) {
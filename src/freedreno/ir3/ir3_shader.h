@@ -498,6 +498,20 @@ struct ir3_disasm_info {
 /* Represents half register in regid */
 #define HALF_REG_ID 0x100
 
+/**
+ * Backend phases of ir3_compile_shader_nir(), see
+ * ir3_shader_variant::phase_times.
+ */
+enum ir3_compile_phase {
+   IR3_PHASE_NIR_TO_IR3,
+   IR3_PHASE_OPT,
+   IR3_PHASE_SCHED,
+   IR3_PHASE_RA,
+   IR3_PHASE_POSTSCHED,
+   IR3_PHASE_LEGALIZE,
+   IR3_PHASE_COUNT,
+};
+
 /**
  * Shader variant which contains the actual hw shader instructions,
  * and necessary info for shader state setup.
@@ -539,6 +553,12 @@ struct ir3_shader_variant {
     */
    void *constant_data;
 
+   /* If non-NULL, ir3_compile_shader_nir() adds the time spent in each
+    * ir3_compile_phase to this array, in nanoseconds.  Used by offline
+    * tools, drivers leave it NULL.
+    */
+   uint64_t *phase_times;
+
    /*
     * Below here is serialized when written to disk cache:
     */
@@ -357,8 +357,24 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
     */
    if (draw_current_shader_position_output(draw) != -1) {
 
+      struct draw_prim_info clip_prim_info;
+      unsigned clip_length;
+
       if (draw_pt_post_vs_run( fpme->post_vs, vert_info, prim_info ))
       {
+         /* If the pipeline is only needed for clipping, try to trivially
+          * accept or reject every primitive instead.
+          */
+         if (!(opt & PT_PIPELINE) &&
+             draw_pt_post_vs_trivial_clip( fpme->post_vs, vert_info,
+                                           prim_info, &clip_prim_info,
+                                           &clip_length )) {
+            if (clip_prim_info.count)
+               emit( fpme->emit, vert_info, &clip_prim_info );
+            FREE((void *)clip_prim_info.elts);
+            goto out;
+         }
+
          opt |= PT_PIPELINE;
       }
 
@@ -371,6 +387,7 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
          emit( fpme->emit, vert_info, prim_info );
       }
    }
+out:
    FREE(vert_info->verts);
    if (free_prim_info) {
       FREE(prim_info->primitive_lengths);
@@ -752,6 +752,23 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                                draw->vs.vertex_shader->info.writes_viewport_index)) {
          clipped = draw_pt_post_vs_run( fpme->post_vs, vert_info, prim_info );
       }
+      /* If the pipeline is only needed for clipping, try to trivially
+       * accept or reject every primitive instead.
+       */
+      if (clipped && !(opt & PT_PIPELINE)) {
+         struct draw_prim_info clip_prim_info;
+         unsigned clip_length;
+
+         if (draw_pt_post_vs_trivial_clip(fpme->post_vs, vert_info,
+                                          prim_info, &clip_prim_info,
+                                          &clip_length)) {
+            if (clip_prim_info.count)
+               emit( fpme->emit, vert_info, &clip_prim_info );
+            FREE((void *)clip_prim_info.elts);
+            goto out;
+         }
+      }
+
       /* "clipped" also includes non-one edgeflag */
       if (clipped) {
          opt |= PT_PIPELINE;
@@ -217,6 +217,163 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
 }
 
 
+/*
+ * Trivial clipping: when the pipeline would only be run for clipping,
+ * sort every primitive of the batch into trivially accepted (no vertex
+ * outside any plane) or trivially rejected (all vertices outside the same
+ * plane), using the clipmasks computed by the cliptest.  If that settles
+ * every primitive, the accepted ones are emitted directly as a list of
+ * points, lines or triangles, in the same order the clip stage would have
+ * passed them on.
+ */
+struct trivial_clip {
+   const char *verts;
+   unsigned stride;
+   ushort *elts;
+   unsigned count;
+   boolean need_clip;
+};
+
+static inline void
+trivial_clip_prim(struct trivial_clip *tc, unsigned i0, unsigned i1,
+                  unsigned i2, unsigned nr)
+{
+   const unsigned idx[3] = { i0, i1, i2 };
+   unsigned or_mask = 0, and_mask = ~0u;
+   unsigned i;
+
+   for (i = 0; i < nr; i++) {
+      const struct vertex_header *v = (const struct vertex_header *)
+         (tc->verts + tc->stride * idx[i]);
+      or_mask |= v->clipmask;
+      and_mask &= v->clipmask;
+   }
+
+   if (or_mask == 0) {
+      for (i = 0; i < nr; i++)
+         tc->elts[tc->count++] = (ushort) idx[i];
+   }
+   else if (and_mask == 0 || nr == 1) {
+      /* Points aren't rejected here, the clip stage may still draw them
+       * with guard band clipping.
+       */
+      tc->need_clip = TRUE;
+   }
+}
+
+#define TRIANGLE(flags, i0, i1, i2) trivial_clip_prim(tc, i0, i1, i2, 3)
+#define LINE(flags, i0, i1)         trivial_clip_prim(tc, i0, i1, 0, 2)
+#define POINT(i0)                   trivial_clip_prim(tc, i0, 0, 0, 1)
+#define GET_ELT(idx)                (MIN2(elts[idx], max_index))
+
+#define FUNC trivial_clip_elts
+#define FUNC_VARS                               \
+    struct draw_context *draw,                  \
+    struct trivial_clip *tc,                    \
+    unsigned prim,                              \
+    unsigned prim_flags,                        \
+    struct vertex_header *vertices,             \
+    const ushort *elts,                         \
+    unsigned count,                             \
+    unsigned max_index
+
+#include "draw_pt_decompose.h"
+
+#define TRIANGLE(flags, i0, i1, i2) trivial_clip_prim(tc, i0, i1, i2, 3)
+#define LINE(flags, i0, i1)         trivial_clip_prim(tc, i0, i1, 0, 2)
+#define POINT(i0)                   trivial_clip_prim(tc, i0, 0, 0, 1)
+#define GET_ELT(idx)                (start + (idx))
+
+#define FUNC trivial_clip_linear
+#define FUNC_VARS                               \
+    struct draw_context *draw,                  \
+    struct trivial_clip *tc,                    \
+    unsigned prim,                              \
+    unsigned prim_flags,                        \
+    struct vertex_header *vertices,             \
+    unsigned start,                             \
+    unsigned count
+
+#include "draw_pt_decompose.h"
+
+
+/**
+ * Try to resolve clipping of a batch without running the draw pipeline.
+ *
+ * \return TRUE if every primitive was trivially accepted or rejected.  In
+ * that case \p out_prim_info describes the accepted primitives and its
+ * elts must be freed by the caller.
+ */
+boolean
+draw_pt_post_vs_trivial_clip(struct pt_post_vs *pvs,
+                             const struct draw_vertex_info *info,
+                             const struct draw_prim_info *prim_info,
+                             struct draw_prim_info *out_prim_info,
+                             unsigned *out_length)
+{
+   struct draw_context *draw = pvs->draw;
+   struct trivial_clip tc;
+   unsigned i, start, total = 0;
+
+   /* "clipped" also covers non-one edgeflags, which need the pipeline. */
+   if (pvs->flags & DO_EDGEFLAG)
+      return FALSE;
+
+   if (prim_info->prim == PIPE_PRIM_PATCHES)
+      return FALSE;
+
+   for (i = 0; i < prim_info->primitive_count; i++)
+      total += prim_info->primitive_lengths[i];
+
+   /* Decomposing never produces more than 3 elements per input vertex
+    * (quad strips), and the emit path takes ushort elements.
+    */
+   if (info->count == 0 || info->count > 65535 || total == 0)
+      return FALSE;
+
+   tc.verts = (const char *) info->verts;
+   tc.stride = info->stride;
+   tc.elts = MALLOC(3 * total * sizeof(ushort));
+   tc.count = 0;
+   tc.need_clip = FALSE;
+
+   if (!tc.elts)
+      return FALSE;
+
+   for (start = i = 0;
+        i < prim_info->primitive_count && !tc.need_clip;
+        start += prim_info->primitive_lengths[i], i++) {
+      const unsigned count = prim_info->primitive_lengths[i];
+
+      if (prim_info->linear)
+         trivial_clip_linear(draw, &tc, prim_info->prim, prim_info->flags,
+                             info->verts, start, count);
+      else
+         trivial_clip_elts(draw, &tc, prim_info->prim, prim_info->flags,
+                           info->verts, prim_info->elts + start, count,
+                           info->count - 1);
+   }
+
+   if (tc.need_clip) {
+      FREE(tc.elts);
+      return FALSE;
+   }
+
+   *out_length = tc.count;
+
+   memset(out_prim_info, 0, sizeof(*out_prim_info));
+   out_prim_info->linear = FALSE;
+   out_prim_info->start = 0;
+   out_prim_info->count = tc.count;
+   out_prim_info->elts = tc.elts;
+   out_prim_info->prim = u_reduced_prim(prim_info->prim);
+   out_prim_info->primitive_count = 1;
+   out_prim_info->primitive_lengths = out_length;
+
+   return TRUE;
+}
+
+
 struct pt_post_vs *draw_pt_post_vs_create( struct draw_context *draw )
 {
    struct pt_post_vs *pvs = CALLOC_STRUCT( pt_post_vs );
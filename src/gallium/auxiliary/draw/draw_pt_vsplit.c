@@ -23,6 +23,10 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
@@ -31,11 +35,16 @@
 #include "draw/draw_pt.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/* The fetch cache is set-associative and can hold a whole segment. */
+#define CACHE_SETS   256
+#define CACHE_WAYS   4
 
 /* The largest possible index within an index buffer */
 #define MAX_ELT_IDX 0xffffffff
 
+DEBUG_GET_ONCE_BOOL_OPTION(draw_vsplit_stats, "DRAW_VSPLIT_STATS", FALSE)
+
 struct vsplit_frontend {
    struct draw_pt_front_end base;
    struct draw_context *draw;
@@ -54,21 +63,42 @@ struct vsplit_frontend {
 
    struct {
       /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      unsigned fetches[CACHE_SETS][CACHE_WAYS];
+      ushort draws[CACHE_SETS][CACHE_WAYS];
+
+      /* Number of insertions into each set, wrapped to stay below
+       * 2 * CACHE_WAYS.  The ways in use are [0, MIN2(count, CACHE_WAYS))
+       * and the next way to replace is count % CACHE_WAYS.
+       */
+      ubyte count[CACHE_SETS];
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
    } cache;
+
+   /* Number of vertices sent to the middle end for shading, for
+    * DRAW_VSPLIT_STATS.
+    */
+   unsigned num_fetched;
+
+   /* DRAW_VSPLIT_STATS totals over the indexed draws, printed at destroy. */
+   struct {
+      uint64_t draws;
+      uint64_t indices;
+      uint64_t unique;
+      uint64_t shaded;
+   } stats;
+
+   /* The run function wrapped by vsplit_run_stats. */
+   void (*run)(struct draw_pt_front_end *frontend,
+               unsigned start, unsigned count);
 };
 
 
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   memset(vsplit->cache.count, 0, sizeof(vsplit->cache.count));
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -76,6 +106,7 @@ vsplit_clear_cache(struct vsplit_frontend *vsplit)
 static void
 vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 {
+   vsplit->num_fetched += vsplit->cache.num_fetch_elts;
    vsplit->middle->run(vsplit->middle,
          vsplit->fetch_elts, vsplit->cache.num_fetch_elts,
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
@@ -87,23 +118,34 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static inline void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch)
 {
-   unsigned hash;
-
-   hash = fetch % MAP_SIZE;
+   /* Fold the high bits in so that large strides don't all land in the same
+    * set.
+    */
+   const unsigned set = (fetch ^ (fetch >> 8)) % CACHE_SETS;
+   const unsigned count = vsplit->cache.count[set];
+   const unsigned num_ways = MIN2(count, CACHE_WAYS);
+   unsigned way;
+
+   for (way = 0; way < num_ways; way++) {
+      if (vsplit->cache.fetches[set][way] == fetch)
+         break;
+   }
 
-   /* If the value isn't in the cache or it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   if (way == num_ways) {
+      /* not in the cache, replace the oldest way */
+      way = count % CACHE_WAYS;
+      vsplit->cache.fetches[set][way] = fetch;
+      vsplit->cache.draws[set][way] = vsplit->cache.num_fetch_elts;
+      vsplit->cache.count[set] =
+         count + 1 < 2 * CACHE_WAYS ? count + 1 : CACHE_WAYS;
 
       /* add fetch */
       assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
       vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
    }
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+      vsplit->cache.draws[set][way];
 }
 
 /**
@@ -125,12 +167,6 @@ vsplit_add_cache_ubyte(struct vsplit_frontend *vsplit, const ubyte *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -142,12 +178,6 @@ vsplit_add_cache_ushort(struct vsplit_frontend *vsplit, const ushort *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -167,13 +197,6 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
     */
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* Take care for DRAW_MAX_FETCH_IDX (since cache is initialized to -1). */
-   if (elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      /* force update - any value will do except DRAW_MAX_FETCH_IDX */
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -197,6 +220,86 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
 #include "draw_pt_vsplit_tmp.h"
 
 
+static int
+compare_uint(const void *a, const void *b)
+{
+   unsigned ua = *(const unsigned *) a, ub = *(const unsigned *) b;
+
+   return ua < ub ? -1 : ua > ub;
+}
+
+
+/**
+ * Count the distinct vertices fetched by an indexed draw, that is indices
+ * with the element bias applied the same way vsplit_add_cache_*() does.
+ * Primitive restart indices never get here: draw_pt_arrays_restart() splits
+ * the draw around them before calling the front end.
+ */
+static unsigned
+vsplit_count_unique(struct vsplit_frontend *vsplit,
+                    unsigned start, unsigned count)
+{
+   struct draw_context *draw = vsplit->draw;
+   unsigned *indices = MALLOC(count * sizeof(unsigned));
+   unsigned i, num_unique = 0;
+
+   if (!indices)
+      return 0;
+
+   for (i = 0; i < count; i++) {
+      unsigned elt_idx = vsplit_get_base_idx(start, i);
+      unsigned idx;
+
+      switch (draw->pt.user.eltSize) {
+      case 1:
+         idx = DRAW_GET_IDX((const ubyte *) draw->pt.user.elts, elt_idx);
+         break;
+      case 2:
+         idx = DRAW_GET_IDX((const ushort *) draw->pt.user.elts, elt_idx);
+         break;
+      default:
+         idx = DRAW_GET_IDX((const uint *) draw->pt.user.elts, elt_idx);
+         break;
+      }
+
+      indices[i] = (unsigned)((int) idx + draw->pt.user.eltBias);
+   }
+
+   qsort(indices, count, sizeof(unsigned), compare_uint);
+
+   for (i = 0; i < count; i++) {
+      if (i == 0 || indices[i] != indices[i - 1])
+         num_unique++;
+   }
+
+   FREE(indices);
+   return num_unique;
+}
+
+
+/**
+ * Accumulate how many vertices were shaded for the indexed draws compared
+ * to the number of distinct vertices they use.
+ */
+static void
+vsplit_run_stats(struct draw_pt_front_end *frontend,
+                 unsigned start, unsigned count)
+{
+   struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+
+   vsplit->num_fetched = 0;
+   vsplit->run(frontend, start, count);
+
+   if (!count)
+      return;
+
+   vsplit->stats.draws++;
+   vsplit->stats.indices += count;
+   vsplit->stats.unique += vsplit_count_unique(vsplit, start, count);
+   vsplit->stats.shaded += vsplit->num_fetched;
+}
+
+
 static void vsplit_prepare(struct draw_pt_front_end *frontend,
                            unsigned in_prim,
                            struct draw_pt_middle_end *middle,
@@ -222,6 +325,11 @@ static void vsplit_prepare(struct draw_pt_front_end *frontend,
       break;
    }
 
+   if (vsplit->draw->pt.user.eltSize && debug_get_option_draw_vsplit_stats()) {
+      vsplit->run = vsplit->base.run;
+      vsplit->base.run = vsplit_run_stats;
+   }
+
    /* split only */
    vsplit->prim = in_prim;
 
@@ -245,6 +353,18 @@ static void vsplit_flush(struct draw_pt_front_end *frontend, unsigned flags)
 
 static void vsplit_destroy(struct draw_pt_front_end *frontend)
 {
+   struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+
+   if (vsplit->stats.draws) {
+      debug_printf("vsplit: %" PRIu64 " indexed draws, %" PRIu64 " indices, "
+                   "%" PRIu64 " unique, %" PRIu64 " shaded "
+                   "(%.2f per unique vertex)\n",
+                   vsplit->stats.draws, vsplit->stats.indices,
+                   vsplit->stats.unique, vsplit->stats.shaded,
+                   vsplit->stats.unique ?
+                   (double) vsplit->stats.shaded / vsplit->stats.unique : 0.0);
+   }
+
    FREE(frontend);
 }
 
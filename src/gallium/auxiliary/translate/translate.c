@@ -32,20 +32,43 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_state.h"
+#include "util/u_debug.h"
 #include "translate.h"
 
+#ifdef DRAW_LLVM_AVAILABLE
+DEBUG_GET_ONCE_BOOL_OPTION(translate_use_llvm, "TRANSLATE_USE_LLVM", FALSE)
+#endif
+
 struct translate *translate_create( const struct translate_key *key )
 {
    struct translate *translate = NULL;
 
+#ifdef DRAW_LLVM_AVAILABLE
+   /* The gallivm path processes a full native vector of vertices per
+    * iteration, which beats the single-vertex SSE code on wider hosts.
+    */
+   if (debug_get_option_translate_use_llvm()) {
+      translate = translate_llvm_create( key );
+      if (translate)
+         return translate;
+   }
+#endif
+
 #if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
    translate = translate_sse2_create( key );
    if (translate)
       return translate;
-#else
-   (void)translate;
 #endif
 
+#ifdef DRAW_LLVM_AVAILABLE
+   if (!debug_get_option_translate_use_llvm()) {
+      translate = translate_llvm_create( key );
+      if (translate)
+         return translate;
+   }
+#endif
+
+   (void)translate;
    return translate_generic_create( key );
 }
 
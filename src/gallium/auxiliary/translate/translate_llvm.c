@@ -0,0 +1,776 @@
+/*
+ * Copyright 2022 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.  IN NO EVENT SHALL
+ * VMWARE AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * Vertex translation built on gallivm.
+ *
+ * Unlike translate_sse, which emits one vertex at a time with hand-written
+ * SSE, this processes lp_native_vector_width / 32 vertices per iteration:
+ * indices are gathered as a vector, every element is fetched with the SoA
+ * format code shared with the draw llvm path (so any input format the
+ * vertex shader can fetch works here too), and the converted vertices are
+ * written back out one at a time.
+ *
+ * Output formats are restricted to plain array formats with 8, 16 or 32 bit
+ * channels; anything else makes translate_llvm_create() fail so the caller
+ * falls back to translate_generic.
+ */
+
+#include "pipe/p_compiler.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/format/u_format.h"
+
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_conv.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_gather.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_intr.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "translate.h"
+
+
+struct translate_llvm_buffer
+{
+   const uint8_t *base_ptr;
+   uint32_t stride;
+   uint32_t max_index;
+};
+
+enum {
+   TRANSLATE_LLVM_BUFFER_BASE_PTR = 0,
+   TRANSLATE_LLVM_BUFFER_STRIDE,
+   TRANSLATE_LLVM_BUFFER_MAX_INDEX,
+   TRANSLATE_LLVM_BUFFER_NUM_FIELDS
+};
+
+typedef void
+(*translate_llvm_func)(const struct translate_llvm_buffer *buffers,
+                       const void *elts,
+                       uint32_t start,
+                       uint32_t count,
+                       uint32_t start_instance,
+                       uint32_t instance_id,
+                       void *output_buffer);
+
+/* Index source of the generated functions, which differ only in how the
+ * vertex indices are obtained.
+ */
+enum translate_llvm_elts {
+   TRANSLATE_LLVM_LINEAR = 0,
+   TRANSLATE_LLVM_ELTS8,
+   TRANSLATE_LLVM_ELTS16,
+   TRANSLATE_LLVM_ELTS32,
+   TRANSLATE_LLVM_NUM_FUNCS
+};
+
+struct translate_llvm
+{
+   struct translate translate;
+
+   struct translate_llvm_buffer buffer[TRANSLATE_MAX_ATTRIBS];
+   unsigned nr_buffers;
+
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   translate_llvm_func func[TRANSLATE_LLVM_NUM_FUNCS];
+};
+
+
+static inline struct translate_llvm *
+translate_llvm(struct translate *translate)
+{
+   return (struct translate_llvm *)translate;
+}
+
+
+/**
+ * Whether the output format of an element can be packed by
+ * emit_element_vertex(): a plain array format whose channels all share one
+ * 8, 16 or 32 bit type.
+ */
+static boolean
+output_format_supported(const struct util_format_description *desc)
+{
+   const struct util_format_channel_description *chan = &desc->channel[0];
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       !desc->is_array)
+      return FALSE;
+
+   for (i = 1; i < desc->nr_channels; i++) {
+      if (desc->channel[i].type != chan->type ||
+          desc->channel[i].size != chan->size ||
+          desc->channel[i].normalized != chan->normalized ||
+          desc->channel[i].pure_integer != chan->pure_integer)
+         return FALSE;
+   }
+
+   switch (chan->type) {
+   case UTIL_FORMAT_TYPE_FLOAT:
+      return chan->size == 16 || chan->size == 32;
+   case UTIL_FORMAT_TYPE_UNSIGNED:
+   case UTIL_FORMAT_TYPE_SIGNED:
+      if (chan->normalized)
+         return chan->size == 8 || chan->size == 16;
+      return chan->size == 8 || chan->size == 16 || chan->size == 32;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Convert one channel of fetched SoA data to the output channel type,
+ * returning a vector of type.length elements of chan->size bits.
+ */
+static LLVMValueRef
+convert_channel(struct gallivm_state *gallivm,
+                struct lp_type type,
+                const struct util_format_channel_description *chan,
+                LLVMValueRef src)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type int_type = lp_int_type(type);
+   LLVMTypeRef dst_type =
+      LLVMVectorType(LLVMIntTypeInContext(gallivm->context, chan->size),
+                     type.length);
+   struct lp_build_context bld;
+   LLVMValueRef res;
+
+   if (chan->pure_integer) {
+      /* fetched with an integer type already */
+      res = src;
+   } else if (chan->type == UTIL_FORMAT_TYPE_FLOAT) {
+      if (chan->size == 16)
+         return lp_build_float_to_half(gallivm, src);
+      return src;
+   } else {
+      lp_build_context_init(&bld, gallivm, type);
+
+      if (chan->normalized && chan->type == UTIL_FORMAT_TYPE_UNSIGNED) {
+         src = lp_build_clamp_zero_one_nanzero(&bld, src);
+         res = lp_build_clamped_float_to_unsigned_norm(gallivm, type,
+                                                       chan->size, src);
+      } else if (chan->normalized) {
+         double scale = (double)((1 << (chan->size - 1)) - 1);
+         src = lp_build_clamp(&bld, src,
+                              lp_build_const_vec(gallivm, type, -1.0),
+                              bld.one);
+         src = lp_build_mul(&bld, src,
+                            lp_build_const_vec(gallivm, type, scale));
+         res = lp_build_iround(&bld, src);
+      } else if (chan->type == UTIL_FORMAT_TYPE_UNSIGNED) {
+         res = LLVMBuildFPToUI(builder, src,
+                               lp_build_int_vec_type(gallivm, int_type), "");
+      } else {
+         res = LLVMBuildFPToSI(builder, src,
+                               lp_build_int_vec_type(gallivm, int_type), "");
+      }
+   }
+
+   if (chan->size < 32)
+      res = LLVMBuildTrunc(builder, res, dst_type, "");
+   return res;
+}
+
+
+/**
+ * Load a member of buffers[buf].
+ */
+static LLVMValueRef
+load_buffer_member(struct gallivm_state *gallivm,
+                   LLVMTypeRef buffer_type,
+                   LLVMValueRef buffers_ptr,
+                   unsigned buf,
+                   unsigned member,
+                   const char *name)
+{
+   LLVMValueRef indices[2];
+   LLVMValueRef ptr;
+
+   indices[0] = lp_build_const_int32(gallivm, buf);
+   indices[1] = lp_build_const_int32(gallivm, member);
+   ptr = LLVMBuildGEP2(gallivm->builder, buffer_type, buffers_ptr,
+                       indices, 2, "");
+   return LLVMBuildLoad2(gallivm->builder,
+                         LLVMStructGetTypeAtIndex(buffer_type, member),
+                         ptr, name);
+}
+
+
+/**
+ * Per-element state computed once per batch of vertices.
+ */
+struct translate_llvm_element
+{
+   /* Converted channels, or NULL for a raw copy / instance id. */
+   LLVMValueRef chan[4];
+   /* Per-lane source byte offsets, for raw copies. */
+   LLVMValueRef src_offsets;
+   LLVMValueRef base_ptr;
+   unsigned nr_chans;
+   boolean copy;
+};
+
+
+/**
+ * Store one element of the vertex in lane 'lane' to vertex_ptr.
+ */
+static void
+emit_element_vertex(struct gallivm_state *gallivm,
+                    const struct translate_element *elem,
+                    const struct translate_llvm_element *e,
+                    LLVMValueRef instance_id,
+                    unsigned lane,
+                    LLVMValueRef vertex_ptr)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMContextRef context = gallivm->context;
+   LLVMTypeRef int8_type = LLVMInt8TypeInContext(context);
+   LLVMValueRef lane_idx = lp_build_const_int32(gallivm, lane);
+   LLVMValueRef offset = lp_build_const_int32(gallivm, elem->output_offset);
+   LLVMValueRef dst_ptr, value;
+   LLVMTypeRef value_type;
+
+   dst_ptr = LLVMBuildGEP2(builder, int8_type, vertex_ptr, &offset, 1, "");
+
+   if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+      value = instance_id;
+   } else if (e->copy) {
+      const struct util_format_description *desc =
+         util_format_description(elem->input_format);
+      LLVMValueRef src_ptr;
+
+      value_type = LLVMArrayType(int8_type, desc->block.bits / 8);
+      offset = LLVMBuildExtractElement(builder, e->src_offsets, lane_idx, "");
+      src_ptr = LLVMBuildGEP2(builder, int8_type, e->base_ptr, &offset, 1, "");
+      src_ptr = LLVMBuildBitCast(builder, src_ptr,
+                                 LLVMPointerType(value_type, 0), "");
+      value = LLVMBuildLoad2(builder, value_type, src_ptr, "");
+      LLVMSetAlignment(value, 1);
+   } else if (e->nr_chans == 1) {
+      value = LLVMBuildExtractElement(builder, e->chan[0], lane_idx, "");
+   } else {
+      unsigned c;
+
+      value_type = LLVMVectorType(LLVMGetElementType(LLVMTypeOf(e->chan[0])),
+                                  e->nr_chans);
+      value = LLVMGetUndef(value_type);
+      for (c = 0; c < e->nr_chans; c++) {
+         LLVMValueRef tmp =
+            LLVMBuildExtractElement(builder, e->chan[c], lane_idx, "");
+         value = LLVMBuildInsertElement(builder, value, tmp,
+                                        lp_build_const_int32(gallivm, c), "");
+      }
+   }
+
+   dst_ptr = LLVMBuildBitCast(builder, dst_ptr,
+                              LLVMPointerType(LLVMTypeOf(value), 0), "");
+   LLVMSetAlignment(LLVMBuildStore(builder, value, dst_ptr), 1);
+}
+
+
+/**
+ * Fetch and convert one element for all lanes of the current batch.
+ */
+static void
+fetch_element(struct gallivm_state *gallivm,
+              struct lp_type type,
+              const struct translate_element *elem,
+              LLVMTypeRef buffer_type,
+              LLVMValueRef buffers_ptr,
+              LLVMValueRef indices,
+              LLVMValueRef start_instance,
+              LLVMValueRef instance_id,
+              struct translate_llvm_element *e)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct util_format_description *in_desc =
+      util_format_description(elem->input_format);
+   const struct util_format_description *out_desc =
+      util_format_description(elem->output_format);
+   struct lp_type uint_type = lp_uint_type(type);
+   struct lp_type fetch_type = type;
+   struct lp_build_context blduivec;
+   LLVMValueRef base_ptr, stride, max_index, offsets;
+   LLVMValueRef rgba[4];
+   unsigned c;
+
+   memset(e, 0, sizeof *e);
+   if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID)
+      return;
+
+   lp_build_context_init(&blduivec, gallivm, uint_type);
+
+   base_ptr = load_buffer_member(gallivm, buffer_type, buffers_ptr,
+                                 elem->input_buffer,
+                                 TRANSLATE_LLVM_BUFFER_BASE_PTR, "base_ptr");
+   stride = load_buffer_member(gallivm, buffer_type, buffers_ptr,
+                               elem->input_buffer,
+                               TRANSLATE_LLVM_BUFFER_STRIDE, "stride");
+   max_index = load_buffer_member(gallivm, buffer_type, buffers_ptr,
+                                  elem->input_buffer,
+                                  TRANSLATE_LLVM_BUFFER_MAX_INDEX, "max_index");
+
+   if (elem->instance_divisor) {
+      LLVMValueRef index =
+         LLVMBuildUDiv(builder, instance_id,
+                       lp_build_const_int32(gallivm, elem->instance_divisor),
+                       "");
+      index = LLVMBuildAdd(builder, start_instance, index, "");
+      indices = lp_build_broadcast_scalar(&blduivec, index);
+   } else {
+      /* clamp to avoid going out of bounds */
+      indices = lp_build_min(&blduivec, indices,
+                             lp_build_broadcast_scalar(&blduivec, max_index));
+   }
+
+   /* This mul can overflow. Wraparound is ok, as in translate_generic. */
+   offsets = lp_build_mul(&blduivec, indices,
+                          lp_build_broadcast_scalar(&blduivec, stride));
+   offsets = lp_build_add(&blduivec, offsets,
+                          lp_build_const_int_vec(gallivm, uint_type,
+                                                 elem->input_offset));
+
+   if (elem->input_format == elem->output_format) {
+      e->copy = TRUE;
+      e->base_ptr = base_ptr;
+      e->src_offsets = offsets;
+      return;
+   }
+
+   if (in_desc->channel[0].pure_integer) {
+      if (in_desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED)
+         fetch_type = lp_int_type(type);
+      else
+         fetch_type = uint_type;
+   }
+
+   lp_build_fetch_rgba_soa(gallivm, in_desc, fetch_type, FALSE,
+                           base_ptr, offsets,
+                           blduivec.zero, blduivec.zero,
+                           NULL, rgba);
+
+   e->nr_chans = out_desc->nr_channels;
+   for (c = 0; c < out_desc->nr_channels; c++) {
+      unsigned swz;
+
+      /* output channel c receives the rgba component that swizzles to it */
+      for (swz = 0; swz < 4; swz++) {
+         if (out_desc->swizzle[swz] == c)
+            break;
+      }
+      e->chan[c] = convert_channel(gallivm, fetch_type,
+                                   &out_desc->channel[c],
+                                   swz < 4 ? rgba[swz] :
+                                   lp_build_zero(gallivm, fetch_type));
+   }
+}
+
+
+static LLVMValueRef
+create_function(struct translate_llvm *tl,
+                enum translate_llvm_elts elts_kind)
+{
+   static const char *names[TRANSLATE_LLVM_NUM_FUNCS] = {
+      "translate_linear",
+      "translate_elts8",
+      "translate_elts16",
+      "translate_elts32",
+   };
+   const struct translate_key *key = &tl->translate.key;
+   struct gallivm_state *gallivm = tl->gallivm;
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTargetDataRef target = gallivm->target;
+   LLVMTypeRef int8_ptr_type =
+      LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(context);
+   LLVMTypeRef buffer_types[TRANSLATE_LLVM_BUFFER_NUM_FIELDS];
+   LLVMTypeRef buffer_type, arg_types[7], func_type;
+   LLVMValueRef func, buffers_ptr, elts_ptr, start, count;
+   LLVMValueRef start_instance, instance_id, output_ptr;
+   LLVMValueRef lanes, count_vec, step;
+   struct translate_llvm_element elems[TRANSLATE_MAX_ATTRIBS];
+   struct lp_build_for_loop_state loop;
+   struct lp_build_context blduivec;
+   struct lp_type type;
+   const unsigned vector_length = lp_native_vector_width / 32;
+   unsigned i, j;
+
+   type = lp_type_float_vec(32, vector_length * 32);
+   lp_build_context_init(&blduivec, gallivm, lp_uint_type(type));
+
+   buffer_types[TRANSLATE_LLVM_BUFFER_BASE_PTR] = int8_ptr_type;
+   buffer_types[TRANSLATE_LLVM_BUFFER_STRIDE] = int32_type;
+   buffer_types[TRANSLATE_LLVM_BUFFER_MAX_INDEX] = int32_type;
+   buffer_type = LLVMStructTypeInContext(context, buffer_types,
+                                         ARRAY_SIZE(buffer_types), 0);
+
+   (void) target; /* silence unused var warning for non-debug build */
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, base_ptr,
+                          target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_BASE_PTR);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, stride,
+                          target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_STRIDE);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, max_index,
+                          target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_MAX_INDEX);
+   LP_CHECK_STRUCT_SIZE(struct translate_llvm_buffer, target, buffer_type);
+
+   arg_types[0] = LLVMPointerType(buffer_type, 0);   /* buffers */
+   arg_types[1] = int8_ptr_type;                     /* elts */
+   arg_types[2] = int32_type;                        /* start */
+   arg_types[3] = int32_type;                        /* count */
+   arg_types[4] = int32_type;                        /* start_instance */
+   arg_types[5] = int32_type;                        /* instance_id */
+   arg_types[6] = int8_ptr_type;                     /* output */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+   func = LLVMAddFunction(gallivm->module, names[elts_kind], func_type);
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   for (i = 0; i < ARRAY_SIZE(arg_types); ++i) {
+      if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind)
+         lp_add_function_attr(func, i + 1, LP_FUNC_ATTR_NOALIAS);
+   }
+
+   buffers_ptr = LLVMGetParam(func, 0);
+   elts_ptr = LLVMGetParam(func, 1);
+   start = LLVMGetParam(func, 2);
+   count = LLVMGetParam(func, 3);
+   start_instance = LLVMGetParam(func, 4);
+   instance_id = LLVMGetParam(func, 5);
+   output_ptr = LLVMGetParam(func, 6);
+
+   LLVMPositionBuilderAtEnd(builder,
+                            LLVMAppendBasicBlockInContext(context, func,
+                                                          "entry"));
+
+   lanes = blduivec.undef;
+   for (i = 0; i < vector_length; i++) {
+      lanes = LLVMBuildInsertElement(builder, lanes,
+                                     lp_build_const_int32(gallivm, i),
+                                     lp_build_const_int32(gallivm, i), "");
+   }
+   count_vec = lp_build_broadcast_scalar(&blduivec, count);
+   step = lp_build_const_int32(gallivm, vector_length);
+
+   lp_build_for_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0),
+                           LLVMIntULT, count, step);
+   {
+      LLVMValueRef lane_index, indices;
+      LLVMValueRef remaining;
+
+      lane_index = lp_build_add(&blduivec, lanes,
+                                lp_build_broadcast_scalar(&blduivec,
+                                                          loop.counter));
+
+      /* lanes past the end redo the last vertex, so that neither the
+       * index buffer nor the vertex buffers are read out of bounds
+       */
+      lane_index = lp_build_min(&blduivec, lane_index,
+                                lp_build_sub(&blduivec, count_vec,
+                                             blduivec.one));
+
+      if (elts_kind == TRANSLATE_LLVM_LINEAR) {
+         indices = lp_build_add(&blduivec, lane_index,
+                                lp_build_broadcast_scalar(&blduivec, start));
+      } else {
+         unsigned elt_bits = elts_kind == TRANSLATE_LLVM_ELTS8 ? 8 :
+                             elts_kind == TRANSLATE_LLVM_ELTS16 ? 16 : 32;
+         LLVMValueRef offsets;
+
+         offsets = lp_build_mul_imm(&blduivec, lane_index, elt_bits / 8);
+         indices = lp_build_gather(gallivm, vector_length, elt_bits,
+                                   blduivec.type, FALSE, elts_ptr, offsets,
+                                   FALSE);
+      }
+
+      for (j = 0; j < key->nr_elements; j++) {
+         fetch_element(gallivm, type, &key->element[j],
+                       buffer_type, buffers_ptr,
+                       indices, start_instance, instance_id, &elems[j]);
+      }
+
+      remaining = LLVMBuildSub(builder, count, loop.counter, "remaining");
+
+      for (i = 0; i < vector_length; i++) {
+         struct lp_build_if_state if_ctx;
+         LLVMValueRef vertex_ptr, cond;
+
+         /* lane 0 is always in range */
+         if (i > 0) {
+            cond = LLVMBuildICmp(builder, LLVMIntUGT, remaining,
+                                 lp_build_const_int32(gallivm, i), "");
+            lp_build_if(&if_ctx, gallivm, cond);
+         }
+
+         vertex_ptr = LLVMBuildMul(builder,
+                                   LLVMBuildAdd(builder, loop.counter,
+                                                lp_build_const_int32(gallivm, i),
+                                                ""),
+                                   lp_build_const_int32(gallivm,
+                                                        key->output_stride),
+                                   "");
+         vertex_ptr = LLVMBuildGEP2(builder, LLVMInt8TypeInContext(context),
+                                    output_ptr, &vertex_ptr, 1, "");
+
+         for (j = 0; j < key->nr_elements; j++) {
+            emit_element_vertex(gallivm, &key->element[j], &elems[j],
+                                instance_id, i, vertex_ptr);
+         }
+
+         if (i > 0)
+            lp_build_endif(&if_ctx);
+      }
+   }
+   lp_build_for_loop_end(&loop);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+static void PIPE_CDECL
+llvm_run_elts(struct translate *translate,
+              const unsigned *elts,
+              unsigned count,
+              unsigned start_instance,
+              unsigned instance_id,
+              void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->func[TRANSLATE_LLVM_ELTS32](tl->buffer, elts, 0, count,
+                                   start_instance, instance_id,
+                                   output_buffer);
+}
+
+static void PIPE_CDECL
+llvm_run_elts16(struct translate *translate,
+                const uint16_t *elts,
+                unsigned count,
+                unsigned start_instance,
+                unsigned instance_id,
+                void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->func[TRANSLATE_LLVM_ELTS16](tl->buffer, elts, 0, count,
+                                   start_instance, instance_id,
+                                   output_buffer);
+}
+
+static void PIPE_CDECL
+llvm_run_elts8(struct translate *translate,
+               const uint8_t *elts,
+               unsigned count,
+               unsigned start_instance,
+               unsigned instance_id,
+               void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->func[TRANSLATE_LLVM_ELTS8](tl->buffer, elts, 0, count,
+                                  start_instance, instance_id,
+                                  output_buffer);
+}
+
+static void PIPE_CDECL
+llvm_run(struct translate *translate,
+         unsigned start,
+         unsigned count,
+         unsigned start_instance,
+         unsigned instance_id,
+         void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->func[TRANSLATE_LLVM_LINEAR](tl->buffer, NULL, start, count,
+                                   start_instance, instance_id,
+                                   output_buffer);
+}
+
+
+static void
+llvm_set_buffer(struct translate *translate,
+                unsigned buf,
+                const void *ptr,
+                unsigned stride,
+                unsigned max_index)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   if (buf < tl->nr_buffers) {
+      tl->buffer[buf].base_ptr = ptr;
+      tl->buffer[buf].stride = stride;
+      tl->buffer[buf].max_index = max_index;
+   }
+}
+
+
+static void
+llvm_release(struct translate *translate)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   if (tl->gallivm)
+      gallivm_destroy(tl->gallivm);
+   if (tl->context)
+      LLVMContextDispose(tl->context);
+   FREE(tl);
+}
+
+
+/**
+ * Check whether every element of the key can be handled, mirroring the
+ * restrictions of translate_generic plus those of the output packing.
+ */
+static boolean
+key_supported(const struct translate_key *key)
+{
+   unsigned i;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *elem = &key->element[i];
+      const struct util_format_description *in_desc, *out_desc;
+
+      if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+         if (elem->output_format != PIPE_FORMAT_R32_USCALED &&
+             elem->output_format != PIPE_FORMAT_R32_SSCALED)
+            return FALSE;
+         continue;
+      }
+
+      in_desc = util_format_description(elem->input_format);
+      out_desc = util_format_description(elem->output_format);
+      if (!in_desc || !out_desc)
+         return FALSE;
+
+      if (elem->input_format == elem->output_format &&
+          in_desc->block.width == 1 && in_desc->block.height == 1 &&
+          !(in_desc->block.bits & 7))
+         continue;
+
+      if (!output_format_supported(out_desc))
+         return FALSE;
+
+      /* integer data is never converted to or from float */
+      if (in_desc->channel[0].pure_integer != out_desc->channel[0].pure_integer)
+         return FALSE;
+
+      if (in_desc->channel[0].pure_integer) {
+         unsigned nr = MIN2(in_desc->nr_channels, out_desc->nr_channels);
+         unsigned c;
+
+         if (in_desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB)
+            return FALSE;
+
+         for (c = 0; c < nr; c++) {
+            if (in_desc->channel[c].type != out_desc->channel[c].type ||
+                in_desc->channel[c].size > out_desc->channel[c].size)
+               return FALSE;
+         }
+      }
+   }
+
+   return TRUE;
+}
+
+
+struct translate *
+translate_llvm_create(const struct translate_key *key)
+{
+   struct translate_llvm *tl;
+   LLVMValueRef funcs[TRANSLATE_LLVM_NUM_FUNCS];
+   unsigned i;
+
+   assert(key->nr_elements <= TRANSLATE_MAX_ATTRIBS);
+
+   if (!key_supported(key))
+      return NULL;
+
+   if (!lp_build_init())
+      return NULL;
+
+   tl = CALLOC_STRUCT(translate_llvm);
+   if (!tl)
+      return NULL;
+
+   tl->translate.key = *key;
+   tl->translate.release = llvm_release;
+   tl->translate.set_buffer = llvm_set_buffer;
+   tl->translate.run_elts = llvm_run_elts;
+   tl->translate.run_elts16 = llvm_run_elts16;
+   tl->translate.run_elts8 = llvm_run_elts8;
+   tl->translate.run = llvm_run;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      if (key->element[i].type == TRANSLATE_ELEMENT_NORMAL)
+         tl->nr_buffers = MAX2(tl->nr_buffers,
+                               key->element[i].input_buffer + 1);
+   }
+
+   tl->context = LLVMContextCreate();
+   if (!tl->context)
+      goto fail;
+
+   tl->gallivm = gallivm_create("translate", tl->context, NULL);
+   if (!tl->gallivm)
+      goto fail;
+
+   for (i = 0; i < TRANSLATE_LLVM_NUM_FUNCS; i++)
+      funcs[i] = create_function(tl, i);
+
+   gallivm_compile_module(tl->gallivm);
+
+   for (i = 0; i < TRANSLATE_LLVM_NUM_FUNCS; i++)
+      tl->func[i] = (translate_llvm_func)
+         gallivm_jit_function(tl->gallivm, funcs[i]);
+
+   gallivm_free_ir(tl->gallivm);
+
+   return &tl->translate;
+
+fail:
+   llvm_release(&tl->translate);
+   return NULL;
+}
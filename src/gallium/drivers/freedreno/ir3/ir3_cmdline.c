@@ -27,9 +27,11 @@
 #include <err.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -53,6 +55,13 @@
 #include "compiler/nir_types.h"
 #include "compiler/spirv/nir_spirv.h"
 
+#include "compiler/spirv/spirv.h"
+
+#include "c11/threads.h"
+#include "util/os_time.h"
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
+
 #include "pipe/p_context.h"
 
 static void
@@ -104,6 +113,16 @@ fixup_varying_slots(nir_shader *nir, nir_variable_mode mode)
 
 static struct ir3_compiler *compiler;
 
+/* In batch mode every input is compiled separately, possibly from several
+ * threads, and only statistics are printed.
+ */
+static bool batch_mode;
+
+/* The standalone GLSL compiler keeps global state, so only one thread may
+ * use it at a time.
+ */
+static mtx_t glsl_lock = _MTX_INITIALIZER_NP;
+
 static nir_shader *
 load_glsl(unsigned num_files, char *const *files, gl_shader_stage stage)
 {
@@ -118,8 +137,12 @@ load_glsl(unsigned num_files, char *const *files, gl_shader_stage stage)
    static struct gl_context local_ctx;
 
    prog = standalone_compile_shader(&options, num_files, files, &local_ctx);
-   if (!prog)
+   if (!prog && batch_mode) {
+      warnx("couldn't parse `%s'", files[0]);
+      return NULL;
+   } else if (!prog) {
       errx(1, "couldn't parse `%s'", files[0]);
+   }
 
    nir_shader *nir = glsl_to_nir(&local_ctx.Const, prog, stage, nir_options);
 
@@ -140,11 +163,13 @@ load_glsl(unsigned num_files, char *const *files, gl_shader_stage stage)
 
    NIR_PASS_V(nir, nir_split_var_copies);
    NIR_PASS_V(nir, nir_lower_var_copies);
-   nir_print_shader(nir, stdout);
+   if (!batch_mode)
+      nir_print_shader(nir, stdout);
    NIR_PASS_V(nir, gl_nir_lower_atomics, prog, true);
    NIR_PASS_V(nir, gl_nir_lower_buffers, prog);
    NIR_PASS_V(nir, nir_lower_atomics_to_ssbo);
-   nir_print_shader(nir, stdout);
+   if (!batch_mode)
+      nir_print_shader(nir, stdout);
 
    switch (stage) {
    case MESA_SHADER_VERTEX:
@@ -245,11 +270,15 @@ load_spirv(const char *filename, const char *entry, gl_shader_stage stage)
    void *buf;
    size_t size;
 
-   read_file(filename, &buf, &size);
+   if (read_file(filename, &buf, &size))
+      return NULL;
 
    nir = spirv_to_nir(buf, size / 4, NULL, 0, /* spec_entries */
                       stage, entry, &spirv_options,
                       ir3_get_compiler_options(compiler));
+   munmap(buf, size);
+   if (!nir)
+      return NULL;
 
    const struct nir_lower_sysvals_to_varyings_options sysvals_to_varyings = {
       .frag_coord = true,
@@ -257,16 +286,329 @@ load_spirv(const char *filename, const char *entry, gl_shader_stage stage)
    };
    NIR_PASS_V(nir, nir_lower_sysvals_to_varyings, &sysvals_to_varyings);
 
-   nir_print_shader(nir, stdout);
+   if (!batch_mode)
+      nir_print_shader(nir, stdout);
 
    return nir;
 }
 
-static const char *shortopts = "g:hv";
+/* Finds the first entry point of a SPIR-V module with a stage we support.
+ * The returned name is a copy the caller must free().
+ */
+static char *
+find_spirv_entry(const char *filename, gl_shader_stage *stage)
+{
+   void *buf;
+   size_t size;
+
+   if (read_file(filename, &buf, &size))
+      return NULL;
+
+   const uint32_t *words = buf;
+   const size_t word_count = size / 4;
+   const char *entry = NULL;
+
+   for (size_t i = 5; i < word_count && !entry;) {
+      const unsigned opcode = words[i] & SpvOpCodeMask;
+      const unsigned count = words[i] >> SpvWordCountShift;
+      if (count == 0 || i + count > word_count)
+         break;
+
+      if (opcode == SpvOpEntryPoint && count >= 4) {
+         switch (words[i + 1]) {
+         case SpvExecutionModelVertex:
+            *stage = MESA_SHADER_VERTEX;
+            entry = (const char *)&words[i + 3];
+            break;
+         case SpvExecutionModelFragment:
+            *stage = MESA_SHADER_FRAGMENT;
+            entry = (const char *)&words[i + 3];
+            break;
+         case SpvExecutionModelGLCompute:
+            *stage = MESA_SHADER_COMPUTE;
+            entry = (const char *)&words[i + 3];
+            break;
+         default:
+            break;
+         }
+      }
+
+      i += count;
+   }
+
+   char *name = NULL;
+   if (entry && memchr(entry, '\0', (const char *)(words + word_count) - entry))
+      name = strdup(entry);
+
+   munmap(buf, size);
+
+   return name;
+}
+
+static void
+lower_spirv_nir(nir_shader *nir)
+{
+   NIR_PASS_V(nir, nir_lower_io, nir_var_shader_in | nir_var_shader_out,
+              ir3_glsl_type_size, (nir_lower_io_options)0);
+
+   /* TODO do this somewhere else */
+   nir_lower_int64(nir);
+   nir_lower_system_values(nir);
+   nir_lower_compute_system_values(nir, NULL);
+}
+
+static struct ir3_shader_variant *
+compile_nir(nir_shader *nir, gl_shader_stage stage, uint64_t *phase_times,
+            uint64_t *finalize_time)
+{
+   struct ir3_shader_key key = {};
+   int64_t start = os_time_get_nano();
+
+   ir3_nir_lower_io_to_temporaries(nir);
+   ir3_finalize_nir(compiler, nir);
+
+   struct ir3_shader *shader = rzalloc_size(NULL, sizeof(*shader));
+   shader->compiler = compiler;
+   shader->type = stage;
+   shader->nir = nir;
+   ralloc_steal(shader, nir);
+
+   ir3_nir_post_finalize(shader);
+
+   struct ir3_shader_variant *v = rzalloc_size(shader, sizeof(*v));
+   v->type = shader->type;
+   v->compiler = compiler;
+   v->key = key;
+   v->const_state = rzalloc_size(v, sizeof(*v->const_state));
+   v->phase_times = phase_times;
+
+   shader->variants = v;
+   shader->variant_count = 1;
+
+   ir3_nir_lower_variant(v, nir);
+
+   if (finalize_time)
+      *finalize_time = os_time_get_nano() - start;
+
+   if (ir3_compile_shader_nir(compiler, shader, v)) {
+      ralloc_free(shader);
+      return NULL;
+   }
+
+   return v;
+}
+
+struct batch_shader {
+   char *filename;
+   gl_shader_stage stage;
+   bool compiled;
+
+   /* Copied out of the variant, which is freed right after compiling: */
+   struct ir3_info info;
+   unsigned constlen;
+   unsigned loops;
+   unsigned pvtmem_size;
+
+   uint64_t frontend_time;
+   uint64_t finalize_time;
+   uint64_t phase_times[IR3_PHASE_COUNT];
+};
+
+struct batch {
+   struct batch_shader *shaders;
+   unsigned count;
+   unsigned next;
+};
+
+static const char *phase_names[IR3_PHASE_COUNT] = {
+   [IR3_PHASE_NIR_TO_IR3] = "nir->ir3",
+   [IR3_PHASE_OPT]        = "opt",
+   [IR3_PHASE_SCHED]      = "sched",
+   [IR3_PHASE_RA]         = "ra",
+   [IR3_PHASE_POSTSCHED]  = "postsched",
+   [IR3_PHASE_LEGALIZE]   = "legalize",
+};
+
+static void
+batch_compile(struct batch_shader *s)
+{
+   int64_t start = os_time_get_nano();
+   nir_shader *nir;
+
+   const char *ext = strrchr(s->filename, '.');
+   if (ext && strcmp(ext, ".spv") == 0) {
+      char *entry = find_spirv_entry(s->filename, &s->stage);
+      if (!entry)
+         return;
+
+      nir = load_spirv(s->filename, entry, s->stage);
+      free(entry);
+      if (!nir)
+         return;
+
+      lower_spirv_nir(nir);
+   } else {
+      mtx_lock(&glsl_lock);
+      nir = load_glsl(1, &s->filename, s->stage);
+      mtx_unlock(&glsl_lock);
+      if (!nir)
+         return;
+   }
+
+   s->frontend_time = os_time_get_nano() - start;
+
+   struct ir3_shader_variant *v =
+      compile_nir(nir, s->stage, s->phase_times, &s->finalize_time);
+   if (!v)
+      return;
+
+   if (ir3_shader_assemble(v)) {
+      s->compiled = true;
+      s->info = v->info;
+      s->constlen = v->constlen;
+      s->loops = v->loops;
+      s->pvtmem_size = v->pvtmem_size;
+   }
+
+   ir3_destroy(v->ir);
+   ralloc_free(ralloc_parent(v));
+}
+
+static int
+batch_worker(void *data)
+{
+   struct batch *batch = data;
+   unsigned i;
+
+   while ((i = p_atomic_inc_return(&batch->next) - 1) < batch->count)
+      batch_compile(&batch->shaders[i]);
+
+   return 0;
+}
+
+static void
+batch_print(const struct batch *batch)
+{
+   uint64_t total_instrs = 0, total_nops = 0, total_ss = 0, total_sy = 0;
+   uint64_t total_sstall = 0, total_systall = 0, total_stp = 0, total_ldp = 0;
+   uint64_t total_frontend = 0, total_finalize = 0, total_phase[IR3_PHASE_COUNT] = {};
+   unsigned failed = 0;
+
+   for (unsigned i = 0; i < batch->count; i++) {
+      const struct batch_shader *s = &batch->shaders[i];
+
+      if (!s->compiled) {
+         printf("%s: FAIL\n", s->filename);
+         failed++;
+         continue;
+      }
+
+      printf("%s: %s shader: %u inst, %u nops, %u non-nops, %u mov, %u cov, "
+             "%u dwords, %u last-baryf, %u half, %u full, %u constlen, "
+             "%u stp, %u ldp, %u pvtmem, %u sstall, %u (ss), %u systall, "
+             "%u (sy), %d waves, %d loops\n",
+             s->filename, _mesa_shader_stage_to_abbrev(s->stage),
+             s->info.instrs_count, s->info.nops_count,
+             s->info.instrs_count - s->info.nops_count, s->info.mov_count,
+             s->info.cov_count, s->info.sizedwords, s->info.last_baryf,
+             s->info.max_half_reg + 1, s->info.max_reg + 1, s->constlen,
+             s->info.stp_count, s->info.ldp_count, s->pvtmem_size,
+             s->info.sstall, s->info.ss, s->info.systall, s->info.sy,
+             s->info.max_waves, s->loops);
+
+      printf("%s: time: frontend %.3fms, finalize %.3fms", s->filename,
+             s->frontend_time / 1000000.0, s->finalize_time / 1000000.0);
+      for (unsigned p = 0; p < IR3_PHASE_COUNT; p++) {
+         printf(", %s %.3fms", phase_names[p], s->phase_times[p] / 1000000.0);
+         total_phase[p] += s->phase_times[p];
+      }
+      printf("\n");
+
+      total_instrs += s->info.instrs_count;
+      total_nops += s->info.nops_count;
+      total_ss += s->info.ss;
+      total_sy += s->info.sy;
+      total_sstall += s->info.sstall;
+      total_systall += s->info.systall;
+      total_stp += s->info.stp_count;
+      total_ldp += s->info.ldp_count;
+      total_frontend += s->frontend_time;
+      total_finalize += s->finalize_time;
+   }
+
+   printf("\ntotal: %u shaders, %u failed\n", batch->count, failed);
+   printf("total: %" PRIu64 " inst, %" PRIu64 " nops, %" PRIu64 " stp, "
+          "%" PRIu64 " ldp, %" PRIu64 " sstall, %" PRIu64 " (ss), "
+          "%" PRIu64 " systall, %" PRIu64 " (sy)\n",
+          total_instrs, total_nops, total_stp, total_ldp, total_sstall,
+          total_ss, total_systall, total_sy);
+   printf("total time: frontend %.3fms, finalize %.3fms",
+          total_frontend / 1000000.0, total_finalize / 1000000.0);
+   for (unsigned p = 0; p < IR3_PHASE_COUNT; p++)
+      printf(", %s %.3fms", phase_names[p], total_phase[p] / 1000000.0);
+   printf("\n");
+}
+
+static int
+run_batch(int num_files, char *const *files, unsigned num_threads)
+{
+   struct batch batch = {
+      .shaders = calloc(num_files, sizeof(struct batch_shader)),
+      .count = num_files,
+   };
+
+   for (int i = 0; i < num_files; i++) {
+      struct batch_shader *s = &batch.shaders[i];
+      const char *ext = strrchr(files[i], '.');
+
+      s->filename = files[i];
+      if (!ext) {
+         errx(1, "unknown file type: `%s'", files[i]);
+      } else if (strcmp(ext, ".spv") == 0) {
+         /* stage comes from the entry point */
+      } else if (strcmp(ext, ".comp") == 0) {
+         s->stage = MESA_SHADER_COMPUTE;
+      } else if (strcmp(ext, ".frag") == 0) {
+         s->stage = MESA_SHADER_FRAGMENT;
+      } else if (strcmp(ext, ".vert") == 0) {
+         s->stage = MESA_SHADER_VERTEX;
+      } else {
+         errx(1, "unknown file type: `%s'", files[i]);
+      }
+   }
+
+   if (num_threads == 0)
+      num_threads = util_get_cpu_caps()->nr_cpus;
+   num_threads = CLAMP(num_threads, 1, num_files);
+
+   thrd_t *threads = calloc(num_threads, sizeof(thrd_t));
+   unsigned started = 0;
+   for (unsigned i = 1; i < num_threads; i++) {
+      if (thrd_create(&threads[started], batch_worker, &batch) != thrd_success)
+         break;
+      started++;
+   }
+
+   batch_worker(&batch);
+
+   for (unsigned i = 0; i < started; i++)
+      thrd_join(threads[i], NULL);
+
+   batch_print(&batch);
+
+   free(threads);
+   free(batch.shaders);
+
+   return 0;
+}
+
+static const char *shortopts = "bg:hj:v";
 
 static const struct option longopts[] = {
+   {"batch",   no_argument,       0, 'b'},
    {"gpu",     required_argument, 0, 'g'},
    {"help",    no_argument,       0, 'h'},
+   {"threads", required_argument, 0, 'j'},
    {"verbose", no_argument,       0, 'v'},
 };
 
@@ -275,8 +617,14 @@ print_usage(void)
 {
    printf("Usage: ir3_compiler [OPTIONS]... <file.tgsi | file.spv entry_point "
           "| (file.vert | file.frag)*>\n");
+   printf("       ir3_compiler --batch [OPTIONS]... <file.spv | file.vert | "
+          "file.frag | file.comp>...\n");
+   printf("    -b, --batch      - compile each file separately and print "
+          "shader-db statistics\n");
    printf("    -g, --gpu GPU_ID - specify gpu-id (default 320)\n");
    printf("    -h, --help       - show this message\n");
+   printf("    -j, --threads N  - number of threads in batch mode (default: "
+          "CPU count)\n");
    printf("    -v, --verbose    - verbose compiler/debug messages\n");
 }
 
@@ -287,8 +635,8 @@ main(int argc, char **argv)
    char *filenames[2];
    int num_files = 0;
    unsigned stage = 0;
-   struct ir3_shader_key key = {};
    unsigned gpu_id = 320;
+   unsigned num_threads = 0;
    const char *info;
    const char *spirv_entry = NULL;
    void *ptr;
@@ -298,9 +646,22 @@ main(int argc, char **argv)
    while ((opt = getopt_long_only(argc, argv, shortopts, longopts, NULL)) !=
           -1) {
       switch (opt) {
+      case 'b':
+         batch_mode = true;
+         break;
       case 'g':
          gpu_id = strtol(optarg, NULL, 0);
          break;
+      case 'j': {
+         long n = strtol(optarg, NULL, 0);
+         if (n < 1) {
+            fprintf(stderr, "invalid thread count: `%s'\n", optarg);
+            print_usage();
+            return 1;
+         }
+         num_threads = n;
+         break;
+      }
       case 'v':
          ir3_shader_debug |= IR3_DBG_OPTMSGS | IR3_DBG_DISASM;
          break;
@@ -319,6 +680,17 @@ main(int argc, char **argv)
       return 0;
    }
 
+   if (batch_mode) {
+      struct fd_dev_id dev_id = {
+            .gpu_id = gpu_id,
+      };
+      compiler = ir3_compiler_create(NULL, &dev_id,
+                                     &(struct ir3_compiler_options) {});
+      glsl_type_singleton_init_or_ref();
+
+      return run_batch(argc - optind, &argv[optind], num_threads);
+   }
+
    unsigned n = optind;
    while (n < argc) {
       char *filename = argv[n];
@@ -398,14 +770,7 @@ main(int argc, char **argv)
       NIR_PASS_V(nir, nir_lower_global_vars_to_local);
    } else if (spirv_entry) {
       nir = load_spirv(filenames[0], spirv_entry, stage);
-
-      NIR_PASS_V(nir, nir_lower_io, nir_var_shader_in | nir_var_shader_out,
-                 ir3_glsl_type_size, (nir_lower_io_options)0);
-
-      /* TODO do this somewhere else */
-      nir_lower_int64(nir);
-      nir_lower_system_values(nir);
-      nir_lower_compute_system_values(nir, NULL);
+      lower_spirv_nir(nir);
    } else if (num_files > 0) {
       nir = load_glsl(num_files, filenames, stage);
    } else {
@@ -413,32 +778,11 @@ main(int argc, char **argv)
       return -1;
    }
 
-   ir3_nir_lower_io_to_temporaries(nir);
-   ir3_finalize_nir(compiler, nir);
-
-   struct ir3_shader *shader = rzalloc_size(NULL, sizeof(*shader));
-   shader->compiler = compiler;
-   shader->type = stage;
-   shader->nir = nir;
-
-   ir3_nir_post_finalize(shader);
-
-   struct ir3_shader_variant *v = rzalloc_size(shader, sizeof(*v));
-   v->type = shader->type;
-   v->compiler = compiler;
-   v->key = key;
-   v->const_state = rzalloc_size(v, sizeof(*v->const_state));
-
-   shader->variants = v;
-   shader->variant_count = 1;
-
-   ir3_nir_lower_variant(v, nir);
-
    info = "NIR compiler";
-   ret = ir3_compile_shader_nir(compiler, shader, v);
-   if (ret) {
+   struct ir3_shader_variant *v = compile_nir(nir, stage, NULL, NULL);
+   if (!v) {
       fprintf(stderr, "compiler failed!\n");
-      return ret;
+      return -1;
    }
    dump_info(v, info);
 
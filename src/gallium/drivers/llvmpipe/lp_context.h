@@ -161,6 +161,9 @@ struct llvmpipe_context {
    boolean permit_linear_rasterizer;
    boolean single_vp;
 
+   /** Whether the bound fs variant has a linear path */
+   boolean fs_linear;
+
    struct lp_setup_variant_list_item setup_variants_list;
    unsigned nr_setup_variants;
 
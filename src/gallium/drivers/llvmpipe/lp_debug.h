@@ -65,6 +65,10 @@
 #define PERF_NO_ALPHATEST   0x80  	/* disable alpha testing */
 #define PERF_NO_RAST_LINEAR 0x100  	/* disable linear rast */
 #define PERF_NO_SHADE       0x200  	/* disable fragment shaders */
+#define PERF_NO_WIDE_RAST   0x400  	/* no AVX2/AVX-512 coverage evaluation */
+#define PERF_NO_FAST_CLEAR  0x800  	/* always bin color clears to every tile */
+#define PERF_TILE_CACHE     0x1000  	/* rasterize bins in per-thread tile buffers */
+#define PERF_PIN_THREADS    0x2000  	/* pin rast threads, prefer local bins */
 
 
 extern int LP_PERF;
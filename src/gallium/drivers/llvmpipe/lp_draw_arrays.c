@@ -39,6 +39,7 @@
 #include "lp_context.h"
 #include "lp_state.h"
 #include "lp_query.h"
+#include "lp_screen.h"
 
 #include "draw/draw_context.h"
 
@@ -76,6 +77,9 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
+   lp_screen_count_draw(llvmpipe_screen(pipe->screen),
+                        lp->permit_linear_rasterizer && lp->fs_linear);
+
    /*
     * Map vertex buffers
     */
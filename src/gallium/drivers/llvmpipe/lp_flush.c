@@ -38,6 +38,7 @@
 #include "lp_flush.h"
 #include "lp_context.h"
 #include "lp_setup.h"
+#include "lp_texture.h"
 
 
 /**
@@ -122,5 +123,9 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
       llvmpipe_finish(pipe, reason);
    }
 
+   /* Write out tiles whose clear was deferred by the rasterizer */
+   if (llvmpipe_resource_is_texture(resource))
+      llvmpipe_resource_resolve_fast_clear(llvmpipe_resource(resource));
+
    return TRUE;
 }
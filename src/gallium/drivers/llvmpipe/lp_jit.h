@@ -316,7 +316,7 @@ typedef void
                     const void *dady,
                     uint8_t **color,
                     uint8_t *depth,
-                    uint64_t mask,
+                    const uint64_t *mask,
                     struct lp_jit_thread_data *thread_data,
                     unsigned *stride,
                     unsigned depth_stride,
@@ -325,7 +325,7 @@ typedef void
 
 
 #define LP_MAX_LINEAR_CONSTANTS 16
-#define LP_MAX_LINEAR_TEXTURES 2
+#define LP_MAX_LINEAR_TEXTURES 4
 #define LP_MAX_LINEAR_INPUTS 8
 
 
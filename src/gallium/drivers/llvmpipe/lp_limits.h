@@ -64,7 +64,13 @@
 #define LP_MAX_HEIGHT (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
-#define LP_MAX_SAMPLES 4
+#define LP_MAX_SAMPLES 16
+
+/**
+ * Coverage masks of 4x4 blocks hold 16 bits per sample, four samples
+ * per 64-bit word.
+ */
+#define LP_SAMPLE_MASK_WORDS (LP_MAX_SAMPLES / 4)
 
 #define LP_MAX_THREADS 16
 
@@ -139,9 +139,8 @@ lp_fs_linear_run(const struct lp_rast_state *state,
       jit.constants = (const uint8_t (*)[4])nir_constants;
    }
 
-   /* We assume BGRA ordering */
-   assert(variant->key.cbuf_format[0] == PIPE_FORMAT_B8G8R8X8_UNORM ||
-          variant->key.cbuf_format[0] == PIPE_FORMAT_B8G8R8A8_UNORM);
+   /* We assume BGRA ordering, or rgb565 expanded to it */
+   assert(lp_linear_cbuf_format(variant->key.cbuf_format[0]));
 
    jit.blend_color =
          state->jit_context.u8_blend_color[32] +
@@ -204,6 +203,26 @@ lp_fs_linear_run(const struct lp_rast_state *state,
    }
 
    /* JIT function already does blending */
+   if (variant->key.cbuf_format[0] == PIPE_FORMAT_B5G6R5_UNORM) {
+      /* The linear shaders work on BGRA rows, so expand each row into a
+       * temporary before running the shader and pack it back afterwards.
+       */
+      PIPE_ALIGN_VAR(16) uint32_t row[TILE_SIZE];
+
+      assert(width <= TILE_SIZE);
+
+      color += x * 2 + y * stride;
+      jit.color0 = (uint8_t *)row;
+      for (y = 0; y < height; y++) {
+         lp_linear_unpack_row_565(row, (const uint16_t *)color, width);
+         jit_func(&jit, 0, 0, width);
+         lp_linear_pack_row_565((uint16_t *)color, row, width);
+         color += stride;
+      }
+
+      return TRUE;
+   }
+
    jit.color0 = color + x * 4 + y * stride;
    for (y = 0; y < height; y++) {
       jit_func(&jit, 0, 0, width);
@@ -307,9 +326,10 @@ lp_linear_check_variant(struct lp_fragment_shader_variant *variant)
    }
 
    /* If we have a fastpath which implements the entire varient, use
-    * that.
+    * that.  These all write 32bpp pixels directly.
     */
-   if (lp_linear_check_fastpath(variant)) {
+   if (key->cbuf_format[0] != PIPE_FORMAT_B5G6R5_UNORM &&
+       lp_linear_check_fastpath(variant)) {
       return;
    }
 
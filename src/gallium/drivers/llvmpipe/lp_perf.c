@@ -121,6 +121,9 @@ lp_print_counters(void)
       debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
+      debug_printf("llvmpipe: nr_fs_precompiles:            %u\n", lp_count.nr_fs_precompiles);
+      debug_printf("llvmpipe: nr_fs_precompile_hits:        %u\n", lp_count.nr_fs_precompile_hits);
+      debug_printf("llvmpipe: nr_fs_precompile_misses:      %u\n", lp_count.nr_fs_precompile_misses);
 
    }
 }
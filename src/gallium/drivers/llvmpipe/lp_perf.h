@@ -64,6 +64,9 @@ struct lp_counters
    unsigned nr_non_empty_4;
    unsigned nr_llvm_compiles;
    int64_t llvm_compile_time;  /**< total, in microseconds */
+   unsigned nr_fs_precompiles;
+   unsigned nr_fs_precompile_hits; /**< draws which didn't wait on LLVM */
+   unsigned nr_fs_precompile_misses; /**< background compiles thrown away */
 
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
@@ -74,6 +77,33 @@ struct lp_counters
 extern struct lp_counters lp_count;
 
 
+/**
+ * Per rasterizer thread counters.  Unlike lp_counters these are compiled
+ * into release builds: each thread only ever updates its own copy in
+ * lp_rasterizer_task, so counting is a plain increment, and the copies are
+ * only summed up when read back through the driver-specific queries.
+ */
+enum lp_thread_counter
+{
+   LP_THREAD_COUNTER_TILES,              /**< non-empty bins rasterized */
+   LP_THREAD_COUNTER_TILES_LINEAR,       /**< ... of which by the linear path */
+   LP_THREAD_COUNTER_TILE_CLEARS,        /**< color tile clears */
+   LP_THREAD_COUNTER_SHADE_TILES,        /**< fully covered tiles shaded */
+   LP_THREAD_COUNTER_SHADE_TILES_OPAQUE, /**< ... of which opaque */
+   LP_THREAD_COUNTER_PARTIAL_BLOCKS,     /**< 4x4 blocks shaded with a mask */
+   LP_THREAD_COUNTER_BLOCKS_16,          /**< small triangle 16x16 blocks */
+   LP_THREAD_COUNTER_BLOCKS_16_WIDE,     /**< ... of which with AVX2/AVX-512 */
+   LP_THREAD_COUNTER_BUSY_NS,            /**< time spent rasterizing scenes */
+   LP_THREAD_COUNTER_IDLE_NS,            /**< time spent waiting for scenes */
+   LP_THREAD_COUNTER_COUNT
+};
+
+#define LP_THREAD_COUNT(task, counter) \
+   ((task)->counters[LP_THREAD_COUNTER_##counter]++)
+#define LP_THREAD_COUNT_ADD(task, counter, incr) \
+   ((task)->counters[LP_THREAD_COUNTER_##counter] += (incr))
+
+
 /** Increment the named counter (only for debug builds) */
 #ifdef DEBUG
 #define LP_COUNT(counter) lp_count.counter++
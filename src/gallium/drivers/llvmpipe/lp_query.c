@@ -43,6 +43,136 @@
 #include "lp_rast.h"
 
 
+#define THREAD_QUERY(_name, _counter, _type) {                          \
+      .name = _name,                                                   \
+      .query_type = LP_QUERY_THREAD_COUNTER(LP_THREAD_COUNTER_##_counter), \
+      .type = PIPE_DRIVER_QUERY_TYPE_##_type,                          \
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,            \
+      .group_id = ~(unsigned)0,                                        \
+   }
+
+static const struct pipe_driver_query_info lp_driver_query_list[] = {
+   THREAD_QUERY("rast-tiles", TILES, UINT64),
+   THREAD_QUERY("rast-tiles-linear", TILES_LINEAR, UINT64),
+   THREAD_QUERY("rast-tile-clears", TILE_CLEARS, UINT64),
+   THREAD_QUERY("rast-shade-tiles", SHADE_TILES, UINT64),
+   THREAD_QUERY("rast-shade-tiles-opaque", SHADE_TILES_OPAQUE, UINT64),
+   THREAD_QUERY("rast-partial-blocks", PARTIAL_BLOCKS, UINT64),
+   THREAD_QUERY("rast-blocks-16", BLOCKS_16, UINT64),
+   THREAD_QUERY("rast-blocks-16-wide", BLOCKS_16_WIDE, UINT64),
+   THREAD_QUERY("rast-busy-time", BUSY_NS, MICROSECONDS),
+   THREAD_QUERY("rast-idle-time", IDLE_NS, MICROSECONDS),
+   {
+      .name = "llvm-compiles",
+      .query_type = LP_QUERY_LLVM_COMPILES,
+      .type = PIPE_DRIVER_QUERY_TYPE_UINT64,
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+      .group_id = ~(unsigned)0,
+   },
+   {
+      .name = "llvm-compile-time",
+      .query_type = LP_QUERY_LLVM_COMPILE_TIME,
+      .type = PIPE_DRIVER_QUERY_TYPE_MICROSECONDS,
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+      .group_id = ~(unsigned)0,
+   },
+   {
+      .name = "draws",
+      .query_type = LP_QUERY_DRAWS,
+      .type = PIPE_DRIVER_QUERY_TYPE_UINT64,
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+      .group_id = ~(unsigned)0,
+   },
+   {
+      .name = "draws-linear",
+      .query_type = LP_QUERY_DRAWS_LINEAR,
+      .type = PIPE_DRIVER_QUERY_TYPE_UINT64,
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+      .group_id = ~(unsigned)0,
+   },
+   {
+      .name = "scene-block-allocs",
+      .query_type = LP_QUERY_SCENE_BLOCK_ALLOCS,
+      .type = PIPE_DRIVER_QUERY_TYPE_UINT64,
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+      .group_id = ~(unsigned)0,
+   },
+   {
+      .name = "scene-size-flushes",
+      .query_type = LP_QUERY_SCENE_SIZE_FLUSHES,
+      .type = PIPE_DRIVER_QUERY_TYPE_UINT64,
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+      .group_id = ~(unsigned)0,
+   },
+   {
+      .name = "scene-size-peak",
+      .query_type = LP_QUERY_SCENE_SIZE_PEAK,
+      .type = PIPE_DRIVER_QUERY_TYPE_BYTES,
+      .result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+      .group_id = ~(unsigned)0,
+   },
+};
+
+#undef THREAD_QUERY
+
+
+static int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen, unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   if (!info)
+      return ARRAY_SIZE(lp_driver_query_list);
+
+   if (index >= ARRAY_SIZE(lp_driver_query_list))
+      return 0;
+
+   *info = lp_driver_query_list[index];
+   return 1;
+}
+
+
+/**
+ * Current value of a driver-specific query's counter.  These are screen
+ * wide, as the rasterizer threads are shared by all contexts.
+ */
+static uint64_t
+lp_driver_query_value(struct llvmpipe_screen *screen, unsigned type)
+{
+   enum lp_thread_counter counter;
+   uint64_t value;
+
+   switch (type) {
+   case LP_QUERY_LLVM_COMPILES:
+      return p_atomic_read(&screen->num_llvm_compiles);
+   case LP_QUERY_LLVM_COMPILE_TIME:
+      return p_atomic_read(&screen->llvm_compile_time);
+   case LP_QUERY_DRAWS:
+      return p_atomic_read(&screen->num_draws);
+   case LP_QUERY_DRAWS_LINEAR:
+      return p_atomic_read(&screen->num_linear_draws);
+   case LP_QUERY_SCENE_BLOCK_ALLOCS:
+      return p_atomic_read(&screen->num_scene_block_allocs);
+   case LP_QUERY_SCENE_SIZE_FLUSHES:
+      return p_atomic_read(&screen->num_scene_size_flushes);
+   case LP_QUERY_SCENE_SIZE_PEAK:
+      return p_atomic_read(&screen->scene_size_peak);
+   default:
+      break;
+   }
+
+   if (!screen->rast)
+      return 0;
+
+   counter = type - PIPE_QUERY_DRIVER_SPECIFIC;
+   value = lp_rast_get_counter(screen->rast, counter);
+   if (counter == LP_THREAD_COUNTER_BUSY_NS ||
+       counter == LP_THREAD_COUNTER_IDLE_NS)
+      value /= 1000;
+
+   return value;
+}
+
+
 static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
 {
    return (struct llvmpipe_query *)p;
@@ -55,7 +185,8 @@ llvmpipe_create_query(struct pipe_context *pipe,
 {
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= PIPE_QUERY_DRIVER_SPECIFIC && type <= LP_QUERY_LAST));
 
    pq = CALLOC_STRUCT( llvmpipe_query );
 
@@ -115,6 +246,18 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       }
    }
 
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      /* Sample the counters once the query's last scene is rasterized */
+      if (!pq->end[0])
+         pq->end[0] = lp_driver_query_value(screen, pq->type);
+      /* A high-water mark is reported as is, the others as deltas */
+      if (pq->type == LP_QUERY_SCENE_SIZE_PEAK)
+         *result = pq->end[0];
+      else
+         *result = pq->end[0] - pq->start[0];
+      return true;
+   }
+
    /* Sum the results from each of the threads:
     */
    *result = 0;
@@ -398,6 +541,11 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    memset(pq->end, 0, sizeof(pq->end));
    lp_setup_begin_query(llvmpipe->setup, pq);
 
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      pq->start[0] = lp_driver_query_value(llvmpipe_screen(pipe->screen),
+                                           pq->type);
+   }
+
    switch (pq->type) {
    case PIPE_QUERY_PRIMITIVES_EMITTED:
       pq->num_primitives_written[0] = llvmpipe->so_stats[pq->index].num_primitives_written;
@@ -567,3 +715,8 @@ void llvmpipe_init_query_funcs(struct llvmpipe_context *llvmpipe )
 }
 
 
+void
+llvmpipe_init_screen_query_funcs(struct pipe_screen *screen)
+{
+   screen->get_driver_query_info = llvmpipe_get_driver_query_info;
+}
@@ -36,6 +36,7 @@
 #include <limits.h>
 #include "os/os_thread.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 struct llvmpipe_context;
@@ -54,8 +55,22 @@ struct llvmpipe_query {
 };
 
 
+/* Driver-specific queries, see llvmpipe_get_driver_query_info() */
+#define LP_QUERY_THREAD_COUNTER(c)  (PIPE_QUERY_DRIVER_SPECIFIC + (c))
+#define LP_QUERY_LLVM_COMPILES      LP_QUERY_THREAD_COUNTER(LP_THREAD_COUNTER_COUNT)
+#define LP_QUERY_LLVM_COMPILE_TIME  (LP_QUERY_LLVM_COMPILES + 1)
+#define LP_QUERY_DRAWS              (LP_QUERY_LLVM_COMPILE_TIME + 1)
+#define LP_QUERY_DRAWS_LINEAR       (LP_QUERY_DRAWS + 1)
+#define LP_QUERY_SCENE_BLOCK_ALLOCS (LP_QUERY_DRAWS_LINEAR + 1)
+#define LP_QUERY_SCENE_SIZE_FLUSHES (LP_QUERY_SCENE_BLOCK_ALLOCS + 1)
+#define LP_QUERY_SCENE_SIZE_PEAK    (LP_QUERY_SCENE_SIZE_FLUSHES + 1)
+#define LP_QUERY_LAST               LP_QUERY_SCENE_SIZE_PEAK
+
+
 extern void llvmpipe_init_query_funcs(struct llvmpipe_context * );
 
+extern void llvmpipe_init_screen_query_funcs(struct pipe_screen *);
+
 extern boolean llvmpipe_check_render_cond(struct llvmpipe_context *);
 
 #endif /* LP_QUERY_H */
@@ -26,12 +26,14 @@
  **************************************************************************/
 
 #include <limits.h>
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_pack_color.h"
 #include "util/u_string.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_thread.h"
 #include "util/u_memset.h"
 #include "util/os_time.h"
@@ -48,6 +50,7 @@
 #include "gallivm/lp_bld_debug.h"
 #include "lp_scene.h"
 #include "lp_tex_sample.h"
+#include "lp_texture.h"
 
 
 #ifdef DEBUG
@@ -61,6 +64,33 @@ const float lp_sample_pos_4x[4][2] = { { 0.375, 0.125 },
                                        { 0.125, 0.625 },
                                        { 0.625, 0.875 } };
 
+/* The D3D standard patterns, as for 4x */
+const float lp_sample_pos_8x[8][2] = { { 0.5625, 0.3125 },
+                                       { 0.4375, 0.6875 },
+                                       { 0.8125, 0.5625 },
+                                       { 0.3125, 0.1875 },
+                                       { 0.1875, 0.8125 },
+                                       { 0.0625, 0.4375 },
+                                       { 0.6875, 0.9375 },
+                                       { 0.9375, 0.0625 } };
+
+const float lp_sample_pos_16x[16][2] = { { 0.5625, 0.5625 },
+                                         { 0.4375, 0.3125 },
+                                         { 0.3125, 0.625 },
+                                         { 0.75, 0.4375 },
+                                         { 0.1875, 0.375 },
+                                         { 0.625, 0.8125 },
+                                         { 0.8125, 0.6875 },
+                                         { 0.6875, 0.1875 },
+                                         { 0.375, 0.875 },
+                                         { 0.5, 0.0625 },
+                                         { 0.25, 0.125 },
+                                         { 0.125, 0.75 },
+                                         { 0.0, 0.5 },
+                                         { 0.9375, 0.25 },
+                                         { 0.875, 0.9375 },
+                                         { 0.0625, 0.0 } };
+
 /**
  * Begin rasterizing a scene.
  * Called once per scene by one thread.
@@ -73,8 +103,9 @@ lp_rast_begin( struct lp_rasterizer *rast,
 
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
+   scene->rendering_tasks = MAX2(rast->num_threads, 1);
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, rast->num_bands );
 }
 
 
@@ -85,6 +116,33 @@ lp_rast_end( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Does the bin contain commands which may read or write the color buffers?
+ */
+static boolean
+bin_touches_color(const struct cmd_bin *bin)
+{
+   const struct cmd_block *block;
+   unsigned k;
+
+   for (block = bin->head; block; block = block->next) {
+      for (k = 0; k < block->count; k++) {
+         switch (block->cmd[k]) {
+         case LP_RAST_OP_CLEAR_ZSTENCIL:
+         case LP_RAST_OP_BEGIN_QUERY:
+         case LP_RAST_OP_END_QUERY:
+         case LP_RAST_OP_SET_STATE:
+            break;
+         default:
+            return TRUE;
+         }
+      }
+   }
+
+   return FALSE;
+}
+
+
 /**
  * Beginning rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -97,6 +155,7 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
 {
    unsigned i;
    struct lp_scene *scene = task->scene;
+   int touches_color = -1;
 
    LP_DBG(DEBUG_RAST, "%s %d,%d\n", __FUNCTION__, x, y);
 
@@ -112,16 +171,31 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    task->thread_data.ps_invocations = 0;
 
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
+      struct llvmpipe_resource *cleared = scene->cbufs[i].cleared;
+
       if (task->scene->fb.cbufs[i]) {
          task->color_tiles[i] = scene->cbufs[i].map +
                                 scene->cbufs[i].stride * task->y +
                                 scene->cbufs[i].format_bytes * task->x;
+         task->color_stride[i] = scene->cbufs[i].stride;
+      }
+
+      /* Write out a deferred clear of the tile before anything uses it */
+      if (cleared &&
+          p_atomic_read(&cleared->cleared_tiles[y * llvmpipe_resource_tiles_x(cleared) + x])) {
+         if (touches_color < 0)
+            touches_color = bin_touches_color(bin);
+         if (touches_color && llvmpipe_resource_resolve_tile(cleared, x, y)) {
+            LP_COUNT(nr_color_tile_clear);
+            LP_THREAD_COUNT(task, TILE_CLEARS);
+         }
       }
    }
    if (task->scene->fb.zsbuf) {
       task->depth_tile = scene->zsbuf.map +
                          scene->zsbuf.stride * task->y +
                          scene->zsbuf.format_bytes * task->x;
+      task->depth_stride = scene->zsbuf.stride;
    }
 }
 
@@ -154,23 +228,36 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
    LP_DBG(DEBUG_RAST, "%s clear value (target format %d) raw 0x%x,0x%x,0x%x,0x%x\n",
           __FUNCTION__, format, uc.ui[0], uc.ui[1], uc.ui[2], uc.ui[3]);
 
-   for (unsigned s = 0; s < scene->cbufs[cbuf].nr_samples; s++) {
-      void *map = (char *)scene->cbufs[cbuf].map + scene->cbufs[cbuf].sample_stride * s;
-      util_fill_box(map,
-                    format,
-                    scene->cbufs[cbuf].stride,
-                    scene->cbufs[cbuf].layer_stride,
-                    task->x,
-                    task->y,
-                    0,
-                    task->width,
-                    task->height,
-                    scene->fb_max_layer + 1,
-                    &uc);
+   if (task->cached_cbufs & (1 << cbuf)) {
+      /* single layer and sample only */
+      util_fill_rect(task->color_tiles[cbuf],
+                     format,
+                     task->color_stride[cbuf],
+                     0, 0,
+                     task->width,
+                     task->height,
+                     &uc);
+   }
+   else {
+      for (unsigned s = 0; s < scene->cbufs[cbuf].nr_samples; s++) {
+         void *map = (char *)scene->cbufs[cbuf].map + scene->cbufs[cbuf].sample_stride * s;
+         util_fill_box(map,
+                       format,
+                       scene->cbufs[cbuf].stride,
+                       scene->cbufs[cbuf].layer_stride,
+                       task->x,
+                       task->y,
+                       0,
+                       task->width,
+                       task->height,
+                       scene->fb_max_layer + 1,
+                       &uc);
+      }
    }
 
    /* this will increase for each rb which probably doesn't mean much */
    LP_COUNT(nr_color_tile_clear);
+   LP_THREAD_COUNT(task, TILE_CLEARS);
 }
 
 
@@ -190,7 +277,7 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
    uint32_t clear_mask = (uint32_t) clear_mask64;
    const unsigned height = task->height;
    const unsigned width = task->width;
-   const unsigned dst_stride = scene->zsbuf.stride;
+   const unsigned dst_stride = task->depth_stride;
    uint8_t *dst;
    unsigned i, j;
    unsigned block_size;
@@ -315,6 +402,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
 
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
+   LP_THREAD_COUNT(task, SHADE_TILES);
 
    state = task->state;
    assert(state);
@@ -337,7 +425,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          /* color buffer */
          for (i = 0; i < scene->fb.nr_cbufs; i++){
             if (scene->fb.cbufs[i]) {
-               stride[i] = scene->cbufs[i].stride;
+               stride[i] = task->color_stride[i];
                sample_stride[i] = scene->cbufs[i].sample_stride;
                color[i] = lp_rast_get_color_block_pointer(task, i, tile_x + x,
                                                           tile_y + y, inputs->layer + inputs->view_index);
@@ -353,13 +441,12 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          if (scene->zsbuf.map) {
             depth = lp_rast_get_depth_block_pointer(task, tile_x + x,
                                                     tile_y + y, inputs->layer + inputs->view_index);
-            depth_stride = scene->zsbuf.stride;
+            depth_stride = task->depth_stride;
             depth_sample_stride = scene->zsbuf.sample_stride;
          }
 
-         uint64_t mask = 0;
-         for (unsigned i = 0; i < scene->fb_max_samples; i++)
-            mask |= (uint64_t)(0xffff) << (16 * i);
+         uint64_t mask[LP_SAMPLE_MASK_WORDS];
+         lp_rast_expand_sample_mask(scene, 0xffff, mask);
 
          /* Propagate non-interpolated raster state. */
          task->thread_data.raster_state.viewport_index = inputs->viewport_index;
@@ -403,6 +490,7 @@ lp_rast_shade_tile_opaque(struct lp_rasterizer_task *task,
       return;
    }
 
+   LP_THREAD_COUNT(task, SHADE_TILES_OPAQUE);
    lp_rast_shade_tile(task, arg);
 }
 
@@ -417,7 +505,7 @@ void
 lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
                                 const struct lp_rast_shader_inputs *inputs,
                                 unsigned x, unsigned y,
-                                uint64_t mask)
+                                const uint64_t *mask)
 {
    const struct lp_rast_state *state = task->state;
    struct lp_fragment_shader_variant *variant = state->variant;
@@ -432,6 +520,8 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
 
    assert(state);
 
+   LP_THREAD_COUNT(task, PARTIAL_BLOCKS);
+
    /* Sanity checks */
    assert(x < scene->tiles_x * TILE_SIZE);
    assert(y < scene->tiles_y * TILE_SIZE);
@@ -444,7 +534,7 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
-         stride[i] = scene->cbufs[i].stride;
+         stride[i] = task->color_stride[i];
          sample_stride[i] = scene->cbufs[i].sample_stride;
          color[i] = lp_rast_get_color_block_pointer(task, i, x, y,
                                                     inputs->layer + inputs->view_index);
@@ -458,7 +548,7 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
 
    /* depth buffer */
    if (scene->zsbuf.map) {
-      depth_stride = scene->zsbuf.stride;
+      depth_stride = task->depth_stride;
       depth_sample_stride = scene->zsbuf.sample_stride;
       depth = lp_rast_get_depth_block_pointer(task, x, y, inputs->layer + inputs->view_index);
    }
@@ -500,9 +590,8 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned x, unsigned y,
                          unsigned mask)
 {
-   uint64_t new_mask = 0;
-   for (unsigned i = 0; i < task->scene->fb_max_samples; i++)
-      new_mask |= ((uint64_t)mask) << (16 * i);
+   uint64_t new_mask[LP_SAMPLE_MASK_WORDS];
+   lp_rast_expand_sample_mask(task->scene, mask, new_mask);
    lp_rast_shade_quads_mask_sample(task, inputs, x, y, new_mask);
 }
 
@@ -524,9 +613,6 @@ lp_rast_blit_tile_to_dest(struct lp_rasterizer_task *task,
    unsigned src_stride;
    unsigned dst_stride;
    struct pipe_surface *cbuf = scene->fb.cbufs[0];
-   const unsigned face_slice = cbuf->u.tex.first_layer;
-   const unsigned level = cbuf->u.tex.level;
-   struct llvmpipe_resource *lpt = llvmpipe_resource(cbuf->texture);
    int src_x, src_y;
 
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
@@ -536,12 +622,13 @@ lp_rast_blit_tile_to_dest(struct lp_rasterizer_task *task,
       return;
    }
 
-   dst = llvmpipe_get_texture_image_address(lpt, face_slice, level);
+   /* the tile, which may be in the tile cache */
+   dst = task->color_tiles[0];
 
    if (!dst)
       return;
 
-   dst_stride = lpt->row_stride[level];
+   dst_stride = task->color_stride[0];
 
    src = texture->base;
    src_stride = texture->row_stride[0];
@@ -558,8 +645,8 @@ lp_rast_blit_tile_to_dest(struct lp_rasterizer_task *task,
       util_fill_rect(dst,
                      cbuf->format,
                      dst_stride,
-                     task->x,
-                     task->y,
+                     0,
+                     0,
                      task->width,
                      task->height,
                      &uc);
@@ -577,7 +664,7 @@ lp_rast_blit_tile_to_dest(struct lp_rasterizer_task *task,
          util_copy_rect(dst,
                         cbuf->format,
                         dst_stride,
-                        task->x, task->y,
+                        0, 0,
                         task->width, task->height,
                         src, src_stride,
                         src_x, src_y);
@@ -588,9 +675,7 @@ lp_rast_blit_tile_to_dest(struct lp_rasterizer_task *task,
          if (cbuf->format == PIPE_FORMAT_B8G8R8A8_UNORM) {
             int x, y;
 
-            dst += task->x * 4;
             src += src_x * 4;
-            dst += task->y * dst_stride;
             src += src_y * src_stride;
 
             for (y = 0; y < task->height; ++y) {
@@ -700,6 +785,176 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
 
 
 
+/**
+ * Is the depth/stencil clear writing all bits of every pixel?
+ */
+static boolean
+is_full_zs_clear(const struct lp_scene *scene,
+                 const union lp_rast_cmd_arg arg)
+{
+   unsigned bits = scene->zsbuf.format_bytes * 8;
+   uint64_t full_mask = bits >= 64 ? ~0ULL : (1ULL << bits) - 1;
+
+   return (arg.clear_zstencil.mask & full_mask) == full_mask;
+}
+
+
+/**
+ * Minimum number of drawing commands in a bin for the tile cache to be
+ * used.  Loading and storing the tiles costs about as much as two commands
+ * shading the whole tile, which small or partially covered bins never win
+ * back.
+ */
+#define TILE_CACHE_MIN_COMMANDS 4
+
+
+/**
+ * Switch the color and depth tiles of the current bin to per-thread tile
+ * buffers, loading the framebuffer contents unless the bin starts with a
+ * clear covering them.  Only done for the general triangle path on single
+ * layer, single sample framebuffers, for bins with enough drawing commands.
+ */
+static void
+lp_rast_tile_cache_begin(struct lp_rasterizer_task *task,
+                         const struct cmd_bin *bin)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct cmd_block *block;
+   unsigned cleared_cbufs = 0;
+   boolean cleared_depth = FALSE;
+   unsigned num_commands = 0;
+   unsigned i, k;
+
+   if (scene->fb_max_layer > 0 || scene->fb_max_samples > 1)
+      return;
+
+   /* Count the drawing commands, and find clears preceding the first one */
+   for (block = bin->head;
+        block && num_commands < TILE_CACHE_MIN_COMMANDS;
+        block = block->next) {
+      for (k = 0;
+           k < block->count && num_commands < TILE_CACHE_MIN_COMMANDS;
+           k++) {
+         switch (block->cmd[k]) {
+         case LP_RAST_OP_CLEAR_COLOR:
+            if (!num_commands)
+               cleared_cbufs |= 1 << block->arg[k].clear_rb->cbuf;
+            break;
+         case LP_RAST_OP_CLEAR_ZSTENCIL:
+            if (!num_commands && is_full_zs_clear(scene, block->arg[k]))
+               cleared_depth = TRUE;
+            break;
+         case LP_RAST_OP_BEGIN_QUERY:
+         case LP_RAST_OP_END_QUERY:
+         case LP_RAST_OP_SET_STATE:
+            break;
+         default:
+            num_commands++;
+            break;
+         }
+      }
+   }
+
+   /* Too little work to pay for the load and store, clears included */
+   if (num_commands < TILE_CACHE_MIN_COMMANDS)
+      return;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      unsigned stride;
+
+      if (!scene->fb.cbufs[i])
+         continue;
+
+      if (!task->color_cache[i]) {
+         /* sized for the largest format */
+         task->color_cache[i] = align_malloc(TILE_SIZE * TILE_SIZE * 16, 64);
+         if (!task->color_cache[i])
+            continue;
+      }
+
+      stride = TILE_SIZE * scene->cbufs[i].format_bytes;
+      if (!(cleared_cbufs & (1 << i))) {
+         util_copy_rect(task->color_cache[i],
+                        scene->fb.cbufs[i]->format,
+                        stride,
+                        0, 0,
+                        task->width, task->height,
+                        task->color_tiles[i],
+                        task->color_stride[i],
+                        0, 0);
+         LP_COUNT(nr_color_tile_load);
+      }
+
+      task->color_tiles[i] = task->color_cache[i];
+      task->color_stride[i] = stride;
+      task->cached_cbufs |= 1 << i;
+   }
+
+   if (scene->fb.zsbuf) {
+      if (!task->depth_cache)
+         task->depth_cache = align_malloc(TILE_SIZE * TILE_SIZE * 8, 64);
+
+      if (task->depth_cache) {
+         unsigned stride = TILE_SIZE * scene->zsbuf.format_bytes;
+
+         if (!cleared_depth) {
+            util_copy_rect(task->depth_cache,
+                           scene->fb.zsbuf->format,
+                           stride,
+                           0, 0,
+                           task->width, task->height,
+                           task->depth_tile,
+                           task->depth_stride,
+                           0, 0);
+         }
+
+         task->depth_tile = task->depth_cache;
+         task->depth_stride = stride;
+         task->cached_depth = TRUE;
+      }
+   }
+}
+
+
+/**
+ * Write the tile buffers back to the framebuffer.
+ */
+static void
+lp_rast_tile_cache_end(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (task->cached_cbufs & (1 << i)) {
+         util_copy_rect(scene->cbufs[i].map,
+                        scene->fb.cbufs[i]->format,
+                        scene->cbufs[i].stride,
+                        task->x, task->y,
+                        task->width, task->height,
+                        task->color_tiles[i],
+                        task->color_stride[i],
+                        0, 0);
+         LP_COUNT(nr_color_tile_store);
+      }
+   }
+
+   if (task->cached_depth) {
+      util_copy_rect(scene->zsbuf.map,
+                     scene->fb.zsbuf->format,
+                     scene->zsbuf.stride,
+                     task->x, task->y,
+                     task->width, task->height,
+                     task->depth_tile,
+                     task->depth_stride,
+                     0, 0);
+   }
+
+   task->cached_cbufs = 0;
+   task->cached_depth = FALSE;
+}
+
+
 /**
  * Called when we're done writing to a color tile.
  */
@@ -712,6 +967,8 @@ lp_rast_tile_end(struct lp_rasterizer_task *task)
       lp_rast_end_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
    }
 
+   lp_rast_tile_cache_end(task);
+
    /* debug */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
@@ -1018,6 +1275,7 @@ rasterize_bin(struct lp_rasterizer_task *task,
    struct lp_bin_info info = lp_characterize_bin(bin);
 
    lp_rast_tile_begin( task, bin, x, y );
+   LP_THREAD_COUNT(task, TILES);
 
    if (LP_DEBUG & DEBUG_NO_FASTPATH)
       debug_rasterize_bin(task, bin);
@@ -1025,10 +1283,14 @@ rasterize_bin(struct lp_rasterizer_task *task,
       blit_rasterize_bin(task, bin);
    else if (task->scene->permit_linear_rasterizer &&
             !(LP_PERF & PERF_NO_RAST_LINEAR) &&
-            (info.type & LP_RAST_FLAGS_RECT))
+            (info.type & LP_RAST_FLAGS_RECT)) {
+      LP_THREAD_COUNT(task, TILES_LINEAR);
       lp_linear_rasterize_bin(task, bin);
-   else
+   } else {
+      if (LP_PERF & PERF_TILE_CACHE)
+         lp_rast_tile_cache_begin(task, bin);
       tri_rasterize_bin(task, bin, x, y);
+   }
 
    lp_rast_tile_end(task);
 
@@ -1069,6 +1331,8 @@ static void
 rasterize_scene(struct lp_rasterizer_task *task,
                 struct lp_scene *scene)
 {
+   int64_t start = os_time_get_nano();
+
    task->scene = scene;
 
    /* Clear the cache tags. This should not always be necessary but
@@ -1089,7 +1353,7 @@ rasterize_scene(struct lp_rasterizer_task *task,
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->band, &i, &j))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
          }
@@ -1111,6 +1375,12 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 #endif
 
+   /* Account before signalling, so that queries waiting on the fence see it */
+   LP_THREAD_COUNT_ADD(task, BUSY_NS, os_time_get_nano() - start);
+
+   if (p_atomic_dec_zero(&scene->rendering_tasks))
+      lp_scene_end_render(scene);
+
    if (scene->fence) {
       lp_fence_signal(scene->fence);
    }
@@ -1195,6 +1465,7 @@ thread_function(void *init_data)
    boolean debug = false;
    char thread_name[16];
    unsigned fpstate;
+   int64_t idle_start;
 
    snprintf(thread_name, sizeof thread_name, "llvmpipe-%u", task->thread_index);
    u_thread_setname(thread_name);
@@ -1205,6 +1476,7 @@ thread_function(void *init_data)
    fpstate = util_fpstate_get();
    util_fpstate_set_denorms_to_zero(fpstate);
 
+   idle_start = os_time_get_nano();
    while (1) {
       /* wait for work */
       if (debug)
@@ -1228,12 +1500,16 @@ thread_function(void *init_data)
        */
       util_barrier_wait( &rast->barrier );
 
+      LP_THREAD_COUNT_ADD(task, IDLE_NS, os_time_get_nano() - idle_start);
+
       /* do work */
       if (debug)
          debug_printf("thread %d doing work\n", task->thread_index);
 
       rasterize_scene(task,
                       rast->curr_scene);
+
+      idle_start = os_time_get_nano();
       
       /* wait for all threads to finish with this scene */
       util_barrier_wait( &rast->barrier );
@@ -1259,6 +1535,38 @@ thread_function(void *init_data)
 }
 
 
+/**
+ * Pin the threads to the L3 caches, in consecutive groups, and give each
+ * group its own band of bins.  On multi-socket machines every L3 cache
+ * lies within a single NUMA node, so a thread then mostly touches the
+ * rows of the render targets, and its tile buffers, which were first
+ * touched, thus allocated, on its own node.
+ */
+static void
+pin_rast_threads(struct lp_rasterizer *rast)
+{
+   const struct util_cpu_caps_t *caps = util_get_cpu_caps();
+   unsigned num_domains = MIN2(caps->num_L3_caches, rast->num_threads);
+   unsigned i;
+
+   if (num_domains < 2 || !caps->L3_affinity_mask)
+      return;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      unsigned domain = i * num_domains / rast->num_threads;
+
+      if (!util_set_thread_affinity(rast->threads[i],
+                                    caps->L3_affinity_mask[domain],
+                                    NULL, caps->num_cpu_mask_bits))
+         return;
+
+      rast->tasks[i].band = domain;
+   }
+
+   rast->num_bands = num_domains;
+}
+
+
 /**
  * Initialize semaphores and spawn the threads.
  */
@@ -1278,6 +1586,9 @@ create_rast_threads(struct lp_rasterizer *rast)
          break;
       }
    }
+
+   if (LP_PERF & PERF_PIN_THREADS)
+      pin_rast_threads(rast);
 }
 
 
@@ -1293,6 +1604,8 @@ lp_rast_create( unsigned num_threads )
    struct lp_rasterizer *rast;
    unsigned i;
 
+   lp_rast_tri_init();
+
    rast = CALLOC_STRUCT(lp_rasterizer);
    if (!rast) {
       goto no_rast;
@@ -1315,6 +1628,7 @@ lp_rast_create( unsigned num_threads )
    }
 
    rast->num_threads = num_threads;
+   rast->num_bands = 1;
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
@@ -1344,6 +1658,26 @@ no_rast:
 }
 
 
+/**
+ * Sum up a statistics counter over all rasterizer threads.  The threads
+ * may still be updating them, so this is only exact once the scenes of
+ * interest have been rasterized.
+ */
+uint64_t
+lp_rast_get_counter( const struct lp_rasterizer *rast,
+                     enum lp_thread_counter counter )
+{
+   uint64_t value = 0;
+   unsigned i;
+
+   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
+      value += p_atomic_read(&rast->tasks[i].counters[counter]);
+   }
+
+   return value;
+}
+
+
 /* Shutdown:
  */
 void lp_rast_destroy( struct lp_rasterizer *rast )
@@ -1381,7 +1715,13 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
       pipe_semaphore_destroy(&rast->tasks[i].work_done);
    }
    for (i = 0; i < MAX2(1, rast->num_threads); i++) {
-      align_free(rast->tasks[i].thread_data.cache);
+      struct lp_rasterizer_task *task = &rast->tasks[i];
+      unsigned j;
+
+      align_free(task->thread_data.cache);
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         align_free(task->color_cache[j]);
+      align_free(task->depth_cache);
    }
 
    /* for synchronizing rasterization threads */
@@ -41,6 +41,7 @@
 #include "util/u_pack_color.h"
 #include "util/u_rect.h"
 #include "lp_jit.h"
+#include "lp_perf.h"
 
 
 struct lp_rasterizer;
@@ -74,6 +75,27 @@ struct cmd_bin;
 struct lp_rasterizer_task;
 
 extern const float lp_sample_pos_4x[4][2];
+extern const float lp_sample_pos_8x[8][2];
+extern const float lp_sample_pos_16x[16][2];
+
+/**
+ * Sample positions within the pixel for a multisample count, or NULL if
+ * it is not supported.
+ */
+static inline const float (*
+lp_sample_pos(unsigned nr_samples))[2]
+{
+   switch (nr_samples) {
+   case 4:
+      return lp_sample_pos_4x;
+   case 8:
+      return lp_sample_pos_8x;
+   case 16:
+      return lp_sample_pos_16x;
+   default:
+      return NULL;
+   }
+}
 
 /**
  * Rasterization state.
@@ -206,6 +228,10 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 void
 lp_rast_finish( struct lp_rasterizer *rast );
 
+uint64_t
+lp_rast_get_counter( const struct lp_rasterizer *rast,
+                     enum lp_thread_counter counter );
+
 
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
@@ -54,7 +54,7 @@ lp_rast_linear_clear(struct lp_rasterizer_task *task,
    uc = arg.clear_rb->color_val;
 
    util_fill_rect(scene->cbufs[0].map,
-                  PIPE_FORMAT_B8G8R8A8_UNORM,
+                  scene->fb.cbufs[0]->format,
                   scene->cbufs[0].stride,
                   task->x,
                   task->y,
@@ -238,7 +238,7 @@ dispatch_linear[] = {
 };
 
 /* Assumptions for this path:
- *   - Single color buffer, PIPE_FORMAT_B8G8R8A8_UNORM
+ *   - Single color buffer, B8G8R8[AX]8_UNORM or B5G6R5_UNORM
  *   - No depth buffer
  *   - All primitives in bins are rect, tile, blit or clear.
  *   - All shaders have a linear variant.
@@ -103,8 +103,9 @@ shade_quads_all( struct lp_rasterizer_task *task,
    unsigned stride = scene->cbufs[0].stride;
    uint8_t *cbufs[1];
    unsigned strides[1];
+   const uint64_t mask = 0xffff;
 
-   color += x * 4;
+   color += x * scene->cbufs[0].format_bytes;
    color += y * stride;
    cbufs[0] = color;
    strides[0] = stride;
@@ -121,7 +122,7 @@ shade_quads_all( struct lp_rasterizer_task *task,
                                       (const float (*)[4])GET_DADY(inputs),
                                       cbufs,
                                       NULL,
-                                      0xffff,
+                                      &mask,
                                       &task->thread_data,
                                       strides, 0, 0, 0 );
    END_JIT_CALL();
@@ -140,8 +141,9 @@ shade_quads_mask(struct lp_rasterizer_task *task,
    unsigned stride = scene->cbufs[0].stride;
    uint8_t *cbufs[1];
    unsigned strides[1];
+   const uint64_t mask64 = mask;
 
-   color += x * 4;
+   color += x * scene->cbufs[0].format_bytes;
    color += y * stride;
    cbufs[0] = color;
    strides[0] = stride;
@@ -161,7 +163,7 @@ shade_quads_mask(struct lp_rasterizer_task *task,
                                          (const float (*)[4])GET_DADY(inputs),
                                          cbufs,
                                          NULL,
-                                         mask,
+                                         &mask64,
                                          &task->thread_data,
                                          strides, 0, 0, 0);
    END_JIT_CALL();
@@ -37,6 +37,7 @@
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 #define TILE_VECTOR_HEIGHT 4
@@ -90,6 +91,19 @@ struct lp_rasterizer_task
 
    uint8_t *color_tiles[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth_tile;
+   unsigned color_stride[PIPE_MAX_COLOR_BUFS];
+   unsigned depth_stride;
+
+   /**
+    * Per-thread tile buffers (LP_PERF=tile_cache).  When a buffer's bit
+    * is set in cached_cbufs/cached_depth, color_tiles/depth_tile point
+    * at it rather than at the framebuffer, and it is written back once
+    * in lp_rast_tile_end().
+    */
+   uint8_t *color_cache[PIPE_MAX_COLOR_BUFS];
+   uint8_t *depth_cache;
+   unsigned cached_cbufs;
+   boolean cached_depth;
 
    /** "back" pointer */
    struct lp_rasterizer *rast;
@@ -97,9 +111,15 @@ struct lp_rasterizer_task
    /** "my" index */
    unsigned thread_index;
 
+   /** Band of bins preferentially rasterized by this thread */
+   unsigned band;
+
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /** Always-on statistics, see enum lp_thread_counter */
+   uint64_t counters[LP_THREAD_COUNTER_COUNT];
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -127,6 +147,12 @@ struct lp_rasterizer
    unsigned num_threads;
    thrd_t threads[LP_MAX_THREADS];
 
+   /**
+    * Number of bands the bins are split into, one per group of threads
+    * pinned to the same L3 cache with LP_PERF=pin_threads, else one.
+    */
+   unsigned num_bands;
+
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
 };
@@ -135,7 +161,7 @@ void
 lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
                                 const struct lp_rast_shader_inputs *inputs,
                                 unsigned x, unsigned y,
-                                uint64_t mask);
+                                const uint64_t *mask);
 void
 lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          const struct lp_rast_shader_inputs *inputs,
@@ -143,6 +169,20 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned mask);
 
 
+/**
+ * Replicate a 4x4 block pixel mask to all samples of the framebuffer.
+ */
+static inline void
+lp_rast_expand_sample_mask(const struct lp_scene *scene,
+                           unsigned pixel_mask,
+                           uint64_t mask[LP_SAMPLE_MASK_WORDS])
+{
+   memset(mask, 0, LP_SAMPLE_MASK_WORDS * sizeof(uint64_t));
+   for (unsigned s = 0; s < scene->fb_max_samples; s++)
+      mask[s / 4] |= (uint64_t)pixel_mask << (16 * (s % 4));
+}
+
+
 /**
  * Get the pointer to a 4x4 color block (within a 64x64 tile).
  * \param x, y location of 4x4 block in window coords
@@ -172,7 +212,7 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
    py = y % TILE_SIZE;
 
    pixel_offset = px * task->scene->cbufs[buf].format_bytes +
-                  py * task->scene->cbufs[buf].stride;
+                  py * task->color_stride[buf];
    color = task->color_tiles[buf] + pixel_offset;
 
    if (layer) {
@@ -207,7 +247,7 @@ lp_rast_get_depth_block_pointer(struct lp_rasterizer_task *task,
    py = y % TILE_SIZE;
 
    pixel_offset = px * task->scene->zsbuf.format_bytes +
-                  py * task->scene->zsbuf.stride;
+                  py * task->depth_stride;
    depth = task->depth_tile + pixel_offset;
 
    if (layer) {
@@ -244,7 +284,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
-         stride[i] = scene->cbufs[i].stride;
+         stride[i] = task->color_stride[i];
          sample_stride[i] = scene->cbufs[i].sample_stride;
          color[i] = lp_rast_get_color_block_pointer(task, i, x, y,
                                                     inputs->layer + inputs->view_index);
@@ -259,12 +299,11 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    if (scene->zsbuf.map) {
       depth = lp_rast_get_depth_block_pointer(task, x, y, inputs->layer + inputs->view_index);
       depth_sample_stride = scene->zsbuf.sample_stride;
-      depth_stride = scene->zsbuf.stride;
+      depth_stride = task->depth_stride;
    }
 
-   uint64_t mask = 0;
-   for (unsigned i = 0; i < scene->fb_max_samples; i++)
-      mask |= (uint64_t)0xffff << (16 * i);
+   uint64_t mask[LP_SAMPLE_MASK_WORDS];
+   lp_rast_expand_sample_mask(scene, 0xffff, mask);
 
    /*
     * The rasterizer may produce fragments outside our
@@ -348,6 +387,22 @@ void lp_rast_triangle_32_3_16( struct lp_rasterizer_task *,
 void lp_rast_triangle_32_4_16( struct lp_rasterizer_task *, 
                             const union lp_rast_cmd_arg );
 
+/* 256/512-bit variants of lp_rast_triangle_32_3_16, in their own files
+ * built with the matching -m flags.
+ */
+void lp_rast_triangle_32_3_16_avx2( struct lp_rasterizer_task *,
+                                    const union lp_rast_cmd_arg );
+
+void lp_rast_triangle_32_3_16_avx512( struct lp_rasterizer_task *,
+                                      const union lp_rast_cmd_arg );
+
+void lp_rast_shade_block_16_rows( struct lp_rasterizer_task *task,
+                                  const struct lp_rast_shader_inputs *inputs,
+                                  int x, int y,
+                                  const uint16_t rows[16] );
+
+void lp_rast_tri_init( void );
+
 
 void lp_rast_rectangle( struct lp_rasterizer_task *, 
                         const union lp_rast_cmd_arg );
@@ -31,6 +31,7 @@
 
 #include <limits.h>
 #include "util/u_math.h"
+#include "util/u_cpu_detect.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
 #include "lp_rast_priv.h"
@@ -160,12 +161,67 @@ lp_rast_triangle_ms_4_16(struct lp_rasterizer_task *task,
    lp_rast_triangle_ms_4(task, arg2);
 }
 
+/* Widest coverage evaluation the CPU supports, see lp_rast_tri_init() */
+static void
+(*triangle_32_3_16_wide)(struct lp_rasterizer_task *task,
+                         const union lp_rast_cmd_arg arg);
+
+void
+lp_rast_tri_init(void)
+{
+   triangle_32_3_16_wide = NULL;
+
+   if (LP_PERF & PERF_NO_WIDE_RAST)
+      return;
+
+#if defined(PIPE_ARCH_SSE) && defined(LP_HAVE_AVX512)
+   if (util_get_cpu_caps()->has_avx512f) {
+      triangle_32_3_16_wide = lp_rast_triangle_32_3_16_avx512;
+      return;
+   }
+#endif
+#if defined(PIPE_ARCH_SSE) && defined(LP_HAVE_AVX2)
+   if (util_get_cpu_caps()->has_avx2)
+      triangle_32_3_16_wide = lp_rast_triangle_32_3_16_avx2;
+#endif
+}
+
+
 #if defined(PIPE_ARCH_SSE)
 
 #include <emmintrin.h>
 #include "util/u_sse.h"
 
 
+/**
+ * Shade the 4x4 blocks of a 16x16 block, given a row-major bitmask of
+ * its uncovered pixels (bit x of rows[y] set means (x, y) is outside).
+ */
+void
+lp_rast_shade_block_16_rows(struct lp_rasterizer_task *task,
+                            const struct lp_rast_shader_inputs *inputs,
+                            int x, int y,
+                            const uint16_t rows[16])
+{
+   unsigned i, j;
+
+   for (i = 0; i < 4; i++) {
+      for (j = 0; j < 4; j++) {
+         unsigned mask =
+            ((rows[4 * i + 0] >> (4 * j)) & 0xf) |
+            ((rows[4 * i + 1] >> (4 * j)) & 0xf) << 4 |
+            ((rows[4 * i + 2] >> (4 * j)) & 0xf) << 8 |
+            ((rows[4 * i + 3] >> (4 * j)) & 0xf) << 12;
+
+         if (mask != 0xffff)
+            lp_rast_shade_quads_mask(task, inputs,
+                                     x + 4 * j, y + 4 * i,
+                                     0xffff & ~mask);
+      }
+   }
+}
+
+
 static inline void
 build_masks_sse(int c,
                 int cdiff,
@@ -302,6 +358,13 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    struct { unsigned mask:16; unsigned i:8; unsigned j:8; } out[16];
    unsigned nr = 0;
 
+   LP_THREAD_COUNT(task, BLOCKS_16);
+   if (triangle_32_3_16_wide) {
+      LP_THREAD_COUNT(task, BLOCKS_16_WIDE);
+      triangle_32_3_16_wide(task, arg);
+      return;
+   }
+
    /* p0 and p2 are aligned, p1 is not (plane size 24 bytes). */
    __m128i p0 = _mm_load_si128((__m128i *)&plane[0]); /* clo, chi, dcdx, dcdy */
    __m128i p1 = _mm_loadu_si128((__m128i *)&plane[1]);
@@ -0,0 +1,86 @@
+/**************************************************************************
+ *
+ * Copyright 2022 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * AVX2 coverage evaluation for small triangles.  This file is built
+ * with -mavx2, and only called when the CPU supports it.
+ */
+
+#include <immintrin.h>
+#include "lp_rast_priv.h"
+
+
+/**
+ * Same as the SSE lp_rast_triangle_32_3_16(), but instead of evaluating
+ * the three edge functions one 4x4 block at a time, evaluate them for
+ * whole 16 pixel rows of the 16x16 block, eight pixels per vector.
+ */
+void
+lp_rast_triangle_32_3_16_avx2(struct lp_rasterizer_task *task,
+                              const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   const struct lp_rast_plane *plane = GET_PLANES(tri);
+   int x = (arg.triangle.plane_mask & 0xff) + task->x;
+   int y = (arg.triangle.plane_mask >> 8) + task->y;
+   const __m256i ramp = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+   __m256i c_lo[3], c_hi[3], dcdy[3];
+   uint16_t rows[16];
+   unsigned i;
+
+   for (i = 0; i < 3; i++) {
+      /* Same wrapping 32-bit arithmetic as the SSE path, with dcdx negated
+       * and c biased so that the sign bit alone means "outside".
+       */
+      uint32_t dcdx = -(uint32_t)plane[i].dcdx;
+      uint32_t c = (uint32_t)plane[i].c + dcdx * x +
+                   (uint32_t)plane[i].dcdy * y - 1;
+      __m256i vdcdx = _mm256_set1_epi32(dcdx);
+
+      c_lo[i] = _mm256_add_epi32(_mm256_set1_epi32(c),
+                                 _mm256_mullo_epi32(vdcdx, ramp));
+      c_hi[i] = _mm256_add_epi32(c_lo[i], _mm256_slli_epi32(vdcdx, 3));
+      dcdy[i] = _mm256_set1_epi32(plane[i].dcdy);
+   }
+
+   for (i = 0; i < 16; i++) {
+      __m256i lo = _mm256_or_si256(_mm256_or_si256(c_lo[0], c_lo[1]), c_lo[2]);
+      __m256i hi = _mm256_or_si256(_mm256_or_si256(c_hi[0], c_hi[1]), c_hi[2]);
+
+      rows[i] = _mm256_movemask_ps(_mm256_castsi256_ps(lo)) |
+                _mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8;
+
+      c_lo[0] = _mm256_add_epi32(c_lo[0], dcdy[0]);
+      c_lo[1] = _mm256_add_epi32(c_lo[1], dcdy[1]);
+      c_lo[2] = _mm256_add_epi32(c_lo[2], dcdy[2]);
+      c_hi[0] = _mm256_add_epi32(c_hi[0], dcdy[0]);
+      c_hi[1] = _mm256_add_epi32(c_hi[1], dcdy[1]);
+      c_hi[2] = _mm256_add_epi32(c_hi[2], dcdy[2]);
+   }
+
+   lp_rast_shade_block_16_rows(task, &tri->inputs, x, y, rows);
+}
@@ -0,0 +1,77 @@
+/**************************************************************************
+ *
+ * Copyright 2022 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * AVX-512 coverage evaluation for small triangles.  This file is built
+ * with -mavx512f, and only called when the CPU supports it.
+ */
+
+#include <immintrin.h>
+#include "lp_rast_priv.h"
+
+
+/**
+ * As lp_rast_triangle_32_3_16_avx2(), but a whole 16 pixel row fits in
+ * a single vector, and the compare produces the row mask directly.
+ */
+void
+lp_rast_triangle_32_3_16_avx512(struct lp_rasterizer_task *task,
+                                const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   const struct lp_rast_plane *plane = GET_PLANES(tri);
+   int x = (arg.triangle.plane_mask & 0xff) + task->x;
+   int y = (arg.triangle.plane_mask >> 8) + task->y;
+   const __m512i ramp = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                                          8, 9, 10, 11, 12, 13, 14, 15);
+   const __m512i zero = _mm512_setzero_si512();
+   __m512i c[3], dcdy[3];
+   uint16_t rows[16];
+   unsigned i;
+
+   for (i = 0; i < 3; i++) {
+      uint32_t dcdx = -(uint32_t)plane[i].dcdx;
+      uint32_t c0 = (uint32_t)plane[i].c + dcdx * x +
+                    (uint32_t)plane[i].dcdy * y - 1;
+
+      c[i] = _mm512_add_epi32(_mm512_set1_epi32(c0),
+                              _mm512_mullo_epi32(_mm512_set1_epi32(dcdx), ramp));
+      dcdy[i] = _mm512_set1_epi32(plane[i].dcdy);
+   }
+
+   for (i = 0; i < 16; i++) {
+      __m512i v = _mm512_or_si512(_mm512_or_si512(c[0], c[1]), c[2]);
+
+      rows[i] = _mm512_cmplt_epi32_mask(v, zero);
+
+      c[0] = _mm512_add_epi32(c[0], dcdy[0]);
+      c[1] = _mm512_add_epi32(c[1], dcdy[1]);
+      c[2] = _mm512_add_epi32(c[2], dcdy[2]);
+   }
+
+   lp_rast_shade_block_16_rows(task, &tri->inputs, x, y, rows);
+}
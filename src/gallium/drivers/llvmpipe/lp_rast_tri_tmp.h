@@ -50,7 +50,9 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
 #ifndef MULTISAMPLE
    unsigned mask = 0xffff;
 #else
-   uint64_t mask = UINT64_MAX;
+   const unsigned nr_samples = task->scene->fb_max_samples;
+   uint64_t mask[LP_SAMPLE_MASK_WORDS];
+   lp_rast_expand_sample_mask(task->scene, 0xffff, mask);
 #endif
 
    for (j = 0; j < NR_PLANES; j++) {
@@ -65,7 +67,7 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
                                  plane[j].dcdy);
 #endif
 #else
-      for (unsigned s = 0; s < 4; s++) {
+      for (unsigned s = 0; s < nr_samples; s++) {
          int64_t new_c = (c[j]) + ((IMUL64(task->scene->fixed_sample_pos[s][1], plane[j].dcdy) + IMUL64(task->scene->fixed_sample_pos[s][0], -plane[j].dcdx)) >> FIXED_ORDER);
          uint32_t build_mask;
 #ifdef RASTER_64
@@ -77,15 +79,25 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
                                         -plane[j].dcdx,
                                         plane[j].dcdy);
 #endif
-         mask &= ~((uint64_t)build_mask << (s * 16));
+         mask[s / 4] &= ~((uint64_t)build_mask << ((s % 4) * 16));
       }
 #endif
    }
 
    /* Now pass to the shader:
     */
-   if (mask)
+#ifndef MULTISAMPLE
+   if (mask) {
+      const uint64_t mask64 = mask;
+      lp_rast_shade_quads_mask_sample(task, &tri->inputs, x, y, &mask64);
+   }
+#else
+   uint64_t any = 0;
+   for (j = 0; j < LP_SAMPLE_MASK_WORDS; j++)
+      any |= mask[j];
+   if (any)
       lp_rast_shade_quads_mask_sample(task, &tri->inputs, x, y, mask);
+#endif
 }
 
 /**
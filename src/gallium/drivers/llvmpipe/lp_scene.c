@@ -35,6 +35,8 @@
 #include "lp_debug.h"
 #include "lp_context.h"
 #include "lp_state_fs.h"
+#include "lp_texture.h"
+#include "lp_screen.h"
 
 #include "lp_setup_context.h"
 
@@ -193,6 +195,20 @@ init_scene_texture(struct lp_scene_surface *ssurf, struct pipe_surface *psurf)
    }
 }
 
+static void
+resolve_fast_clears(struct resource_ref *ref)
+{
+   int i;
+
+   for (; ref; ref = ref->next) {
+      for (i = 0; i < ref->count; i++) {
+         if (llvmpipe_resource_is_texture(ref->resource[i]))
+            llvmpipe_resource_resolve_fast_clear(
+               llvmpipe_resource(ref->resource[i]));
+      }
+   }
+}
+
 void
 lp_scene_begin_rasterization(struct lp_scene *scene)
 {
@@ -201,9 +217,30 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
    //LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
+   /* Shaders access textures and images directly, so any pending fast
+    * clear of them must be written out first.
+    */
+   resolve_fast_clears(scene->resources);
+   resolve_fast_clears(scene->writeable_resources);
+
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       struct pipe_surface *cbuf = scene->fb.cbufs[i];
       init_scene_texture(&scene->cbufs[i], cbuf);
+
+      scene->cbufs[i].cleared = NULL;
+      if (cbuf && llvmpipe_resource_is_texture(cbuf->texture)) {
+         struct llvmpipe_resource *lpr = llvmpipe_resource(cbuf->texture);
+
+         if (scene->fast_clear_mask & (1 << i))
+            llvmpipe_resource_fast_clear(lpr, cbuf->format,
+                                         &scene->fast_clear_color[i]);
+         else if (cbuf->u.tex.level != 0)
+            llvmpipe_resource_resolve_fast_clear(lpr);
+
+         /* Tiles the scene renders to are resolved by lp_rast_tile_begin */
+         if (llvmpipe_resource_begin_render(lpr))
+            scene->cbufs[i].cleared = lpr;
+      }
    }
 
    if (fb->zsbuf) {
@@ -215,6 +252,25 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 
 
+/**
+ * Called by the last rasterizer thread done with the scene, before the
+ * scene's fence is signalled: from then on the fast cleared color buffers
+ * may be resolved as a whole again.
+ */
+void
+lp_scene_end_render(struct lp_scene *scene)
+{
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->cbufs[i].cleared) {
+         llvmpipe_resource_end_render(scene->cbufs[i].cleared);
+         scene->cbufs[i].cleared = NULL;
+      }
+   }
+}
+
+
 /**
  * Free all the temporary data in a scene.
  */
@@ -306,16 +362,63 @@ lp_scene_end_rasterization(struct lp_scene *scene )
       }
    }
 
-   /* Free all scene data blocks:
+   /* Return all scene data blocks to the setup context, for the
+    * following scenes to reuse:
     */
    {
+      struct lp_setup_context *setup = scene->setup;
       struct data_block_list *list = &scene->data;
       struct data_block *block, *tmp;
+      unsigned num_blocks, max_blocks, i;
+
+      lp_screen_count_scene_size(llvmpipe_screen(scene->pipe->screen),
+                                 scene->scene_size);
+
+      if (scene->scene_size >= setup->scene_max_size / 4)
+         setup->num_small_scenes = 0;
+      else if (++setup->num_small_scenes >= MAX_SCENES) {
+         setup->scene_max_size = MAX2(setup->scene_max_size / 2,
+                                      LP_SCENE_MAX_SIZE);
+         setup->num_small_scenes = 0;
+      }
+
+      /* Keep as many blocks as the largest of the last MAX_SCENES scenes
+       * used.  That covers the working set of frames alternating between
+       * small and large scenes, while the memory of a single huge scene is
+       * released once it drops out of the window.
+       */
+      num_blocks = 0;
+      for (block = list->head; block; block = block->next) {
+         if (block != &list->first)
+            num_blocks++;
+      }
+
+      setup->scene_blocks[setup->scene_blocks_idx] = num_blocks;
+      setup->scene_blocks_idx = (setup->scene_blocks_idx + 1) % MAX_SCENES;
+
+      max_blocks = 0;
+      for (i = 0; i < MAX_SCENES; i++)
+         max_blocks = MAX2(max_blocks, setup->scene_blocks[i]);
 
       for (block = list->head; block; block = tmp) {
          tmp = block->next;
-         if (block != &list->first)
+         if (block == &list->first)
+            continue;
+         if (setup->num_free_blocks < max_blocks) {
+            block->next = setup->free_blocks;
+            setup->free_blocks = block;
+            setup->num_free_blocks++;
+         }
+         else {
             FREE(block);
+         }
+      }
+
+      while (setup->num_free_blocks > max_blocks) {
+         block = setup->free_blocks;
+         setup->free_blocks = block->next;
+         setup->num_free_blocks--;
+         FREE(block);
       }
 
       list->head = &list->first;
@@ -365,15 +468,35 @@ lp_scene_new_cmd_block( struct lp_scene *scene,
 struct data_block *
 lp_scene_new_data_block( struct lp_scene *scene )
 {
-   if (scene->scene_size + DATA_BLOCK_SIZE > LP_SCENE_MAX_SIZE) {
+   struct lp_setup_context *setup = scene->setup;
+
+   if (scene->scene_size + DATA_BLOCK_SIZE > setup->scene_max_size) {
       if (0) debug_printf("%s: failed\n", __FUNCTION__);
+      if (!scene->alloc_failed) {
+         struct llvmpipe_screen *screen = llvmpipe_screen(scene->pipe->screen);
+
+         /* Let the following scenes grow, rather than flush again */
+         p_atomic_inc(&screen->num_scene_size_flushes);
+         setup->scene_max_size = MIN2(setup->scene_max_size * 2,
+                                      LP_SCENE_MAX_SIZE_LIMIT);
+         setup->num_small_scenes = 0;
+      }
       scene->alloc_failed = TRUE;
       return NULL;
    }
    else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
-      if (!block)
-         return NULL;
+      struct data_block *block = setup->free_blocks;
+
+      if (block) {
+         setup->free_blocks = block->next;
+         setup->num_free_blocks--;
+      }
+      else {
+         block = MALLOC_STRUCT(data_block);
+         if (!block)
+            return NULL;
+         p_atomic_inc(&llvmpipe_screen(scene->pipe->screen)->num_scene_block_allocs);
+      }
 
       scene->scene_size += sizeof *block;
 
@@ -546,59 +669,57 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Split the bins into num_bands bands of whole tile rows, for threads
+ * which prefer rasterizing the bins of their own band.  A single band
+ * walks the bins in the usual row-major order.
+ */
+void
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_bands )
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
-}
+   unsigned i;
 
+   scene->num_bands = MAX2(1, MIN3(num_bands, scene->tiles_y, LP_MAX_THREADS));
 
-void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
-{
-   scene->curr_x = scene->curr_y = -1;
+   for (i = 0; i < scene->num_bands; i++) {
+      scene->band_next[i] = scene->tiles_y * i / scene->num_bands *
+                            scene->tiles_x;
+      scene->band_end[i] = scene->tiles_y * (i + 1) / scene->num_bands *
+                           scene->tiles_x;
+   }
 }
 
 
 /**
  * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  Bins of the given band are handed out
+ * from its top; once it is done, the remaining bins of the other bands
+ * are taken from their bottom, away from the threads owning them.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned band,
+                        int *x, int *y )
 {
    struct cmd_bin *bin = NULL;
+   unsigned i, idx;
 
    mtx_lock(&scene->mutex);
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
-   }
+   band %= scene->num_bands;
+
+   for (i = 0; i < scene->num_bands; i++) {
+      unsigned b = (band + i) % scene->num_bands;
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+      if (scene->band_next[b] < scene->band_end[b]) {
+         idx = i == 0 ? scene->band_next[b]++ : --scene->band_end[b];
+         *x = idx % scene->tiles_x;
+         *y = idx / scene->tiles_x;
+         bin = lp_scene_get_bin(scene, *x, *y);
+         break;
+      }
+   }
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
    mtx_unlock(&scene->mutex);
    return bin;
 }
@@ -643,10 +764,13 @@ void lp_scene_begin_binning(struct lp_scene *scene,
    }
    scene->fb_max_layer = max_layer;
    scene->fb_max_samples = util_framebuffer_get_num_samples(fb);
-   if (scene->fb_max_samples == 4) {
-      for (unsigned i = 0; i < 4; i++) {
-         scene->fixed_sample_pos[i][0] = util_iround(lp_sample_pos_4x[i][0] * FIXED_ONE);
-         scene->fixed_sample_pos[i][1] = util_iround(lp_sample_pos_4x[i][1] * FIXED_ONE);
+   scene->fast_clear_mask = 0;
+   if (scene->fb_max_samples > 1) {
+      const float (*sample_pos)[2] = lp_sample_pos(scene->fb_max_samples);
+      assert(sample_pos);
+      for (unsigned i = 0; i < scene->fb_max_samples; i++) {
+         scene->fixed_sample_pos[i][0] = util_iround(sample_pos[i][0] * FIXED_ONE);
+         scene->fixed_sample_pos[i][1] = util_iround(sample_pos[i][1] * FIXED_ONE);
       }
    }
 }
@@ -41,6 +41,7 @@
 
 struct lp_scene_queue;
 struct lp_rast_state;
+struct llvmpipe_resource;
 
 /* We're limited to 2K by 2K for 32bit fixed point rasterization.
  * Will need a 64-bit version for larger framebuffers.
@@ -59,9 +60,13 @@ struct lp_rast_state;
  */
 #define DATA_BLOCK_SIZE (64 * 1024)
 
-/* Scene temporary storage is clamped to this size:
+/* Scene temporary storage is initially clamped to this size.  Every
+ * scene which has to be flushed early on the clamp doubles it for the
+ * following scenes, up to LP_SCENE_MAX_SIZE_LIMIT, and it is halved
+ * again after MAX_SCENES scenes in a row used less than a quarter of it:
  */
 #define LP_SCENE_MAX_SIZE (36*1024*1024)
+#define LP_SCENE_MAX_SIZE_LIMIT (8*LP_SCENE_MAX_SIZE)
 
 /* The maximum amount of texture storage referenced by a scene is
  * clamped to this size:
@@ -127,6 +132,8 @@ struct lp_scene_surface {
    unsigned format_bytes;
    unsigned sample_stride;
    unsigned nr_samples;
+   /* fast cleared resource whose tiles are resolved on first use */
+   struct llvmpipe_resource *cleared;
 };
 
 /**
@@ -153,6 +160,9 @@ struct lp_scene {
     */
    struct lp_scene_surface zsbuf, cbufs[PIPE_MAX_COLOR_BUFS];
 
+   /* Rasterizer threads still working on the scene */
+   unsigned rendering_tasks;
+
    /* The amount of layers in the fb (minimum of all attachments) */
    unsigned fb_max_layer;
 
@@ -162,6 +172,12 @@ struct lp_scene {
    /* max samples for bound framebuffer */
    unsigned fb_max_samples;
 
+   /* color buffers cleared by deferring the clear to the resource's
+    * tiles instead of binning clear commands, and their clear values
+    */
+   unsigned fast_clear_mask;
+   union util_color fast_clear_color[PIPE_MAX_COLOR_BUFS];
+
    /** the framebuffer to render the scene into */
    struct pipe_framebuffer_state fb;
 
@@ -194,7 +210,14 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
+   /**
+    * For iterating over bins.  The bins are split into num_bands bands of
+    * whole tile rows, band_next and band_end bounding the bins of each
+    * band that are yet to be rasterized.
+    */
+   unsigned num_bands;
+   unsigned band_next[LP_MAX_THREADS];
+   unsigned band_end[LP_MAX_THREADS];
    mtx_t mutex;
 
    struct cmd_bin tile[TILES_X][TILES_Y];
@@ -243,9 +266,9 @@ lp_scene_alloc( struct lp_scene *scene, unsigned size)
    assert(block != NULL);
 
    if (LP_DEBUG & DEBUG_MEM)
-      debug_printf("alloc %u block %u/%u tot %u/%u\n",
+      debug_printf("alloc %u block %u/%u tot %u\n",
 		   size, block->used, (unsigned)DATA_BLOCK_SIZE,
-		   scene->scene_size, LP_SCENE_MAX_SIZE);
+		   scene->scene_size);
 
    if (block->used + size > DATA_BLOCK_SIZE) {
       block = lp_scene_new_data_block( scene );
@@ -276,10 +299,10 @@ lp_scene_alloc_aligned( struct lp_scene *scene, unsigned size,
    assert(block != NULL);
 
    if (LP_DEBUG & DEBUG_MEM)
-      debug_printf("alloc %u block %u/%u tot %u/%u\n",
+      debug_printf("alloc %u block %u/%u tot %u\n",
 		   size + alignment - 1,
 		   block->used, (unsigned)DATA_BLOCK_SIZE,
-		   scene->scene_size, LP_SCENE_MAX_SIZE);
+		   scene->scene_size);
        
    if (block->used + size + alignment - 1 > DATA_BLOCK_SIZE) {
       block = lp_scene_new_data_block( scene );
@@ -394,10 +417,11 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_bands );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned band,
+                        int *x, int *y );
 
 
 
@@ -416,6 +440,9 @@ lp_scene_end_binning(struct lp_scene *scene);
 void
 lp_scene_begin_rasterization(struct lp_scene *scene);
 
+void
+lp_scene_end_render(struct lp_scene *scene);
+
 void
 lp_scene_end_rasterization(struct lp_scene *scene);
 
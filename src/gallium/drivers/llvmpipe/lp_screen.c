@@ -39,6 +39,7 @@
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_nir.h"
 #include "util/disk_cache.h"
+#include "util/hash_table.h"
 #include "util/os_misc.h"
 #include "util/os_time.h"
 #include "lp_texture.h"
@@ -46,6 +47,7 @@
 #include "lp_jit.h"
 #include "lp_screen.h"
 #include "lp_context.h"
+#include "lp_query.h"
 #include "lp_debug.h"
 #include "lp_public.h"
 #include "lp_limits.h"
@@ -95,6 +97,10 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
    { "no_rast_linear", PERF_NO_RAST_LINEAR, NULL },
    { "no_shade",       PERF_NO_SHADE, NULL },
+   { "no_wide_rast",   PERF_NO_WIDE_RAST, NULL },
+   { "no_fast_clear",  PERF_NO_FAST_CLEAR, NULL },
+   { "tile_cache",     PERF_TILE_CACHE, NULL },
+   { "pin_threads",    PERF_PIN_THREADS, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -679,7 +685,7 @@ llvmpipe_is_format_supported( struct pipe_screen *_screen,
           target == PIPE_TEXTURE_CUBE ||
           target == PIPE_TEXTURE_CUBE_ARRAY);
 
-   if (sample_count != 0 && sample_count != 1 && sample_count != 4)
+   if (sample_count > 1 && !lp_sample_pos(sample_count))
       return false;
 
    if (MAX2(1, sample_count) != MAX2(1, storage_sample_count))
@@ -838,12 +844,67 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
       winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
 }
 
+/* Upper bound on the object code kept in the in-memory shader cache */
+#define LP_MAX_SHADER_CACHE_SIZE (64 * 1024 * 1024)
+
+struct lp_shader_cache_entry {
+   unsigned char sha1[20];
+   size_t data_size;
+   uint8_t data[];
+};
+
+static uint32_t
+lp_shader_cache_hash(const void *key)
+{
+   return _mesa_hash_data(key, 20);
+}
+
+static bool
+lp_shader_cache_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, 20) == 0;
+}
+
+static void
+lp_shader_cache_entry_free(struct hash_entry *entry)
+{
+   FREE(entry->data);
+}
+
+/* Must be called with shader_cache_mutex held. */
+static void
+lp_shader_cache_insert_locked(struct llvmpipe_screen *screen,
+                              const void *data, size_t data_size,
+                              const unsigned char ir_sha1_cache_key[20])
+{
+   struct lp_shader_cache_entry *entry;
+
+   if (!screen->shader_cache ||
+       screen->shader_cache_size + data_size > LP_MAX_SHADER_CACHE_SIZE ||
+       _mesa_hash_table_search(screen->shader_cache, ir_sha1_cache_key))
+      return;
+
+   entry = MALLOC(sizeof(*entry) + data_size);
+   if (!entry)
+      return;
+
+   memcpy(entry->sha1, ir_sha1_cache_key, 20);
+   entry->data_size = data_size;
+   memcpy(entry->data, data, data_size);
+
+   _mesa_hash_table_insert(screen->shader_cache, entry->sha1, entry);
+   screen->shader_cache_size += data_size;
+}
+
 static void
 llvmpipe_destroy_screen( struct pipe_screen *_screen )
 {
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
 
+   if (util_queue_is_initialized(&screen->compile_queue))
+      util_queue_destroy(&screen->compile_queue);
+
    if (screen->cs_tpool)
       lp_cs_tpool_destroy(screen->cs_tpool);
 
@@ -852,10 +913,14 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    lp_jit_screen_cleanup(screen);
 
-   if (LP_DEBUG & DEBUG_CACHE_STATS)
+   if (LP_DEBUG & DEBUG_CACHE_STATS) {
       printf("disk shader cache:   hits = %u, misses = %u\n", screen->num_disk_shader_cache_hits,
              screen->num_disk_shader_cache_misses);
+      printf("memory shader cache: hits = %u, size = %zu\n", screen->num_shader_cache_hits,
+             screen->shader_cache_size);
+   }
    disk_cache_destroy(screen->disk_shader_cache);
+   _mesa_hash_table_destroy(screen->shader_cache, lp_shader_cache_entry_free);
    if(winsys->destroy)
       winsys->destroy(winsys);
 
@@ -863,6 +928,7 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    mtx_destroy(&screen->rast_mutex);
    mtx_destroy(&screen->cs_mutex);
+   mtx_destroy(&screen->shader_cache_mutex);
    FREE(screen);
 }
 
@@ -951,11 +1017,34 @@ static struct disk_cache *lp_get_disk_shader_cache(struct pipe_screen *_screen)
    return screen->disk_shader_cache;
 }
 
+/*
+ * Look up the object code for a shader, first in the screen's in-memory
+ * cache (so contexts sharing this screen don't compile the same shader
+ * twice) and then in the on-disk cache.  The returned data is owned by
+ * the caller.
+ */
 void lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
                                struct lp_cached_code *cache,
                                unsigned char ir_sha1_cache_key[20])
 {
    unsigned char sha1[CACHE_KEY_SIZE];
+   struct hash_entry *he = NULL;
+
+   mtx_lock(&screen->shader_cache_mutex);
+   if (screen->shader_cache)
+      he = _mesa_hash_table_search(screen->shader_cache, ir_sha1_cache_key);
+   if (he) {
+      struct lp_shader_cache_entry *entry = he->data;
+      cache->data = malloc(entry->data_size);
+      if (cache->data) {
+         memcpy(cache->data, entry->data, entry->data_size);
+         cache->data_size = entry->data_size;
+         screen->num_shader_cache_hits++;
+         mtx_unlock(&screen->shader_cache_mutex);
+         return;
+      }
+   }
+   mtx_unlock(&screen->shader_cache_mutex);
 
    if (!screen->disk_shader_cache)
       return;
@@ -971,6 +1060,10 @@ void lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
    cache->data_size = binary_size;
    cache->data = buffer;
    p_atomic_inc(&screen->num_disk_shader_cache_hits);
+
+   mtx_lock(&screen->shader_cache_mutex);
+   lp_shader_cache_insert_locked(screen, buffer, binary_size, ir_sha1_cache_key);
+   mtx_unlock(&screen->shader_cache_mutex);
 }
 
 void lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
@@ -979,7 +1072,14 @@ void lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
 {
    unsigned char sha1[CACHE_KEY_SIZE];
 
-   if (!screen->disk_shader_cache || !cache->data_size || cache->dont_cache)
+   if (!cache->data_size || cache->dont_cache)
+      return;
+
+   mtx_lock(&screen->shader_cache_mutex);
+   lp_shader_cache_insert_locked(screen, cache->data, cache->data_size, ir_sha1_cache_key);
+   mtx_unlock(&screen->shader_cache_mutex);
+
+   if (!screen->disk_shader_cache)
       return;
    disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key, 20, sha1);
    disk_cache_put(screen->disk_shader_cache, sha1, cache->data, cache->data_size, NULL);
@@ -1068,6 +1168,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 
    screen->base.get_disk_shader_cache = lp_get_disk_shader_cache;
    llvmpipe_init_screen_resource_funcs(&screen->base);
+   llvmpipe_init_screen_query_funcs(&screen->base);
 
    screen->allow_cl = !!getenv("LP_CL");
    screen->use_tgsi = (LP_DEBUG & DEBUG_TGSI_IR);
@@ -1087,5 +1188,24 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 
    (void) mtx_init(&screen->late_mutex, mtx_plain);
 
+   (void) mtx_init(&screen->shader_cache_mutex, mtx_plain);
+   screen->shader_cache = _mesa_hash_table_create(NULL, lp_shader_cache_hash,
+                                                  lp_shader_cache_equal);
+
+#ifndef USE_GLOBAL_LLVM_CONTEXT
+   /* Shaders compiled in the background need an LLVM context of their own.
+    * Off by default: the speculative key only matches simple untextured
+    * shaders, so check nr_fs_precompile_hits against nr_fs_precompiles for
+    * a workload before enabling it.
+    */
+   if (screen->num_threads &&
+       debug_get_bool_option("LP_ASYNC_COMPILE", false)) {
+      util_queue_init(&screen->compile_queue, "lpc", 64,
+                      MAX2(screen->num_threads / 4, 1),
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY, NULL);
+   }
+#endif
+
    return &screen->base;
 }
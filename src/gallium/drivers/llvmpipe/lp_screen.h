@@ -39,6 +39,8 @@
 #include "os/os_thread.h"
 #include "gallivm/lp_bld.h"
 #include "gallivm/lp_bld_misc.h"
+#include "util/u_queue.h"
+#include "util/u_atomic.h"
 
 struct sw_winsys;
 struct lp_cs_tpool;
@@ -72,6 +74,33 @@ struct llvmpipe_screen
    struct disk_cache *disk_shader_cache;
    unsigned num_disk_shader_cache_hits;
    unsigned num_disk_shader_cache_misses;
+
+   /* In-memory cache of compiled shader objects, shared by all contexts
+    * of this screen, so that a shader/key pair compiled by one context is
+    * only relinked (not recompiled) by the others.
+    */
+   mtx_t shader_cache_mutex;
+   struct hash_table *shader_cache;
+   size_t shader_cache_size;
+   unsigned num_shader_cache_hits;
+
+   /* Background compilation of shader variants, see LP_ASYNC_COMPILE */
+   struct util_queue compile_queue;
+
+   /* Shader variant compilations, for the driver-specific queries */
+   unsigned num_llvm_compiles;
+   uint64_t llvm_compile_time; /* in microseconds */
+
+   /* Draws, and how many of them could use the linear rasterizer */
+   unsigned num_draws;
+   unsigned num_linear_draws;
+
+   /* Scene data blocks malloc'ed, scenes flushed early for their size
+    * and the largest scene so far, in bytes
+    */
+   unsigned num_scene_block_allocs;
+   unsigned num_scene_size_flushes;
+   unsigned scene_size_peak;
 };
 
 void lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
@@ -89,6 +118,34 @@ llvmpipe_screen( struct pipe_screen *pipe )
    return (struct llvmpipe_screen *)pipe;
 }
 
+static inline void
+lp_screen_count_compile(struct llvmpipe_screen *screen, int64_t time)
+{
+   p_atomic_inc(&screen->num_llvm_compiles);
+   p_atomic_add(&screen->llvm_compile_time, time);
+}
+
+static inline void
+lp_screen_count_draw(struct llvmpipe_screen *screen, boolean linear)
+{
+   p_atomic_inc(&screen->num_draws);
+   if (linear)
+      p_atomic_inc(&screen->num_linear_draws);
+}
+
+static inline void
+lp_screen_count_scene_size(struct llvmpipe_screen *screen, unsigned size)
+{
+   unsigned peak = p_atomic_read(&screen->scene_size_peak);
+
+   while (size > peak) {
+      unsigned old = p_atomic_cmpxchg(&screen->scene_size_peak, peak, size);
+      if (old == peak)
+         break;
+      peak = old;
+   }
+}
+
 static inline unsigned lp_get_constant_buffer_stride(struct pipe_screen *_screen)
 {
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
@@ -223,6 +223,34 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
 
 
 
+/**
+ * Can the clear of a color buffer at the start of a scene be recorded in
+ * the resource's tile state, rather than binned to every tile?  The
+ * surface must cover the whole of a resource which tracks its tiles.
+ */
+static boolean
+lp_setup_can_fast_clear(const struct lp_setup_context *setup,
+                        const struct pipe_surface *cbuf)
+{
+   const struct llvmpipe_resource *lpr;
+
+   if (LP_PERF & PERF_NO_FAST_CLEAR)
+      return FALSE;
+
+   if (!llvmpipe_resource_is_texture(cbuf->texture))
+      return FALSE;
+
+   lpr = llvmpipe_resource_const(cbuf->texture);
+
+   return (lpr->cleared_tiles &&
+           cbuf->u.tex.level == 0 &&
+           cbuf->width == cbuf->texture->width0 &&
+           cbuf->height == cbuf->texture->height0 &&
+           setup->fb.width == cbuf->width &&
+           setup->fb.height == cbuf->height);
+}
+
+
 static boolean
 begin_binning( struct lp_setup_context *setup )
 {
@@ -258,8 +286,15 @@ begin_binning( struct lp_setup_context *setup )
          assert(PIPE_CLEAR_COLOR0 == 1 << 2);
          if (setup->clear.flags & (1 << (2 + cbuf))) {
             union lp_rast_cmd_arg clearrb_arg;
-            struct lp_rast_clear_rb *cc_scene =
-               (struct lp_rast_clear_rb *)
+            struct lp_rast_clear_rb *cc_scene;
+
+            if (lp_setup_can_fast_clear(setup, setup->fb.cbufs[cbuf])) {
+               scene->fast_clear_mask |= 1 << cbuf;
+               scene->fast_clear_color[cbuf] = setup->clear.color_val[cbuf];
+               continue;
+            }
+
+            cc_scene = (struct lp_rast_clear_rb *)
                   lp_scene_alloc(scene, sizeof(struct lp_rast_clear_rb));
 
             if (!cc_scene) {
@@ -1589,6 +1624,12 @@ lp_setup_destroy( struct lp_setup_context *setup )
 
    LP_DBG(DEBUG_SETUP, "number of scenes used: %d\n", setup->num_active_scenes);
    slab_destroy(&setup->scene_slab);
+
+   while (setup->free_blocks) {
+      struct data_block *block = setup->free_blocks;
+      setup->free_blocks = block->next;
+      FREE(block);
+   }
    lp_fence_reference(&setup->last_fence, NULL);
 
    FREE( setup );
@@ -1632,6 +1673,7 @@ lp_setup_create( struct pipe_context *pipe,
    slab_create(&setup->scene_slab,
                sizeof(struct lp_scene),
                INITIAL_SCENES);
+   setup->scene_max_size = LP_SCENE_MAX_SIZE;
    /* create just one scene for starting point */
    setup->scenes[0] = lp_scene_create( setup );
    if (!setup->scenes[0]) {
@@ -92,6 +92,22 @@ struct lp_setup_context
    unsigned scene_idx;
 
    struct slab_mempool scene_slab;
+
+   /** Data blocks of rasterized scenes, reused by the following ones */
+   struct data_block *free_blocks;
+   unsigned num_free_blocks;
+
+   /** Number of data blocks each of the last MAX_SCENES rasterized scenes
+    *  used, the largest of which caps num_free_blocks
+    */
+   unsigned scene_blocks[MAX_SCENES];
+   unsigned scene_blocks_idx;
+
+   /** Current clamp on scene data size, see LP_SCENE_MAX_SIZE, and the
+    *  number of consecutive scenes using less than a quarter of it
+    */
+   unsigned scene_max_size;
+   unsigned num_small_scenes;
    int num_active_scenes;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
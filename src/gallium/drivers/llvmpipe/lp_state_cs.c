@@ -909,6 +909,7 @@ llvmpipe_update_cs(struct llvmpipe_context *lp)
       dt = t1 - t0;
       LP_COUNT_ADD(llvm_compile_time, dt);
       LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+      lp_screen_count_compile(llvmpipe_screen(lp->pipe.screen), dt);
 
       /* Put the new variant into the list */
       if (variant) {
@@ -970,6 +971,7 @@ lp_csctx_set_sampler_views(struct lp_cs_context *csctx,
                last_level = view->u.tex.last_level;
                assert(first_level <= last_level);
                assert(last_level <= res->last_level);
+               llvmpipe_resource_resolve_fast_clear(lp_tex);
                jit_tex->base = lp_tex->tex_data;
             }
             else {
@@ -1167,6 +1169,7 @@ lp_csctx_set_cs_images(struct lp_cs_context *csctx,
       if (!lp_res->dt) {
          /* regular texture - csctx array of mipmap level offsets */
          if (llvmpipe_resource_is_texture(res)) {
+            llvmpipe_resource_resolve_fast_clear(lp_res);
             jit_image->base = lp_res->tex_data;
          } else
             jit_image->base = lp_res->data;
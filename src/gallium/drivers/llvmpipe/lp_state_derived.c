@@ -176,22 +176,21 @@ compute_vertex_info(struct llvmpipe_context *llvmpipe)
 static void
 check_linear_rasterizer( struct llvmpipe_context *lp )
 {
-   boolean bgr8;
+   boolean linear_cbuf;
    boolean permit_linear;
    boolean single_vp;
    boolean clipping_changed = FALSE;
 
-   bgr8 = (lp->framebuffer.nr_cbufs == 1 && lp->framebuffer.cbufs[0] &&
-           util_res_sample_count(lp->framebuffer.cbufs[0]->texture) == 1 &&
-           lp->framebuffer.cbufs[0]->texture->target == PIPE_TEXTURE_2D &&
-           (lp->framebuffer.cbufs[0]->format == PIPE_FORMAT_B8G8R8A8_UNORM ||
-            lp->framebuffer.cbufs[0]->format == PIPE_FORMAT_B8G8R8X8_UNORM));
+   linear_cbuf = (lp->framebuffer.nr_cbufs == 1 && lp->framebuffer.cbufs[0] &&
+                  util_res_sample_count(lp->framebuffer.cbufs[0]->texture) == 1 &&
+                  lp->framebuffer.cbufs[0]->texture->target == PIPE_TEXTURE_2D &&
+                  lp_linear_cbuf_format(lp->framebuffer.cbufs[0]->format));
 
    /* permit_linear means guardband, hence fake scissor, which we can only
     * handle if there's just one vp. */
    single_vp = lp->viewport_index_slot < 0;
    permit_linear = (!lp->framebuffer.zsbuf &&
-                    bgr8 &&
+                    linear_cbuf &&
                     single_vp);
 
    /* Tell draw that we're happy doing our own x/y clipping.
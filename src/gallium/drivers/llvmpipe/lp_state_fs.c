@@ -67,6 +67,7 @@
 #include "util/u_string.h"
 #include "util/u_dual_blend.h"
 #include "util/u_upload_mgr.h"
+#include "util/hash_table.h"
 #include "util/os_time.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
@@ -212,14 +213,15 @@ lp_mem_type_from_format_desc(const struct util_format_description *format_desc,
  * quad arguments with fs length 8.
  *
  * \param first_quad  which quad(s) of the quad group to test, in [0,3]
- * \param mask_input  bitwise mask for the whole 4x4 stamp
+ * \param mask_input  bitwise mask for the whole 4x4 stamp, 16 bits per
+ *                    sample, four samples per int64
  */
 static LLVMValueRef
 generate_quad_mask(struct gallivm_state *gallivm,
                    struct lp_type fs_type,
                    unsigned first_quad,
                    unsigned sample,
-                   LLVMValueRef mask_input) /* int64 */
+                   LLVMValueRef mask_input) /* int64 * */
 {
    LLVMBuilderRef builder = gallivm->builder;
    struct lp_type mask_type;
@@ -258,7 +260,9 @@ generate_quad_mask(struct gallivm_state *gallivm,
       shift = 0;
    }
 
-   mask_input = LLVMBuildLShr(builder, mask_input, lp_build_const_int64(gallivm, 16 * sample), "");
+   mask_input = lp_build_pointer_get(builder, mask_input,
+                                     lp_build_const_int32(gallivm, sample / 4));
+   mask_input = LLVMBuildLShr(builder, mask_input, lp_build_const_int64(gallivm, 16 * (sample % 4)), "");
    mask_input = LLVMBuildTrunc(builder, mask_input,
                                i32t, "");
    mask_input = LLVMBuildAnd(builder, mask_input, lp_build_const_int32(gallivm, 0xffff), "");
@@ -549,6 +553,7 @@ static void fs_fb_fetch(const struct lp_build_fs_iface *iface,
 static void
 generate_fs_loop(struct gallivm_state *gallivm,
                  struct lp_fragment_shader *shader,
+                 nir_shader *nir,
                  const struct lp_fragment_shader_variant_key *key,
                  LLVMBuilderRef builder,
                  struct lp_type type,
@@ -973,7 +978,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
       lp_build_tgsi_soa(gallivm, tokens, &params,
                         outputs);
    else
-      lp_build_nir_soa(gallivm, shader->base.ir.nir, &params,
+      lp_build_nir_soa(gallivm, nir, &params,
                        outputs);
 
    /* Alpha test */
@@ -2984,8 +2989,8 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
+                  nir_shader *nir,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -3088,7 +3093,7 @@ generate_fragment(struct llvmpipe_context *lp,
    arg_types[6] = LLVMPointerType(fs_elem_type, 0);    /* dady */
    arg_types[7] = LLVMPointerType(LLVMPointerType(int8_type, 0), 0);  /* color */
    arg_types[8] = LLVMPointerType(int8_type, 0);       /* depth */
-   arg_types[9] = LLVMInt64TypeInContext(gallivm->context);  /* mask_input */
+   arg_types[9] = LLVMPointerType(LLVMInt64TypeInContext(gallivm->context), 0);  /* mask_input */
    arg_types[10] = variant->jit_thread_data_ptr_type;  /* per thread data */
    arg_types[11] = LLVMPointerType(int32_type, 0);     /* stride */
    arg_types[12] = int32_type;                         /* depth_stride */
@@ -3194,13 +3199,15 @@ generate_fragment(struct llvmpipe_context *lp,
       LLVMValueRef glob_sample_pos = LLVMAddGlobal(gallivm->module, LLVMArrayType(flt_type, key->coverage_samples * 2), "");
       LLVMValueRef sample_pos_array;
 
-      if (key->multisample && key->coverage_samples == 4) {
-         LLVMValueRef sample_pos_arr[8];
-         for (unsigned i = 0; i < 4; i++) {
-            sample_pos_arr[i * 2] = LLVMConstReal(flt_type, lp_sample_pos_4x[i][0]);
-            sample_pos_arr[i * 2 + 1] = LLVMConstReal(flt_type, lp_sample_pos_4x[i][1]);
+      if (key->multisample && lp_sample_pos(key->coverage_samples)) {
+         const float (*sample_pos)[2] = lp_sample_pos(key->coverage_samples);
+         LLVMValueRef sample_pos_arr[LP_MAX_SAMPLES * 2];
+         for (unsigned i = 0; i < key->coverage_samples; i++) {
+            sample_pos_arr[i * 2] = LLVMConstReal(flt_type, sample_pos[i][0]);
+            sample_pos_arr[i * 2 + 1] = LLVMConstReal(flt_type, sample_pos[i][1]);
          }
-         sample_pos_array = LLVMConstArray(LLVMFloatTypeInContext(gallivm->context), sample_pos_arr, 8);
+         sample_pos_array = LLVMConstArray(LLVMFloatTypeInContext(gallivm->context), sample_pos_arr,
+                                           key->coverage_samples * 2);
       } else {
          LLVMValueRef sample_pos_arr[2];
          sample_pos_arr[0] = LLVMConstReal(flt_type, 0.5);
@@ -3235,7 +3242,7 @@ generate_fragment(struct llvmpipe_context *lp,
             LLVMValueRef smask_val = LLVMBuildLoad(builder, lp_jit_context_sample_mask(gallivm, context_ptr), "");
 
             /*
-             * For multisampling, extract the per-sample mask from the incoming 64-bit mask,
+             * For multisampling, extract the per-sample mask from the incoming mask words,
              * store to the per sample mask storage. Or all of them together to generate
              * the fragment shader mask. (sample shading TODO).
              * Take the incoming state coverage mask into account.
@@ -3273,7 +3280,7 @@ generate_fragment(struct llvmpipe_context *lp,
       }
 
       generate_fs_loop(gallivm,
-                       shader, key,
+                       shader, nir, key,
                        builder,
                        fs_type,
                        context_ptr,
@@ -3545,14 +3552,15 @@ lp_debug_fs_variant(struct lp_fragment_shader_variant *variant)
 
 static void
 lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
-                            unsigned char ir_sha1_cache_key[20])
+                       nir_shader *nir,
+                       unsigned char ir_sha1_cache_key[20])
 {
    struct blob blob = { 0 };
    unsigned ir_size;
    void *ir_binary;
 
    blob_init(&blob);
-   nir_serialize(&blob, variant->shader->base.ir.nir, true);
+   nir_serialize(&blob, nir, true);
    ir_binary = blob.data;
    ir_size = blob.size;
 
@@ -3568,13 +3576,20 @@ lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
+ *
+ * This doesn't touch any context state, so that it can also run on the
+ * screen's compile queue, with an LLVM context of its own.  The code is
+ * generated from \p nir rather than from the shader's own NIR, which the
+ * translation lowers in place, so that the queue can work on a copy.
  */
 static struct lp_fragment_shader_variant *
-generate_variant(struct llvmpipe_context *lp,
+generate_variant(struct llvmpipe_screen *screen,
+                 LLVMContextRef context,
                  struct lp_fragment_shader *shader,
-                 const struct lp_fragment_shader_variant_key *key)
+                 nir_shader *nir,
+                 const struct lp_fragment_shader_variant_key *key,
+                 unsigned variant_no)
 {
-   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc = NULL;
    boolean fullcolormask;
@@ -3590,29 +3605,32 @@ generate_variant(struct llvmpipe_context *lp,
 
    memset(variant, 0, sizeof(*variant));
    snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
-            shader->no, shader->variants_created);
+            shader->no, variant_no);
 
    pipe_reference_init(&variant->reference, 1);
-   lp_fs_reference(lp, &variant->shader, shader);
+   variant->shader = shader;
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
-   if (shader->base.ir.nir) {
-      lp_fs_get_ir_cache_key(variant, ir_sha1_cache_key);
+   if (nir) {
+      lp_fs_get_ir_cache_key(variant, nir, ir_sha1_cache_key);
 
       lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
       if (!cached.data_size)
          needs_caching = true;
    }
-   variant->gallivm = gallivm_create(module_name, lp->context, &cached);
+   variant->gallivm = gallivm_create(module_name, context, &cached);
    if (!variant->gallivm) {
       FREE(variant);
       return NULL;
    }
 
+   /* The caller holds a reference to the shader, so this never destroys it */
+   pipe_reference(NULL, &shader->reference);
+
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
-   variant->no = shader->variants_created++;
+   variant->no = variant_no;
 
 
 
@@ -3702,8 +3720,7 @@ generate_variant(struct llvmpipe_context *lp,
          !key->depth.enabled &&
          !shader->info.base.uses_kill &&
          !key->blend.logicop_enable &&
-         (key->cbuf_format[0] == PIPE_FORMAT_B8G8R8A8_UNORM ||
-          key->cbuf_format[0] == PIPE_FORMAT_B8G8R8X8_UNORM);
+         lp_linear_cbuf_format(key->cbuf_format[0]);
 
    memcpy(&variant->key, key, sizeof *key);
 
@@ -3716,12 +3733,12 @@ generate_variant(struct llvmpipe_context *lp,
    lp_jit_init_types(variant);
 
    if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+      generate_fragment(shader, nir, variant, RAST_EDGE_TEST);
 
    if (variant->jit_function[RAST_WHOLE] == NULL) {
       if (variant->opaque) {
          /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
+         generate_fragment(shader, nir, variant, RAST_WHOLE);
       }
    }
 
@@ -3734,7 +3751,8 @@ generate_variant(struct llvmpipe_context *lp,
        */
       if (fullcolormask &&
           !key->alpha.enabled &&
-          !key->blend.alpha_to_coverage) {
+          !key->blend.alpha_to_coverage &&
+          key->cbuf_format[0] != PIPE_FORMAT_B5G6R5_UNORM) {
          llvmpipe_fs_variant_linear_fastpath(variant);
       }
 
@@ -3745,7 +3763,7 @@ generate_variant(struct llvmpipe_context *lp,
          if (shader->kind == LP_FS_KIND_BLIT_RGBA ||
              shader->kind == LP_FS_KIND_BLIT_RGB1 ||
              shader->kind == LP_FS_KIND_LLVM_LINEAR) {
-            llvmpipe_fs_variant_linear_llvm(lp, shader, variant);
+            llvmpipe_fs_variant_linear_llvm(shader, nir, variant);
          }
       }
    } else {
@@ -3800,6 +3818,201 @@ generate_variant(struct llvmpipe_context *lp,
 }
 
 
+static void
+init_variant_key_resources(struct lp_fragment_shader *shader,
+                           struct lp_fragment_shader_variant_key *key);
+
+static bool
+lp_fs_variant_key_equal(const void *a, const void *b);
+
+
+/**
+ * A variant compiled on the screen's compile queue, so that shaders
+ * created ahead of their first draw (e.g. at load time) don't stall that
+ * draw on LLVM.  The key is a guess made from the shader alone, as the
+ * context state may not be bound yet, or owned by another thread.
+ */
+struct lp_fs_precompile_job {
+   struct llvmpipe_screen *screen;
+   struct lp_fragment_shader *shader;
+   nir_shader *nir;
+   struct lp_fragment_shader_variant *variant;
+   unsigned variant_no;
+   int64_t compile_time;
+   char key[LP_FS_MAX_VARIANT_KEY_SIZE];
+};
+
+
+/**
+ * Guess the shader's first variant key: a single BGRA8 color buffer
+ * without blending, no depth/stencil, no multisampling and default
+ * sampler state.
+ */
+static void
+make_precompile_key(struct lp_fragment_shader *shader, char *store)
+{
+   struct lp_fragment_shader_variant_key *key =
+      (struct lp_fragment_shader_variant_key *)store;
+
+   memset(key, 0, sizeof(*key));
+
+   key->coverage_samples = 1;
+   key->min_samples = 1;
+   key->nr_cbufs = 1;
+   key->cbuf_format[0] = PIPE_FORMAT_B8G8R8A8_UNORM;
+   key->cbuf_nr_samples[0] = 1;
+   key->blend.independent_blend_enable = 1;
+   key->blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+   init_variant_key_resources(shader, key);
+}
+
+
+static void
+lp_fs_precompile_execute(void *data, void *gdata, int thread_index)
+{
+   struct lp_fs_precompile_job *job = data;
+   LLVMContextRef context = LLVMContextCreate();
+   int64_t t0;
+
+   if (!context)
+      return;
+
+   t0 = os_time_get();
+   job->variant = generate_variant(job->screen, context, job->shader, job->nir,
+                                   (const struct lp_fragment_shader_variant_key *)job->key,
+                                   job->variant_no);
+   job->compile_time = os_time_get() - t0;
+
+   if (job->variant)
+      job->variant->context = context;
+   else
+      LLVMContextDispose(context);
+}
+
+
+static void
+lp_fs_precompile_free(struct lp_fs_precompile_job *job)
+{
+   if (job->nir)
+      ralloc_free(job->nir);
+   FREE(job);
+}
+
+
+static void
+lp_fs_precompile(struct llvmpipe_context *lp,
+                 struct lp_fragment_shader *shader)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fs_precompile_job *job;
+
+   if (!util_queue_is_initialized(&screen->compile_queue))
+      return;
+
+   job = CALLOC_STRUCT(lp_fs_precompile_job);
+   if (!job)
+      return;
+
+   /* The queue works on a copy of the NIR, which the translation lowers
+    * in place, so that draws needing another variant can compile theirs
+    * meanwhile.
+    */
+   if (shader->base.ir.nir) {
+      job->nir = nir_shader_clone(NULL, shader->base.ir.nir);
+      if (!job->nir) {
+         FREE(job);
+         return;
+      }
+   }
+
+   job->screen = screen;
+   job->shader = shader;
+   job->variant_no = shader->variants_created++;
+   make_precompile_key(shader, job->key);
+
+   LP_COUNT(nr_fs_precompiles);
+   shader->precompile = job;
+   util_queue_add_job(&screen->compile_queue, job, &shader->precompile_fence,
+                      lp_fs_precompile_execute, NULL, 0);
+}
+
+
+/**
+ * Pick up the shader's background compile, if any.  Its variant is only
+ * moved into the shader's and the context's variant caches when it is
+ * for \p key, so that wrong guesses never count against the cache limits,
+ * and it is only waited for in that case.  With a NULL key, the job is
+ * waited for and its variant dropped.  Returns whether a variant was added.
+ */
+static bool
+lp_fs_finish_precompile(struct llvmpipe_context *lp,
+                        struct lp_fragment_shader *shader,
+                        const struct lp_fragment_shader_variant_key *key)
+{
+   struct lp_fs_precompile_job *job = shader->precompile;
+   struct lp_fragment_shader_variant *variant;
+   bool match;
+
+   if (!job)
+      return false;
+
+   match = key && lp_fs_variant_key_equal(job->key, key);
+   if (key && !match &&
+       !util_queue_fence_is_signalled(&shader->precompile_fence))
+      return false;
+
+   util_queue_fence_wait(&shader->precompile_fence);
+   shader->precompile = NULL;
+
+   variant = job->variant;
+   LP_COUNT_ADD(llvm_compile_time, job->compile_time);
+   if (variant)
+      lp_screen_count_compile(job->screen, job->compile_time);
+   lp_fs_precompile_free(job);
+
+   if (!variant)
+      return false;
+
+   if (!match) {
+      LP_COUNT(nr_fs_precompile_misses);
+      lp_fs_variant_reference(lp, &variant, NULL);
+      return false;
+   }
+
+   list_add(&variant->list_item_local.list, &shader->variants.list);
+   _mesa_hash_table_insert(shader->variant_ht, &variant->key, variant);
+   list_add(&variant->list_item_global.list, &lp->fs_variants_list.list);
+   lp->nr_fs_variants++;
+   lp->nr_fs_instrs += variant->nr_instrs;
+   shader->variants_cached++;
+   return true;
+}
+
+
+static uint32_t
+lp_fs_variant_key_hash(const void *key)
+{
+   const struct lp_fragment_shader_variant_key *k = key;
+
+   return _mesa_hash_data(k, lp_fs_variant_key_size(MAX2(k->nr_samplers, k->nr_sampler_views),
+                                                    k->nr_images));
+}
+
+
+static bool
+lp_fs_variant_key_equal(const void *a, const void *b)
+{
+   const struct lp_fragment_shader_variant_key *ka = a, *kb = b;
+   size_t size = lp_fs_variant_key_size(MAX2(ka->nr_samplers, ka->nr_sampler_views),
+                                        ka->nr_images);
+
+   return size == lp_fs_variant_key_size(MAX2(kb->nr_samplers, kb->nr_sampler_views),
+                                         kb->nr_images) &&
+          memcmp(ka, kb, size) == 0;
+}
+
+
 static void *
 llvmpipe_create_fs_state(struct pipe_context *pipe,
                          const struct pipe_shader_state *templ)
@@ -3818,6 +4031,13 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
    pipe_reference_init(&shader->reference, 1);
    shader->no = fs_no++;
    list_inithead(&shader->variants.list);
+   shader->variant_ht = _mesa_hash_table_create(NULL, lp_fs_variant_key_hash,
+                                                lp_fs_variant_key_equal);
+   if (!shader->variant_ht) {
+      FREE(shader);
+      return NULL;
+   }
+   util_queue_fence_init(&shader->precompile_fence);
 
    shader->base.type = templ->type;
    if (templ->type == PIPE_SHADER_IR_TGSI) {
@@ -3833,6 +4053,7 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
 
    shader->draw_data = draw_create_fragment_shader(llvmpipe->draw, templ);
    if (shader->draw_data == NULL) {
+      _mesa_hash_table_destroy(shader->variant_ht, NULL);
       FREE((void *) shader->base.tokens);
       FREE(shader);
       return NULL;
@@ -3905,6 +4126,8 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
    else
      llvmpipe_fs_analyse_nir(shader);
 
+   lp_fs_precompile(llvmpipe, shader);
+
    return shader;
 }
 
@@ -3946,8 +4169,9 @@ void llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants, variant->nr_instrs, lp->nr_fs_instrs);
    }
 
-   /* remove from shader's list */
+   /* remove from shader's list and key index */
    list_del(&variant->list_item_local.list);
+   _mesa_hash_table_remove_key(variant->shader->variant_ht, &variant->key);
    variant->shader->variants_cached--;
 
    /* remove from context's list */
@@ -3961,6 +4185,8 @@ llvmpipe_destroy_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant)
 {
    gallivm_destroy(variant->gallivm);
+   if (variant->context)
+      LLVMContextDispose(variant->context);
 
    lp_fs_reference(lp, &variant->shader, NULL);
 
@@ -3977,6 +4203,8 @@ llvmpipe_destroy_fs(struct llvmpipe_context *llvmpipe,
    if (shader->base.ir.nir)
       ralloc_free(shader->base.ir.nir);
    assert(shader->variants_cached == 0);
+   _mesa_hash_table_destroy(shader->variant_ht, NULL);
+   util_queue_fence_destroy(&shader->precompile_fence);
    FREE((void *) shader->base.tokens);
    FREE(shader);
 }
@@ -3988,6 +4216,12 @@ llvmpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
    struct lp_fragment_shader *shader = fs;
    struct lp_fs_variant_list_item *li, *next;
 
+   if (shader->precompile) {
+      util_queue_drop_job(&llvmpipe_screen(pipe->screen)->compile_queue,
+                          &shader->precompile_fence);
+      lp_fs_finish_precompile(llvmpipe, shader, NULL);
+   }
+
    /* Delete all the variants */
    LIST_FOR_EACH_ENTRY_SAFE(li, next, &shader->variants.list, list) {
       struct lp_fragment_shader_variant *variant;
@@ -4156,6 +4390,32 @@ force_dst_alpha_one(unsigned factor, boolean clamped_zero)
 }
 
 
+/**
+ * Set the shader's sampler, sampler view and image counts in the key, and
+ * clear their static state.  These counts are the same for all the
+ * variants of a given shader.
+ */
+static void
+init_variant_key_resources(struct lp_fragment_shader *shader,
+                           struct lp_fragment_shader_variant_key *key)
+{
+   key->nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
+
+   if (shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] != -1)
+      key->nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+   else
+      key->nr_sampler_views = key->nr_samplers;
+
+   key->nr_images = shader->info.base.file_max[TGSI_FILE_IMAGE] + 1;
+
+   memset(lp_fs_variant_key_samplers(key), 0,
+          MAX2(key->nr_samplers, key->nr_sampler_views) *
+          sizeof(struct lp_sampler_static_state));
+   memset(lp_fs_variant_key_images(key), 0,
+          key->nr_images * sizeof(struct lp_image_static_state));
+}
+
+
 /**
  * We need to generate several variants of the fragment pipeline to match
  * all the combinations of the contributing state atoms.
@@ -4312,19 +4572,12 @@ make_variant_key(struct llvmpipe_context *lp,
       }
    }
 
-   /* This value will be the same for all the variants of a given shader:
-    */
-   key->nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
-
-   if (shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] != -1)
-      key->nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+   init_variant_key_resources(shader, key);
 
    struct lp_sampler_static_state *fs_sampler;
 
    fs_sampler = lp_fs_variant_key_samplers(key);
 
-   memset(fs_sampler, 0, MAX2(key->nr_samplers, key->nr_sampler_views) * sizeof *fs_sampler);
-
    for(i = 0; i < key->nr_samplers; ++i) {
       if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
          lp_sampler_static_sampler_state(&fs_sampler[i].sampler_state,
@@ -4351,7 +4604,6 @@ make_variant_key(struct llvmpipe_context *lp,
       }
    }
    else {
-      key->nr_sampler_views = key->nr_samplers;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
             lp_sampler_static_texture_state(&fs_sampler[i].texture_state,
@@ -4362,7 +4614,6 @@ make_variant_key(struct llvmpipe_context *lp,
 
    struct lp_image_static_state *lp_image;
    lp_image = lp_fs_variant_key_images(key);
-   key->nr_images = shader->info.base.file_max[TGSI_FILE_IMAGE] + 1;
    for (i = 0; i < key->nr_images; ++i) {
       if (shader->info.base.file_mask[TGSI_FILE_IMAGE] & (1 << i)) {
          lp_sampler_static_texture_state_image(&lp_image[i].image_state,
@@ -4391,19 +4642,26 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    struct lp_fragment_shader *shader = lp->fs;
    struct lp_fragment_shader_variant_key *key;
    struct lp_fragment_shader_variant *variant = NULL;
-   struct lp_fs_variant_list_item *li;
+   struct hash_entry *entry;
    char store[LP_FS_MAX_VARIANT_KEY_SIZE];
 
    key = make_variant_key(lp, shader, store);
 
-   /* Search the variants for one which matches the key */
-   LIST_FOR_EACH_ENTRY(li, &shader->variants.list, list) {
-      if(memcmp(&li->base->key, key, shader->variant_key_size) == 0) {
-         variant = li->base;
-         break;
-      }
+   /* Look up the variant which matches the key */
+   entry = _mesa_hash_table_search(shader->variant_ht, key);
+
+   /* On a miss, pick up the background compile of this shader if it is
+    * for this very key, rather than compiling it a second time.
+    */
+   if (!entry && lp_fs_finish_precompile(lp, shader, key)) {
+      entry = _mesa_hash_table_search(shader->variant_ht, key);
+      if (entry)
+         LP_COUNT(nr_fs_precompile_hits);
    }
 
+   if (entry)
+      variant = entry->data;
+
    if (variant) {
       /* Move this variant to the head of the list to implement LRU
        * deletion of shader's when we have too many.
@@ -4463,15 +4721,19 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
        * Generate the new variant.
        */
       t0 = os_time_get();
-      variant = generate_variant(lp, shader, key);
+      variant = generate_variant(llvmpipe_screen(lp->pipe.screen), lp->context,
+                                 shader, shader->base.ir.nir, key,
+                                 shader->variants_created++);
       t1 = os_time_get();
       dt = t1 - t0;
       LP_COUNT_ADD(llvm_compile_time, dt);
       LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+      lp_screen_count_compile(llvmpipe_screen(lp->pipe.screen), dt);
 
       /* Put the new variant into the list */
       if (variant) {
          list_add(&variant->list_item_local.list, &shader->variants.list);
+         _mesa_hash_table_insert(shader->variant_ht, &variant->key, variant);
          list_add(&variant->list_item_global.list, &lp->fs_variants_list.list);
          lp->nr_fs_variants++;
          lp->nr_fs_instrs += variant->nr_instrs;
@@ -4480,6 +4742,8 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    }
 
    /* Bind this variant */
+   lp->fs_linear = variant && (variant->jit_linear ||
+                               variant->jit_linear_blit);
    lp_setup_set_fs_variant(lp->setup, variant);
 }
 
@@ -38,10 +38,13 @@
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
 #include "lp_bld_interp.h" /* for struct lp_shader_input */
 #include "util/u_inlines.h"
+#include "util/u_queue.h"
 #include "lp_jit.h"
 
 struct tgsi_token;
 struct lp_fragment_shader;
+struct nir_shader;
+struct lp_fs_precompile_job;
 
 
 /** Indexes into jit_function[] array */
@@ -171,6 +174,11 @@ struct lp_fragment_shader_variant
 
    struct gallivm_state *gallivm;
 
+   /* LLVM context owned by this variant when it was compiled on the
+    * screen's compile queue, NULL when it uses the llvmpipe context's.
+    */
+   LLVMContextRef context;
+
    LLVMTypeRef jit_context_ptr_type;
    LLVMTypeRef jit_thread_data_ptr_type;
    LLVMTypeRef jit_linear_context_ptr_type;
@@ -221,6 +229,13 @@ struct lp_fragment_shader
 
    struct lp_fs_variant_list_item variants;
 
+   /* Variants indexed by their key, for O(1) lookup on state changes */
+   struct hash_table *variant_ht;
+
+   /* Variant speculatively compiled in the background at creation time */
+   struct lp_fs_precompile_job *precompile;
+   struct util_queue_fence precompile_fence;
+
    struct draw_fragment_shader *draw_data;
 
    /* For debugging/profiling purposes */
@@ -247,8 +262,8 @@ void
 llvmpipe_fs_variant_linear_fastpath(struct lp_fragment_shader_variant *variant);
 
 void
-llvmpipe_fs_variant_linear_llvm(struct llvmpipe_context *lp,
-                                struct lp_fragment_shader *shader,
+llvmpipe_fs_variant_linear_llvm(struct lp_fragment_shader *shader,
+                                struct nir_shader *nir,
                                 struct lp_fragment_shader_variant *variant);
 
 void
@@ -261,6 +276,64 @@ lp_debug_fs_kind(enum lp_fs_kind kind);
 void
 lp_linear_check_variant(struct lp_fragment_shader_variant *variant);
 
+
+/**
+ * Color buffer formats the linear rasterizer can write.  Only the 32bpp
+ * ones are written directly, rgb565 rows are expanded to BGRX and packed
+ * back around the linear shader.
+ */
+static inline boolean
+lp_linear_cbuf_format(enum pipe_format format)
+{
+   return (format == PIPE_FORMAT_B8G8R8A8_UNORM ||
+           format == PIPE_FORMAT_B8G8R8X8_UNORM ||
+           format == PIPE_FORMAT_B5G6R5_UNORM);
+}
+
+
+/**
+ * Expand a row of rgb565 pixels to the BGRA the linear shaders work on.
+ */
+static inline void
+lp_linear_unpack_row_565(uint32_t *dst, const uint16_t *src, unsigned width)
+{
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      uint32_t pixel = src[i];
+      uint32_t r = (pixel >> 11) & 0x1f;
+      uint32_t g = (pixel >> 5) & 0x3f;
+      uint32_t b = pixel & 0x1f;
+
+      r = (r << 3) | (r >> 2);
+      g = (g << 2) | (g >> 4);
+      b = (b << 3) | (b >> 2);
+
+      dst[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+   }
+}
+
+
+/**
+ * Pack a row of BGRA pixels back to rgb565, rounding each channel to the
+ * nearest representable value.  Packing an unpacked row gives back the
+ * original pixels.
+ */
+static inline void
+lp_linear_pack_row_565(uint16_t *dst, const uint32_t *src, unsigned width)
+{
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      uint32_t pixel = src[i];
+      uint32_t r = (((pixel >> 16) & 0xff) * 31 + 127) / 255;
+      uint32_t g = (((pixel >> 8) & 0xff) * 63 + 127) / 255;
+      uint32_t b = ((pixel & 0xff) * 31 + 127) / 255;
+
+      dst[i] = (uint16_t)((r << 11) | (g << 5) | b);
+   }
+}
+
 void
 llvmpipe_destroy_fs(struct llvmpipe_context *llvmpipe,
                     struct lp_fragment_shader *shader);
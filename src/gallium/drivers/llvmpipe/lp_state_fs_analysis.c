@@ -257,24 +257,28 @@ llvmpipe_nir_fn_is_linear_compat(struct nir_shader *shader,
             nir_alu_instr *alu = nir_instr_as_alu(instr);
             if (alu->op != nir_op_mov &&
                 alu->op != nir_op_vec2 &&
+                alu->op != nir_op_vec3 &&
                 alu->op != nir_op_vec4 &&
-                alu->op != nir_op_fmul)
+                alu->op != nir_op_fmul &&
+                alu->op != nir_op_fmin &&
+                alu->op != nir_op_fmax)
                return false;
 
-            if (alu->op == nir_op_fmul) {
-               unsigned num_src = nir_op_infos[alu->op].num_inputs;;
-               for (unsigned s = 0; s < num_src; s++) {
-                  if (nir_src_is_const(alu->src[s].src)) {
-                     nir_load_const_instr *load =
-                        nir_instr_as_load_const(alu->src[s].src.ssa->parent_instr);
+            /* The linear path computes in 8bit unorm, so any immediate
+             * must be representable there.
+             */
+            unsigned num_src = nir_op_infos[alu->op].num_inputs;
+            for (unsigned s = 0; s < num_src; s++) {
+               if (nir_src_is_const(alu->src[s].src)) {
+                  nir_load_const_instr *load =
+                     nir_instr_as_load_const(alu->src[s].src.ssa->parent_instr);
 
-                     if (load->def.bit_size != 32)
+                  if (load->def.bit_size != 32)
+                     return false;
+                  for (unsigned c = 0; c < load->def.num_components; c++) {
+                     if (load->value[c].f32 < 0.0 || load->value[c].f32 > 1.0) {
+                        info->unclamped_immediates = true;
                         return false;
-                     for (unsigned c = 0; c < load->def.num_components; c++) {
-                        if (load->value[c].f32 < 0.0 || load->value[c].f32 > 1.0) {
-                           info->unclamped_immediates = true;
-                           return false;
-                        }
                      }
                   }
                }
@@ -335,6 +339,8 @@ llvmpipe_fs_analyse(struct lp_fragment_shader *shader,
         shader->info.base.opcode_count[TGSI_OPCODE_SAMPLE] +
         shader->info.base.opcode_count[TGSI_OPCODE_MOV] +
         shader->info.base.opcode_count[TGSI_OPCODE_MUL] +
+        shader->info.base.opcode_count[TGSI_OPCODE_MIN] +
+        shader->info.base.opcode_count[TGSI_OPCODE_MAX] +
         shader->info.base.opcode_count[TGSI_OPCODE_RET] +
         shader->info.base.opcode_count[TGSI_OPCODE_END] ==
         shader->info.base.num_instructions)) {
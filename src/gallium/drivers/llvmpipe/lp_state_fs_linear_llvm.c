@@ -132,6 +132,7 @@ emit_fetch_texel_linear(const struct lp_build_sampler_aos *base,
 static LLVMValueRef
 llvm_fragment_body(struct lp_build_context *bld,
                    struct lp_fragment_shader *shader,
+                   nir_shader *nir,
                    struct lp_fragment_shader_variant *variant,
                    struct linear_sampler* sampler,
                    LLVMValueRef *inputs_ptrs,
@@ -193,7 +194,7 @@ llvm_fragment_body(struct lp_build_context *bld,
                         &sampler->base,
                         &shader->info.base);
    else {
-      nir_shader *clone = nir_shader_clone(NULL, shader->base.ir.nir);
+      nir_shader *clone = nir_shader_clone(NULL, nir);
       lp_build_nir_aos(gallivm, clone, fs_type,
                        bgra_swizzles,
                        consts_ptr, inputs, outputs,
@@ -260,8 +261,8 @@ llvm_fragment_body(struct lp_build_context *bld,
  * Generate a function that executes the fragment shader in a linear fashion.
  */
 void
-llvmpipe_fs_variant_linear_llvm(struct llvmpipe_context *lp,
-                                struct lp_fragment_shader *shader,
+llvmpipe_fs_variant_linear_llvm(struct lp_fragment_shader *shader,
+                                nir_shader *nir,
                                 struct lp_fragment_shader_variant *variant)
 {
    struct gallivm_state *gallivm = variant->gallivm;
@@ -475,7 +476,7 @@ llvmpipe_fs_variant_linear_llvm(struct llvmpipe_context *lp,
       value = lp_build_pointer_get_unaligned(builder, color0_ptr, loop.counter, 4);
 
       /* Perform fragment shader body */
-      value = llvm_fragment_body(&bld, shader, variant, &sampler, inputs_ptrs, consts_ptr, blend_color, alpha_ref, fs_type, value);
+      value = llvm_fragment_body(&bld, shader, nir, variant, &sampler, inputs_ptrs, consts_ptr, blend_color, alpha_ref, fs_type, value);
 
       /* Write 4 pixels */
       lp_build_pointer_set_unaligned(builder, color0_ptr, loop.counter, value, 4);
@@ -510,7 +511,7 @@ llvmpipe_fs_variant_linear_llvm(struct llvmpipe_context *lp,
       buf = LLVMBuildLoad(gallivm->builder, buf_ptr, "");
       buf = LLVMBuildBitCast(builder, buf, bld.vec_type, "");
 
-      result = llvm_fragment_body(&bld, shader, variant, &sampler, inputs_ptrs, consts_ptr, blend_color, alpha_ref, fs_type, buf);
+      result = llvm_fragment_body(&bld, shader, nir, variant, &sampler, inputs_ptrs, consts_ptr, blend_color, alpha_ref, fs_type, buf);
       result = LLVMBuildBitCast(builder, result, pixelt, "");
 
       /* Write individual pixels from local buffer to the memory */
@@ -312,6 +312,7 @@ prepare_shader_sampling(
                last_level = view->u.tex.last_level;
                assert(first_level <= last_level);
                assert(last_level <= res->last_level);
+               llvmpipe_resource_resolve_fast_clear(lp_tex);
                addr = lp_tex->tex_data;
 
                sample_stride = lp_tex->sample_stride;
@@ -489,6 +490,7 @@ prepare_shader_images(
 
             if (llvmpipe_resource_is_texture(res)) {
                uint32_t mip_offset = lp_img->mip_offsets[view->u.tex.level];
+               llvmpipe_resource_resolve_fast_clear(lp_img);
                addr = lp_img->tex_data;
 
                if (img->target == PIPE_TEXTURE_1D_ARRAY ||
@@ -246,13 +246,11 @@ llvmpipe_get_sample_position(struct pipe_context *pipe,
                              unsigned sample_index,
                              float *out_value)
 {
-   switch (sample_count) {
-   case 4:
-      out_value[0] = lp_sample_pos_4x[sample_index][0];
-      out_value[1] = lp_sample_pos_4x[sample_index][1];
-      break;
-   default:
-      break;
+   const float (*sample_pos)[2] = lp_sample_pos(sample_count);
+
+   if (sample_pos) {
+      out_value[0] = sample_pos[sample_index][0];
+      out_value[1] = sample_pos[sample_index][1];
    }
 }
 
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: MIT */
+
+/**
+ * @file
+ * Unit tests for the rgb565 row conversions of the linear rasterizer.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "lp_state_fs.h"
+#include "lp_test.h"
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "test\n");
+
+   fflush(fp);
+}
+
+
+static void
+write_tsv_row(FILE *fp, const char *test, boolean success)
+{
+   if (!fp)
+      return;
+
+   fprintf(fp, "%s\t%s\n", success ? "pass" : "fail", test);
+
+   fflush(fp);
+}
+
+
+/**
+ * Unpacking and packing back every rgb565 value must be lossless.
+ */
+static boolean
+test_565_round_trip(unsigned verbose, FILE *fp)
+{
+   uint16_t src[64], dst[64];
+   uint32_t row[64];
+   boolean success = TRUE;
+   unsigned pixel, i;
+
+   for (pixel = 0; pixel < 0x10000; pixel += 64) {
+      for (i = 0; i < 64; i++)
+         src[i] = pixel + i;
+
+      lp_linear_unpack_row_565(row, src, 64);
+      lp_linear_pack_row_565(dst, row, 64);
+
+      for (i = 0; i < 64; i++) {
+         if ((row[i] >> 24) != 0xff || dst[i] != src[i]) {
+            if (verbose || success)
+               printf("565 round trip of 0x%04x: 0x%08x -> 0x%04x\n",
+                      src[i], row[i], dst[i]);
+            success = FALSE;
+         }
+      }
+   }
+
+   write_tsv_row(fp, "565_round_trip", success);
+
+   return success;
+}
+
+
+/**
+ * Packing must round each 8 bit channel to the nearest 5 or 6 bit value,
+ * not truncate it.
+ */
+static boolean
+test_565_pack_rounding(unsigned verbose, FILE *fp)
+{
+   uint32_t src[256];
+   uint16_t dst[256];
+   boolean success = TRUE;
+   unsigned v;
+
+   for (v = 0; v < 256; v++)
+      src[v] = 0xff000000 | (v << 16) | (v << 8) | v;
+
+   lp_linear_pack_row_565(dst, src, 256);
+
+   for (v = 0; v < 256; v++) {
+      unsigned r = (v * 31 + 127) / 255;
+      unsigned g = (v * 63 + 127) / 255;
+      unsigned b = (v * 31 + 127) / 255;
+      uint16_t expected = (r << 11) | (g << 5) | b;
+
+      if (dst[v] != expected) {
+         if (verbose || success)
+            printf("565 pack of %u: expected 0x%04x, got 0x%04x\n",
+                   v, expected, dst[v]);
+         success = FALSE;
+      }
+   }
+
+   write_tsv_row(fp, "565_pack_rounding", success);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   boolean success = TRUE;
+
+   if (!test_565_round_trip(verbose, fp))
+      success = FALSE;
+
+   if (!test_565_pack_rounding(verbose, fp))
+      success = FALSE;
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   printf("no test_single()");
+   return TRUE;
+}
@@ -35,11 +35,13 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_cpu_detect.h"
 #include "util/format/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_surface.h"
 #include "util/u_transfer.h"
 
 #include "lp_context.h"
@@ -65,6 +67,23 @@ static mtx_t resource_list_mutex = _MTX_INITIALIZER_NP;
 static unsigned id_counter = 0;
 
 
+/**
+ * Can tile clears of the resource be deferred?  Only single level 0,
+ * single layer, single sample color render targets are tracked.
+ */
+static boolean
+llvmpipe_can_fast_clear(const struct pipe_resource *pt)
+{
+   return ((pt->bind & PIPE_BIND_RENDER_TARGET) &&
+           (pt->target == PIPE_TEXTURE_2D ||
+            pt->target == PIPE_TEXTURE_RECT) &&
+           pt->nr_samples <= 1 &&
+           pt->depth0 == 1 &&
+           pt->array_size == 1 &&
+           !util_format_is_depth_or_stencil(pt->format));
+}
+
+
 /**
  * Conventional allocation path for non-display textures:
  * Compute strides and allocate data (unless asked not to).
@@ -254,6 +273,15 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
          /* texture map */
          if (!llvmpipe_texture_layout(screen, lpr, alloc_backing))
             goto fail;
+
+         if (alloc_backing && llvmpipe_can_fast_clear(&lpr->base)) {
+            unsigned tiles_y = DIV_ROUND_UP(lpr->base.height0, TILE_SIZE);
+            /* not fatal, clears are simply never deferred */
+            lpr->cleared_tiles =
+               CALLOC(llvmpipe_resource_tiles_x(lpr) * tiles_y, 1);
+            if (lpr->cleared_tiles)
+               (void) mtx_init(&lpr->fast_clear_mutex, mtx_plain);
+         }
       }
    }
    else {
@@ -452,6 +480,10 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
                align_free(lpr->tex_data);
             lpr->tex_data = NULL;
          }
+         if (lpr->cleared_tiles) {
+            mtx_destroy(&lpr->fast_clear_mutex);
+            FREE(lpr->cleared_tiles);
+         }
       }
       else if (lpr->data) {
             if (!lpr->imported_memory)
@@ -709,6 +741,16 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
          return NULL;
       }
    }
+   else if ((usage & PIPE_MAP_WRITE) && lpr->cleared_tiles &&
+            p_atomic_read(&lpr->fast_cleared)) {
+      /* Writes to tiles whose clear is still deferred would later be
+       * overwritten by it, so resolve it even for unsynchronized maps,
+       * waiting for scenes still rendering to the resource if needed.
+       */
+      if (p_atomic_read(&lpr->rendering_scenes))
+         llvmpipe_finish(pipe, __FUNCTION__);
+      llvmpipe_resource_resolve_fast_clear(lpr);
+   }
 
    /* Check if we're mapping a current constant buffer */
    if ((usage & PIPE_MAP_WRITE) &&
@@ -925,6 +967,118 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
 }
 
 
+/**
+ * Record that the whole of level 0 was cleared to the given value, which
+ * is packed in the format of the surface it was cleared through.  Memory
+ * is not touched until a tile is rendered to or the resource is resolved.
+ * Called by the rasterizer when it begins a scene.
+ */
+void
+llvmpipe_resource_fast_clear(struct llvmpipe_resource *lpr,
+                             enum pipe_format format,
+                             const union util_color *uc)
+{
+   unsigned tiles_y = DIV_ROUND_UP(lpr->base.height0, TILE_SIZE);
+
+   assert(lpr->cleared_tiles);
+
+   mtx_lock(&lpr->fast_clear_mutex);
+   memset(lpr->cleared_tiles, 1, llvmpipe_resource_tiles_x(lpr) * tiles_y);
+   lpr->clear_format = format;
+   lpr->clear_value = *uc;
+   lpr->fast_cleared = true;
+   mtx_unlock(&lpr->fast_clear_mutex);
+}
+
+
+/**
+ * Write the clear value to the tile at (tx, ty) of a fast cleared resource,
+ * unless it was already resolved.  The tile is claimed atomically, so only
+ * one caller ever fills it.
+ * \return TRUE if the tile was filled by this call.
+ */
+boolean
+llvmpipe_resource_resolve_tile(struct llvmpipe_resource *lpr,
+                               unsigned tx, unsigned ty)
+{
+   uint8_t *tile = &lpr->cleared_tiles[ty * llvmpipe_resource_tiles_x(lpr) + tx];
+   unsigned x = tx * TILE_SIZE;
+   unsigned y = ty * TILE_SIZE;
+
+   if (!p_atomic_read(tile) || p_atomic_cmpxchg(tile, 1, 0) != 1)
+      return FALSE;
+
+   util_fill_rect((ubyte *) lpr->tex_data + lpr->mip_offsets[0],
+                  lpr->clear_format,
+                  lpr->row_stride[0],
+                  x, y,
+                  MIN2(TILE_SIZE, lpr->base.width0 - x),
+                  MIN2(TILE_SIZE, lpr->base.height0 - y),
+                  &lpr->clear_value);
+
+   return TRUE;
+}
+
+
+/**
+ * Called by the rasterizer before a scene renders to the resource.
+ * \return TRUE if the scene must resolve the tiles it renders to, in which
+ * case llvmpipe_resource_end_render() must be called once it's done.
+ */
+boolean
+llvmpipe_resource_begin_render(struct llvmpipe_resource *lpr)
+{
+   boolean fast_cleared;
+
+   if (!lpr->cleared_tiles)
+      return FALSE;
+
+   mtx_lock(&lpr->fast_clear_mutex);
+   fast_cleared = lpr->fast_cleared;
+   if (fast_cleared)
+      lpr->rendering_scenes++;
+   mtx_unlock(&lpr->fast_clear_mutex);
+
+   return fast_cleared;
+}
+
+
+void
+llvmpipe_resource_end_render(struct llvmpipe_resource *lpr)
+{
+   p_atomic_dec(&lpr->rendering_scenes);
+}
+
+
+/**
+ * Write the clear value to all tiles not rendered to since the last
+ * fast clear, so that the memory can be accessed directly.
+ *
+ * Nothing is done while a scene still renders to the resource: its
+ * rasterizer threads resolve tiles as they draw them, and whoever needs the
+ * whole resource (e.g. llvmpipe_flush_resource) waits for the scene first.
+ */
+void
+llvmpipe_resource_resolve_fast_clear(struct llvmpipe_resource *lpr)
+{
+   if (!lpr->cleared_tiles || !p_atomic_read(&lpr->fast_cleared))
+      return;
+
+   mtx_lock(&lpr->fast_clear_mutex);
+   if (lpr->fast_cleared && !p_atomic_read(&lpr->rendering_scenes)) {
+      unsigned tiles_x = llvmpipe_resource_tiles_x(lpr);
+      unsigned tiles_y = DIV_ROUND_UP(lpr->base.height0, TILE_SIZE);
+
+      for (unsigned ty = 0; ty < tiles_y; ty++) {
+         for (unsigned tx = 0; tx < tiles_x; tx++)
+            llvmpipe_resource_resolve_tile(lpr, tx, ty);
+      }
+      lpr->fast_cleared = false;
+   }
+   mtx_unlock(&lpr->fast_clear_mutex);
+}
+
+
 /**
  * Return size of resource in bytes
  */
@@ -31,6 +31,8 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "util/u_pack_color.h"
+#include "c11/threads.h"
 #include "lp_limits.h"
 #ifdef DEBUG
 #include "util/list.h"
@@ -103,6 +105,21 @@ struct llvmpipe_resource
    uint64_t backing_offset;
    bool backable;
    bool imported_memory;
+
+   /**
+    * Fast clear state for single level/layer color render targets.  One
+    * byte per TILE_SIZE x TILE_SIZE tile, non-zero while the tile holds
+    * clear_value only logically and its memory was not written yet.
+    * See llvmpipe_resource_fast_clear().
+    */
+   uint8_t *cleared_tiles;
+   bool fast_cleared;  /**< cleared_tiles may have tiles set */
+   enum pipe_format clear_format;
+   union util_color clear_value;
+   /** Number of scenes being rasterized that resolve tiles on first use */
+   unsigned rendering_scenes;
+   /** Serializes fast clears with whole resource resolves */
+   mtx_t fast_clear_mutex;
 #ifdef DEBUG
    struct list_head list;
 #endif
@@ -122,6 +139,13 @@ struct llvmpipe_memory_object
 };
 
 
+static inline unsigned
+llvmpipe_resource_tiles_x(const struct llvmpipe_resource *lpr)
+{
+   return DIV_ROUND_UP(lpr->base.width0, TILE_SIZE);
+}
+
+
 /** cast wrappers */
 static inline struct llvmpipe_resource *
 llvmpipe_resource(struct pipe_resource *pt)
@@ -249,6 +273,25 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
                                    unsigned face_slice, unsigned level);
 
 
+void
+llvmpipe_resource_fast_clear(struct llvmpipe_resource *lpr,
+                             enum pipe_format format,
+                             const union util_color *uc);
+
+boolean
+llvmpipe_resource_resolve_tile(struct llvmpipe_resource *lpr,
+                               unsigned tx, unsigned ty);
+
+boolean
+llvmpipe_resource_begin_render(struct llvmpipe_resource *lpr);
+
+void
+llvmpipe_resource_end_render(struct llvmpipe_resource *lpr);
+
+void
+llvmpipe_resource_resolve_fast_clear(struct llvmpipe_resource *lpr);
+
+
 extern void
 llvmpipe_print_resources(void);
 
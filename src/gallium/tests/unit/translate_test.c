@@ -29,6 +29,7 @@
 #include "util/format/u_format.h"
 #include "util/half_float.h"
 #include "util/u_cpu_detect.h"
+#include "util/os_time.h"
 #include "rtasm/rtasm_cpu.h"
 
 /* don't use this for serious use */
@@ -46,6 +47,104 @@ static double rand_double()
    return v;
 }
 
+/**
+ * Time the generic, SSE and LLVM implementations on a few common vertex
+ * layouts, both through run() and run_elts().
+ */
+static int benchmark(unsigned iterations)
+{
+   static const struct {
+      enum pipe_format input_format;
+      enum pipe_format output_format;
+   } layouts[] = {
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16_SNORM, PIPE_FORMAT_R32G32_FLOAT },
+      { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   };
+   static const struct {
+      const char *name;
+      struct translate *(*create_fn)(const struct translate_key *key);
+   } backends[] = {
+      { "generic", translate_generic_create },
+      { "sse", translate_sse2_create },
+#ifdef DRAW_LLVM_AVAILABLE
+      { "llvm", translate_llvm_create },
+#endif
+   };
+   const unsigned count = 65536;
+   unsigned char *input = align_malloc(count * 16, 64);
+   unsigned char *output = align_malloc(count * 16, 64);
+   unsigned *elts = align_malloc(count * sizeof *elts, 64);
+   unsigned i, j, k, n;
+
+   if (!input || !output || !elts)
+      return 1;
+
+   srand(4359025);
+   for (i = 0; i < count * 16; ++i)
+      input[i] = rand();
+   /* a post-transform cache friendly, but not sequential, index order */
+   for (i = 0; i < count; ++i)
+      elts[i] = (i & ~63) | ((i * 37) & 63);
+
+   printf("%-40s %-8s %12s %12s\n", "layout", "backend",
+          "run Mv/s", "elts Mv/s");
+
+   for (i = 0; i < ARRAY_SIZE(layouts); ++i) {
+      struct translate_key key;
+      char name[64];
+
+      memset(&key, 0, sizeof key);
+      key.nr_elements = 1;
+      key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+      key.element[0].input_format = layouts[i].input_format;
+      key.element[0].output_format = layouts[i].output_format;
+      key.output_stride = util_format_get_blocksize(layouts[i].output_format);
+
+      snprintf(name, sizeof name, "%s -> %s",
+               util_format_short_name(layouts[i].input_format),
+               util_format_short_name(layouts[i].output_format));
+
+      for (j = 0; j < ARRAY_SIZE(backends); ++j) {
+         struct translate *translate = backends[j].create_fn(&key);
+         double mverts[2];
+
+         if (!translate)
+            continue;
+
+         translate->set_buffer(translate, 0, input,
+                               util_format_get_blocksize(layouts[i].input_format),
+                               count - 1);
+
+         for (k = 0; k < 2; ++k) {
+            int64_t t0 = os_time_get_nano();
+
+            for (n = 0; n < iterations; ++n) {
+               if (k)
+                  translate->run_elts(translate, elts, count, 0, 0, output);
+               else
+                  translate->run(translate, 0, count, 0, 0, output);
+            }
+
+            mverts[k] = (double)count * iterations * 1000.0 /
+                        MAX2(os_time_get_nano() - t0, 1);
+         }
+
+         printf("%-40s %-8s %12.1f %12.1f\n", name, backends[j].name,
+                mverts[0], mverts[1]);
+
+         translate->release(translate);
+      }
+   }
+
+   align_free(elts);
+   align_free(output);
+   align_free(input);
+   return 0;
+}
+
 int main(int argc, char** argv)
 {
    struct translate *(*create_fn)(const struct translate_key *key) = 0;
@@ -69,6 +168,9 @@ int main(int argc, char** argv)
 
    create_fn = 0;
 
+   if (argc > 1 && !strcmp(argv[1], "bench"))
+      return benchmark(argc > 2 ? atoi(argv[2]) : 100);
+
    if (argc <= 1 ||
        !strcmp(argv[1], "default") )
       create_fn = translate_create;
@@ -126,10 +228,15 @@ int main(int argc, char** argv)
       }
       create_fn = translate_sse2_create;
    }
+#ifdef DRAW_LLVM_AVAILABLE
+   else if (!strcmp(argv[1], "llvm"))
+      create_fn = translate_llvm_create;
+#endif
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1|llvm]\n"
+             "       ./translate_test bench [iterations]\n");
       return 2;
    }
 
@@ -119,6 +119,9 @@ brw_compiler_create(void *mem_ctx, const struct intel_device_info *devinfo)
    /* Default to the sampler since that's what we've done since forever */
    compiler->indirect_ubos_use_sampler = true;
 
+   compiler->schedule_window_threshold =
+      env_var_as_unsigned("INTEL_SCHED_WINDOW_THRESHOLD", 4096);
+
    /* There is no vec4 mode on Gfx10+, and we don't use it at all on Gfx8+. */
    for (int i = MESA_SHADER_VERTEX; i < MESA_ALL_SHADER_STAGES; i++) {
       compiler->scalar_stage[i] = devinfo->ver >= 8 ||
@@ -217,7 +220,7 @@ insert_u64_bit(uint64_t *val, bool add)
 uint64_t
 brw_get_compiler_config_value(const struct brw_compiler *compiler)
 {
-   uint64_t config = 0;
+   uint64_t config = compiler->schedule_window_threshold;
    insert_u64_bit(&config, compiler->precise_trig);
 
    uint64_t mask = DEBUG_DISK_CACHE_MASK;
@@ -116,6 +116,14 @@ struct brw_compiler {
     */
    bool indirect_ubos_use_sampler;
 
+   /**
+    * Basic blocks with more instructions than this are scheduled in fixed
+    * size windows instead of as a single dependency graph, which keeps the
+    * scheduler's compile time linear in the size of huge unrolled blocks.
+    * Zero disables windowing.
+    */
+   unsigned schedule_window_threshold;
+
    struct nir_shader *clc_shader;
 };
 
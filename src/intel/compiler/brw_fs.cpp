@@ -41,7 +41,11 @@
 #include "compiler/glsl_types.h"
 #include "compiler/nir/nir_builder.h"
 #include "program/prog_parameter.h"
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_math.h"
+#include "util/u_queue.h"
+#include "c11/threads.h"
 
 using namespace brw;
 
@@ -637,9 +641,9 @@ fs_visitor::limit_dispatch_width(unsigned n, const char *msg)
       fail("%s", msg);
    } else {
       max_dispatch_width = MIN2(max_dispatch_width, n);
-      brw_shader_perf_log(compiler, log_data,
-                          "Shader dispatch width limited to SIMD%d: %s\n",
-                          n, msg);
+      backend_shader_perf_log(this,
+                              "Shader dispatch width limited to SIMD%d: %s\n",
+                              n, msg);
    }
 }
 
@@ -8986,11 +8990,11 @@ fs_visitor::allocate_registers(bool allow_spilling)
       fail("Failure to register allocate.  Reduce number of "
            "live scalar values to avoid this.");
    } else if (spilled_any_registers) {
-      brw_shader_perf_log(compiler, log_data,
-                          "%s shader triggered register spilling.  "
-                          "Try reducing the number of live scalar "
-                          "values to improve performance.\n",
-                          stage_name);
+      backend_shader_perf_log(this,
+                              "%s shader triggered register spilling.  "
+                              "Try reducing the number of live scalar "
+                              "values to improve performance.\n",
+                              stage_name);
    }
 
    /* This must come after all optimization and register allocation, since
@@ -9847,6 +9851,156 @@ brw_register_blocks(int reg_count)
    return ALIGN(reg_count, 16) / 16 - 1;
 }
 
+/**
+ * Whether the SIMD variants of a shader that don't depend on each other may
+ * be compiled concurrently.  Debug output from the visitors would interleave,
+ * so keep everything on the calling thread when it's enabled.
+ */
+static bool
+brw_simd_compile_in_parallel(bool debug_enabled)
+{
+   return !debug_enabled &&
+          !INTEL_DEBUG(DEBUG_NO_PARALLEL_SIMD | DEBUG_OPTIMIZER);
+}
+
+/**
+ * Queue shared by every compile in the process.  It only grows threads as
+ * jobs back up, so a process that never compiles in parallel, or compiles
+ * from many threads of its own, doesn't pay for a thread per SIMD width.
+ */
+static struct util_queue brw_simd_queue;
+static once_flag brw_simd_queue_once = ONCE_FLAG_INIT;
+
+static void
+brw_simd_queue_init(void)
+{
+   util_queue_init(&brw_simd_queue, "brw_simd", 8,
+                   MAX2(util_get_cpu_caps()->nr_cpus, 1),
+                   UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                   UTIL_QUEUE_INIT_SCALE_THREADS, NULL);
+}
+
+enum brw_simd_job_state {
+   BRW_SIMD_JOB_QUEUED,
+   BRW_SIMD_JOB_CLAIMED,
+};
+
+/**
+ * A SIMD variant compiled on brw_simd_queue.
+ *
+ * The visitor must have been created with a ralloc context and a copy of the
+ * prog_data that no other variant touches; the NIR it compiles is only read.
+ * Once brw_simd_job_wait() returns, fold the prog_data copy back into the
+ * shader's with brw_merge_simd_prog_data().
+ *
+ * Whichever of the queue and brw_simd_job_wait() claims the job first runs
+ * it, so a job stuck behind other compiles' work never stalls its caller
+ * for longer than compiling it directly would.
+ *
+ * The driver's perf log callback isn't thread-safe, so the visitor queues
+ * its messages and brw_simd_job_wait() passes them on from the calling
+ * thread.
+ */
+struct brw_simd_job {
+   fs_visitor *v;
+   bool allow_spilling;
+   bool do_rep_send;
+
+   bool result;
+   bool queued;
+   uint32_t state;
+   struct util_queue_fence fence;
+};
+
+static void
+brw_simd_job_run(struct brw_simd_job *job)
+{
+   if (job->v->stage == MESA_SHADER_FRAGMENT)
+      job->result = job->v->run_fs(job->allow_spilling, job->do_rep_send);
+   else
+      job->result = job->v->run_cs(job->allow_spilling);
+}
+
+static void
+brw_simd_job_execute(void *data, void *gdata, int thread_index)
+{
+   struct brw_simd_job *job = (struct brw_simd_job *)data;
+
+   if (p_atomic_cmpxchg(&job->state, BRW_SIMD_JOB_QUEUED,
+                        BRW_SIMD_JOB_CLAIMED) == BRW_SIMD_JOB_QUEUED)
+      brw_simd_job_run(job);
+}
+
+static void
+brw_simd_job_start(struct brw_simd_job *job, fs_visitor *v,
+                   bool allow_spilling, bool do_rep_send)
+{
+   job->v = v;
+   job->allow_spilling = allow_spilling;
+   job->do_rep_send = do_rep_send;
+   job->state = BRW_SIMD_JOB_QUEUED;
+
+   call_once(&brw_simd_queue_once, brw_simd_queue_init);
+
+   /* If the queue couldn't be created, just compile it right away. */
+   job->queued = util_queue_is_initialized(&brw_simd_queue);
+   if (job->queued) {
+      v->defer_perf_log = true;
+      util_queue_fence_init(&job->fence);
+      util_queue_add_job(&brw_simd_queue, job, &job->fence,
+                         brw_simd_job_execute, NULL, 0);
+   } else {
+      brw_simd_job_run(job);
+   }
+}
+
+static bool
+brw_simd_job_wait(struct brw_simd_job *job)
+{
+   if (job->queued) {
+      if (p_atomic_cmpxchg(&job->state, BRW_SIMD_JOB_QUEUED,
+                           BRW_SIMD_JOB_CLAIMED) == BRW_SIMD_JOB_QUEUED)
+         brw_simd_job_run(job);
+
+      util_queue_fence_wait(&job->fence);
+      util_queue_fence_destroy(&job->fence);
+      job->queued = false;
+
+      job->v->flush_perf_log();
+   }
+
+   return job->result;
+}
+
+/**
+ * Folds the prog_data a brw_simd_job compiled into back into the shader's.
+ *
+ * The visitors only accumulate into a few fields; everything else they write
+ * is computed identically for every dispatch width, and the per-width fields
+ * are filled in by the brw_compile_* functions themselves.
+ */
+static void
+brw_merge_simd_prog_data(struct brw_stage_prog_data *dst,
+                         const struct brw_stage_prog_data *src)
+{
+   dst->total_scratch = MAX2(dst->total_scratch, src->total_scratch);
+   dst->has_ubo_pull |= src->has_ubo_pull;
+
+   if (dst->stage == MESA_SHADER_FRAGMENT) {
+      struct brw_wm_prog_data *wm_dst = brw_wm_prog_data(dst);
+      const struct brw_wm_prog_data *wm_src = brw_wm_prog_data_const(src);
+
+      wm_dst->has_side_effects |= wm_src->has_side_effects;
+      wm_dst->pulls_bary |= wm_src->pulls_bary;
+   } else {
+      struct brw_cs_prog_data *cs_dst = brw_cs_prog_data(dst);
+      const struct brw_cs_prog_data *cs_src = brw_cs_prog_data_const(src);
+
+      cs_dst->uses_barrier |= cs_src->uses_barrier;
+      cs_dst->uses_num_work_groups |= cs_src->uses_num_work_groups;
+   }
+}
+
 const unsigned *
 brw_compile_fs(const struct brw_compiler *compiler,
                void *mem_ctx,
@@ -9939,9 +10093,41 @@ brw_compile_fs(const struct brw_compiler *compiler,
    if (nir->info.ray_queries > 0)
       v8->limit_dispatch_width(16, "SIMD32 with ray queries.\n");
 
-   if (!has_spilled &&
-       v8->max_dispatch_width >= 16 &&
-       (!INTEL_DEBUG(DEBUG_NO16) || params->use_rep_send)) {
+   const bool try_simd16 =
+      !has_spilled &&
+      v8->max_dispatch_width >= 16 &&
+      (!INTEL_DEBUG(DEBUG_NO16) || params->use_rep_send);
+
+   /* Currently, the compiler only supports SIMD32 on SNB+ */
+   const bool try_simd32 =
+      !has_spilled &&
+      v8->max_dispatch_width >= 32 && !params->use_rep_send &&
+      devinfo->ver >= 6 &&
+      !INTEL_DEBUG(DEBUG_NO32);
+
+   /* Whether SIMD32 is compiled also depends on how SIMD16 went, but both
+    * only build on the SIMD8 results, so compile them at the same time and
+    * throw SIMD32 away afterwards if SIMD16 would have prevented it.  That
+    * only gives the same result if spilling is already off, since a SIMD16
+    * success would disable it for SIMD32.
+    */
+   const bool parallel = try_simd16 && try_simd32 && !allow_spilling &&
+                         brw_simd_compile_in_parallel(debug_enabled);
+   struct brw_simd_job simd32_job = {};
+   struct brw_wm_prog_data *simd32_prog_data = NULL;
+
+   if (parallel) {
+      simd32_prog_data = ralloc(mem_ctx, struct brw_wm_prog_data);
+      *simd32_prog_data = *prog_data;
+
+      v32 = new fs_visitor(compiler, params->log_data, ralloc_context(mem_ctx),
+                           &key->base, &simd32_prog_data->base, nir, 32,
+                           debug_enabled);
+      v32->import_uniforms(v8);
+      brw_simd_job_start(&simd32_job, v32, allow_spilling, false);
+   }
+
+   if (try_simd16) {
       /* Try a SIMD16 compile */
       v16 = new fs_visitor(compiler, params->log_data, mem_ctx, &key->base,
                            &prog_data->base, nir, 16,
@@ -9964,17 +10150,21 @@ brw_compile_fs(const struct brw_compiler *compiler,
 
    const bool simd16_failed = v16 && !simd16_cfg;
 
-   /* Currently, the compiler only supports SIMD32 on SNB+ */
-   if (!has_spilled &&
-       v8->max_dispatch_width >= 32 && !params->use_rep_send &&
-       devinfo->ver >= 6 && !simd16_failed &&
-       !INTEL_DEBUG(DEBUG_NO32)) {
+   bool simd32_ok = false;
+   if (try_simd32 && !has_spilled && !simd16_failed) {
       /* Try a SIMD32 compile */
-      v32 = new fs_visitor(compiler, params->log_data, mem_ctx, &key->base,
-                           &prog_data->base, nir, 32,
-                           debug_enabled);
-      v32->import_uniforms(v8);
-      if (!v32->run_fs(allow_spilling, false)) {
+      if (parallel) {
+         simd32_ok = brw_simd_job_wait(&simd32_job);
+         brw_merge_simd_prog_data(&prog_data->base, &simd32_prog_data->base);
+      } else {
+         v32 = new fs_visitor(compiler, params->log_data, mem_ctx, &key->base,
+                              &prog_data->base, nir, 32,
+                              debug_enabled);
+         v32->import_uniforms(v8);
+         simd32_ok = v32->run_fs(allow_spilling, false);
+      }
+
+      if (!simd32_ok) {
          brw_shader_perf_log(compiler, params->log_data,
                              "SIMD32 shader failed to compile: %s\n",
                              v32->fail_msg);
@@ -9991,6 +10181,13 @@ brw_compile_fs(const struct brw_compiler *compiler,
             throughput = MAX2(throughput, perf.throughput);
          }
       }
+   } else if (parallel) {
+      /* SIMD16 spilled or failed, so SIMD32 wouldn't have been tried. */
+      brw_simd_job_wait(&simd32_job);
+      void *v32_ctx = v32->mem_ctx;
+      delete v32;
+      ralloc_free(v32_ctx);
+      v32 = NULL;
    }
 
    /* When the caller requests a repclear shader, they want SIMD16-only */
@@ -10249,6 +10446,18 @@ brw_compile_cs(const struct brw_compiler *compiler,
    fs_visitor *v[3]     = {0};
    const char *error[3] = {0};
 
+   /* With a variable workgroup size, every width that isn't disabled gets
+    * compiled and none of them depends on the results of the others, so once
+    * the first one succeeded (and decided the uniform layout) the rest can be
+    * compiled at the same time.  Gfx7 sizes scratch per compile rather than
+    * taking the max over all of them, so keep it serial there.
+    */
+   const bool parallel = nir->info.workgroup_size_variable &&
+                         compiler->devinfo->ver >= 8 &&
+                         brw_simd_compile_in_parallel(debug_enabled);
+   struct brw_simd_job jobs[3] = {};
+   struct brw_cs_prog_data *job_prog_data[3] = {};
+
    for (unsigned simd = 0; simd < 3; simd++) {
       if (!brw_simd_should_compile(mem_ctx, simd, compiler->devinfo, prog_data,
                                    required_dispatch_width, &error[simd]))
@@ -10269,9 +10478,18 @@ brw_compile_cs(const struct brw_compiler *compiler,
       brw_postprocess_nir(shader, compiler, true, debug_enabled,
                           key->base.robust_buffer_access);
 
-      v[simd] = new fs_visitor(compiler, params->log_data, mem_ctx, &key->base,
-                               &prog_data->base, shader, dispatch_width,
-                               debug_enabled);
+      const bool threaded = parallel && prog_data->prog_mask;
+      if (threaded) {
+         job_prog_data[simd] = ralloc(mem_ctx, struct brw_cs_prog_data);
+         *job_prog_data[simd] = *prog_data;
+      }
+
+      v[simd] = new fs_visitor(compiler, params->log_data,
+                               threaded ? ralloc_context(mem_ctx) : mem_ctx,
+                               &key->base,
+                               threaded ? &job_prog_data[simd]->base :
+                                          &prog_data->base,
+                               shader, dispatch_width, debug_enabled);
 
       if (prog_data->prog_mask) {
          unsigned first = ffs(prog_data->prog_mask) - 1;
@@ -10281,6 +10499,11 @@ brw_compile_cs(const struct brw_compiler *compiler,
       const bool allow_spilling = !prog_data->prog_mask ||
                                   nir->info.workgroup_size_variable;
 
+      if (threaded) {
+         brw_simd_job_start(&jobs[simd], v[simd], allow_spilling, false);
+         continue;
+      }
+
       if (v[simd]->run_cs(allow_spilling)) {
          /* We should always be able to do SIMD32 for compute shaders. */
          assert(v[simd]->max_dispatch_width >= 32);
@@ -10298,6 +10521,30 @@ brw_compile_cs(const struct brw_compiler *compiler,
       }
    }
 
+   /* Collect the variants compiled in parallel, in the order a serial
+    * compile would have finished them.
+    */
+   for (unsigned simd = 0; simd < 3; simd++) {
+      if (!job_prog_data[simd])
+         continue;
+
+      const bool ok = brw_simd_job_wait(&jobs[simd]);
+      brw_merge_simd_prog_data(&prog_data->base, &job_prog_data[simd]->base);
+
+      if (ok) {
+         assert(v[simd]->max_dispatch_width >= 32);
+
+         cs_fill_push_const_info(compiler->devinfo, prog_data);
+
+         brw_simd_mark_compiled(simd, prog_data, v[simd]->spilled_any_registers);
+      } else {
+         error[simd] = ralloc_strdup(mem_ctx, v[simd]->fail_msg);
+         brw_shader_perf_log(compiler, params->log_data,
+                             "SIMD%u shader failed to compile: %s\n",
+                             8u << simd, v[simd]->fail_msg);
+      }
+   }
+
    const int selected_simd = brw_simd_select(prog_data);
    if (selected_simd < 0) {
       params->error_str = ralloc_asprintf(mem_ctx, "Can't compile shader: %s, %s and %s.\n",
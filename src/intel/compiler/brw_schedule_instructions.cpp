@@ -58,6 +58,17 @@ using namespace brw;
 
 static bool debug = false;
 
+/**
+ * Number of instructions in each of the windows a block is split into when
+ * it is longer than brw_compiler::schedule_window_threshold.
+ *
+ * Instructions never move across window boundaries, so both the dependency
+ * graph and the list of ready candidates walked for every scheduled
+ * instruction are bounded by the window size rather than by the size of the
+ * block.
+ */
+#define SCHEDULE_WINDOW_SIZE 512
+
 class instruction_scheduler;
 
 class schedule_node : public exec_node
@@ -608,6 +619,8 @@ public:
       this->mode = mode;
       this->reg_pressure = 0;
       this->block_idx = 0;
+      this->windowed_blocks = 0;
+      this->windowed_instructions = 0;
       if (!post_reg_alloc) {
          this->reg_pressure_in = rzalloc_array(mem_ctx, int, block_count);
 
@@ -652,6 +665,8 @@ public:
 
    void run(cfg_t *cfg);
    void add_insts_from_block(bblock_t *block);
+   backend_instruction *add_insts_from_window(backend_instruction *start,
+                                              unsigned count);
    void compute_delays();
    void compute_exits();
    virtual void calculate_deps() = 0;
@@ -671,7 +686,10 @@ public:
    virtual void update_register_pressure(backend_instruction *inst) = 0;
    virtual int get_register_pressure_benefit(backend_instruction *inst) = 0;
 
-   void schedule_instructions(bblock_t *block);
+   void schedule_instructions(bblock_t *block,
+                              backend_instruction *window_end,
+                              int instructions_to_schedule);
+   void schedule_block(bblock_t *block);
 
    void *mem_ctx;
 
@@ -685,6 +703,13 @@ public:
 
    instruction_scheduler_mode mode;
 
+   /*
+    * Number of blocks and instructions scheduled in windows because their
+    * block was longer than brw_compiler::schedule_window_threshold.
+    */
+   unsigned windowed_blocks;
+   unsigned windowed_instructions;
+
    /*
     * The register pressure at the beginning of each basic block.
     */
@@ -990,6 +1015,27 @@ instruction_scheduler::add_insts_from_block(bblock_t *block)
    }
 }
 
+/**
+ * Adds \p count instructions starting at \p start and returns the
+ * instruction following them, or NULL if the window reaches the end of the
+ * block.
+ */
+backend_instruction *
+instruction_scheduler::add_insts_from_window(backend_instruction *start,
+                                             unsigned count)
+{
+   backend_instruction *inst = start;
+
+   for (unsigned i = 0; i < count; i++) {
+      schedule_node *n = new(mem_ctx) schedule_node(inst, this);
+
+      instructions.push_tail(n);
+      inst = (backend_instruction *)inst->next;
+   }
+
+   return inst->is_tail_sentinel() ? NULL : inst;
+}
+
 /** Computation of the delay member of each node. */
 void
 instruction_scheduler::compute_delays()
@@ -1743,16 +1789,18 @@ vec4_instruction_scheduler::issue_time(backend_instruction *)
    return 2;
 }
 
+/**
+ * Schedules the nodes currently in the instruction list, which are either a
+ * whole block or a window of it.  Scheduled instructions are inserted before
+ * \p window_end, or appended to the block if it is NULL.
+ */
 void
-instruction_scheduler::schedule_instructions(bblock_t *block)
+instruction_scheduler::schedule_instructions(bblock_t *block,
+                                             backend_instruction *window_end,
+                                             int instructions_to_schedule)
 {
    const struct intel_device_info *devinfo = bs->devinfo;
    int time = 0;
-   int instructions_to_schedule = block->end_ip - block->start_ip + 1;
-
-   if (!post_reg_alloc)
-      reg_pressure = reg_pressure_in[block->num];
-   block_idx = block->num;
 
    /* Remove non-DAG heads from the list. */
    foreach_in_list_safe(schedule_node, n, &instructions) {
@@ -1768,7 +1816,10 @@ instruction_scheduler::schedule_instructions(bblock_t *block)
       assert(chosen);
       chosen->remove();
       chosen->inst->exec_node::remove();
-      block->instructions.push_tail(chosen->inst);
+      if (window_end)
+         window_end->exec_node::insert_before(chosen->inst);
+      else
+         block->instructions.push_tail(chosen->inst);
       instructions_to_schedule--;
 
       if (!post_reg_alloc) {
@@ -1840,6 +1891,50 @@ instruction_scheduler::schedule_instructions(bblock_t *block)
    assert(instructions_to_schedule == 0);
 }
 
+void
+instruction_scheduler::schedule_block(bblock_t *block)
+{
+   const unsigned threshold = bs->compiler->schedule_window_threshold;
+   const int block_size = block->end_ip - block->start_ip + 1;
+
+   if (!post_reg_alloc)
+      reg_pressure = reg_pressure_in[block->num];
+   block_idx = block->num;
+
+   if (threshold == 0 || block_size <= (int)threshold) {
+      add_insts_from_block(block);
+
+      calculate_deps();
+
+      compute_delays();
+      compute_exits();
+
+      schedule_instructions(block, NULL, block_size);
+      return;
+   }
+
+   windowed_blocks++;
+   windowed_instructions += block_size;
+
+   /* Every window is scheduled in place, in front of the first instruction
+    * of the next one, so the following window always starts at the
+    * instruction returned by add_insts_from_window() before scheduling.
+    */
+   backend_instruction *start = block->start();
+   for (int first = 0; first < block_size; first += SCHEDULE_WINDOW_SIZE) {
+      const int count = MIN2(SCHEDULE_WINDOW_SIZE, block_size - first);
+      backend_instruction *window_end = add_insts_from_window(start, count);
+
+      calculate_deps();
+
+      compute_delays();
+      compute_exits();
+
+      schedule_instructions(block, window_end, count);
+      start = window_end;
+   }
+}
+
 void
 instruction_scheduler::run(cfg_t *cfg)
 {
@@ -1864,14 +1959,7 @@ instruction_scheduler::run(cfg_t *cfg)
             count_reads_remaining(inst);
       }
 
-      add_insts_from_block(block);
-
-      calculate_deps();
-
-      compute_delays();
-      compute_exits();
-
-      schedule_instructions(block);
+      schedule_block(block);
    }
 
    if (debug && !post_reg_alloc) {
@@ -1894,6 +1982,18 @@ fs_visitor::schedule_instructions(instruction_scheduler_mode mode)
                                   cfg->num_blocks, mode);
    sched.run(cfg);
 
+   /* The pre-RA modes may run several times per shader, only report the
+    * post-RA schedule, which every compiled shader goes through once.
+    */
+   if (mode == SCHEDULE_POST && sched.windowed_blocks) {
+      backend_shader_perf_log(this,
+                              "SIMD%d %s shader: scheduled %u instructions "
+                              "in %u blocks with a %d instruction window\n",
+                              dispatch_width, stage_abbrev,
+                              sched.windowed_instructions,
+                              sched.windowed_blocks, SCHEDULE_WINDOW_SIZE);
+   }
+
    invalidate_analysis(DEPENDENCY_INSTRUCTIONS);
 }
 
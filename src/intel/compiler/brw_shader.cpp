@@ -731,6 +731,7 @@ backend_shader::backend_shader(const struct brw_compiler *compiler,
                                bool debug_enabled)
    : compiler(compiler),
      log_data(log_data),
+     defer_perf_log(false),
      devinfo(compiler->devinfo),
      nir(shader),
      stage_prog_data(stage_prog_data),
@@ -741,12 +742,47 @@ backend_shader::backend_shader(const struct brw_compiler *compiler,
 {
    stage_name = _mesa_shader_stage_to_string(stage);
    stage_abbrev = _mesa_shader_stage_to_abbrev(stage);
+   util_dynarray_init(&perf_log_queue, mem_ctx);
 }
 
 backend_shader::~backend_shader()
 {
 }
 
+struct brw_queued_perf_log {
+   unsigned *id;
+   char *msg;
+};
+
+void
+backend_shader::queue_perf_log(unsigned *id, const char *fmt, ...)
+{
+   struct brw_queued_perf_log entry;
+   va_list args;
+
+   va_start(args, fmt);
+   entry.id = id;
+   entry.msg = ralloc_vasprintf(mem_ctx, fmt, args);
+   va_end(args);
+
+   util_dynarray_append(&perf_log_queue, struct brw_queued_perf_log, entry);
+}
+
+/**
+ * Passes the messages queued while defer_perf_log was set on to
+ * compiler->shader_perf_log, in order.  Must be called on the thread that
+ * log_data belongs to.
+ */
+void
+backend_shader::flush_perf_log()
+{
+   util_dynarray_foreach(&perf_log_queue, struct brw_queued_perf_log, entry)
+      compiler->shader_perf_log(log_data, entry->id, "%s", entry->msg);
+
+   util_dynarray_clear(&perf_log_queue);
+   defer_perf_log = false;
+}
+
 bool
 backend_reg::equals(const backend_reg &r) const
 {
@@ -28,6 +28,7 @@
 #include "brw_cfg.h"
 #include "brw_compiler.h"
 #include "compiler/nir/nir.h"
+#include "util/u_dynarray.h"
 
 #ifdef __cplusplus
 #include "brw_ir_analysis.h"
@@ -59,6 +60,14 @@ public:
    const struct brw_compiler *compiler;
    void *log_data; /* Passed to compiler->*_log functions */
 
+   /**
+    * Whether perf log messages are held back in perf_log_queue rather than
+    * passed to compiler->shader_perf_log.  Set while compiling on another
+    * thread than the one log_data belongs to, until flush_perf_log().
+    */
+   bool defer_perf_log;
+   struct util_dynarray perf_log_queue;
+
    const struct intel_device_info * const devinfo;
    const nir_shader *nir;
    struct brw_stage_prog_data * const stage_prog_data;
@@ -89,9 +98,21 @@ public:
 
    void calculate_cfg();
 
+   void queue_perf_log(unsigned *id, const char *fmt, ...) PRINTFLIKE(3, 4);
+   void flush_perf_log();
+
    virtual void invalidate_analysis(brw::analysis_dependency_class c);
 };
 
+#define backend_shader_perf_log(s, fmt, ... ) do {                     \
+   static unsigned id = 0;                                             \
+   if ((s)->defer_perf_log)                                            \
+      (s)->queue_perf_log(&id, fmt, ##__VA_ARGS__);                    \
+   else                                                                \
+      (s)->compiler->shader_perf_log((s)->log_data, &id, fmt,          \
+                                     ##__VA_ARGS__);                   \
+} while (0)
+
 #else
 struct backend_shader;
 #endif /* __cplusplus */
@@ -0,0 +1,978 @@
+/*
+ * Copyright © 2022 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Offline batch compiler for shader-db style corpora.
+ *
+ * Every input file is either a SPIR-V module or a serialized NIR shader
+ * (nir_serialize) and is compiled with the brw backend for the requested
+ * platform without any driver or hardware.  Shaders are spread across a
+ * pool of worker threads and, once everything is done, the per-variant
+ * statistics and per-phase compile times are printed in input order,
+ * followed by totals for the whole corpus.
+ *
+ * Vulkan SPIR-V goes through a minimal, driver-independent lowering:
+ * descriptors are assigned flat binding table indices in declaration order
+ * and push constants become uniforms.  OpenCL kernels are compiled with
+ * brw_kernel_from_spirv().  Serialized NIR is expected to have been lowered
+ * by a driver already and is handed to the backend as-is.
+ */
+
+#include "brw_compiler.h"
+#include "brw_kernel.h"
+#include "brw_nir.h"
+#include "compiler/glsl_types.h"
+#include "compiler/nir/nir_builder.h"
+#include "compiler/nir/nir_serialize.h"
+#include "compiler/spirv/nir_spirv.h"
+#include "compiler/spirv/spirv.h"
+#include "dev/intel_debug.h"
+#include "util/bitscan.h"
+#include "util/blob.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/ralloc.h"
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_dynarray.h"
+
+#include "c11/threads.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SPIR_V_MAGIC_NUMBER 0x07230203
+
+enum ics_phase {
+   ICS_PHASE_FRONTEND,
+   ICS_PHASE_PREPROCESS,
+   ICS_PHASE_LOWER,
+   ICS_PHASE_BACKEND,
+   ICS_PHASE_COUNT,
+};
+
+static const char *ics_phase_names[ICS_PHASE_COUNT] = {
+   [ICS_PHASE_FRONTEND]   = "frontend",
+   [ICS_PHASE_PREPROCESS] = "preprocess",
+   [ICS_PHASE_LOWER]      = "lower",
+   [ICS_PHASE_BACKEND]    = "backend",
+};
+
+struct ics_shader {
+   const char *path;
+   const void *data;
+   size_t size;
+
+   void *mem_ctx;
+
+   gl_shader_stage stage;
+   bool compiled;
+   char *error;
+
+   /** Output of compiler->shader_debug_log/shader_perf_log. */
+   char *log;
+
+   struct brw_compile_stats stats[3];
+   unsigned num_stats;
+
+   uint64_t time_ns[ICS_PHASE_COUNT];
+};
+
+struct ics_state {
+   struct brw_compiler *compiler;
+
+   struct ics_shader *shaders;
+   unsigned num_shaders;
+
+   /** Index of the next shader to be picked up by a worker. */
+   unsigned next_shader;
+
+   bool verbose;
+};
+
+struct ics_binding {
+   unsigned set;
+   unsigned binding;
+   unsigned bti;
+   unsigned sampler;
+};
+
+struct ics_bind_map {
+   struct util_dynarray bindings;
+   unsigned next_bti;
+   unsigned next_sampler;
+};
+
+/* Only ever called from the thread compiling the shader: SIMD variants that
+ * brw_compile_cs() compiles in parallel have their messages replayed on the
+ * calling thread, so the log doesn't need a lock.
+ */
+static void
+compiler_log(void *data, unsigned *id, const char *fmt, ...)
+{
+   struct ics_shader *shader = data;
+   if (shader == NULL)
+      return;
+
+   va_list args;
+   va_start(args, fmt);
+   if (shader->log == NULL)
+      shader->log = ralloc_strdup(shader->mem_ctx, "");
+   ralloc_vasprintf_append(&shader->log, fmt, args);
+   va_end(args);
+}
+
+static void
+print_usage(char *exec_name, FILE *f)
+{
+   fprintf(f,
+"Usage: %s [options] <input files>\n"
+"Options:\n"
+"  -h  --help              Print this help.\n"
+"  -p, --platform <name>   Specify the target platform name or PCI id.\n"
+"  -j, --threads <count>   Number of compiler threads (default: CPU count).\n"
+"  -v, --verbose           Also print the compiler's own statistics lines.\n"
+"\n"
+"Inputs are SPIR-V modules or NIR serialized with nir_serialize().\n"
+   , exec_name);
+}
+
+static const struct ics_binding *
+ics_get_binding(struct ics_bind_map *map, unsigned set, unsigned binding)
+{
+   util_dynarray_foreach(&map->bindings, struct ics_binding, b) {
+      if (b->set == set && b->binding == binding)
+         return b;
+   }
+   return NULL;
+}
+
+static void
+ics_build_bind_map(nir_shader *nir, struct ics_bind_map *map,
+                   unsigned first_bti)
+{
+   map->next_bti = first_bti;
+   map->next_sampler = 0;
+
+   nir_foreach_variable_with_modes(var, nir, nir_var_uniform |
+                                             nir_var_image |
+                                             nir_var_mem_ubo |
+                                             nir_var_mem_ssbo) {
+      if (ics_get_binding(map, var->data.descriptor_set, var->data.binding))
+         continue;
+
+      const struct glsl_type *type = glsl_without_array(var->type);
+      const unsigned array_size =
+         glsl_type_is_array(var->type) ? MAX2(glsl_get_aoa_size(var->type), 1) : 1;
+
+      struct ics_binding b = {
+         .set = var->data.descriptor_set,
+         .binding = var->data.binding,
+         .bti = map->next_bti,
+      };
+
+      if (glsl_type_is_sampler(type)) {
+         b.sampler = map->next_sampler;
+         map->next_sampler += array_size;
+         if (!glsl_type_is_bare_sampler(type))
+            map->next_bti += array_size;
+      } else {
+         map->next_bti += array_size;
+      }
+
+      util_dynarray_append(&map->bindings, struct ics_binding, b);
+   }
+}
+
+static nir_ssa_def *
+ics_deref_index(nir_builder *b, nir_deref_instr *deref, unsigned *base,
+                struct ics_bind_map *map, bool sampler)
+{
+   nir_ssa_def *index = NULL;
+
+   if (deref->deref_type == nir_deref_type_array) {
+      if (nir_src_is_const(deref->arr.index))
+         *base += nir_src_as_uint(deref->arr.index);
+      else
+         index = nir_ssa_for_src(b, deref->arr.index, 1);
+      deref = nir_deref_instr_parent(deref);
+   }
+
+   assert(deref->deref_type == nir_deref_type_var);
+   nir_variable *var = deref->var;
+   const struct ics_binding *binding =
+      ics_get_binding(map, var->data.descriptor_set, var->data.binding);
+   assert(binding);
+
+   *base += sampler ? binding->sampler : binding->bti;
+
+   return index;
+}
+
+static bool
+ics_lower_tex(nir_builder *b, nir_tex_instr *tex, struct ics_bind_map *map)
+{
+   bool progress = false;
+
+   b->cursor = nir_before_instr(&tex->instr);
+
+   for (unsigned i = 0; i < tex->num_srcs; i++) {
+      const bool is_sampler = tex->src[i].src_type == nir_tex_src_sampler_deref;
+      if (tex->src[i].src_type != nir_tex_src_texture_deref && !is_sampler)
+         continue;
+
+      unsigned base = 0;
+      nir_ssa_def *index =
+         ics_deref_index(b, nir_src_as_deref(tex->src[i].src), &base,
+                         map, is_sampler);
+
+      if (is_sampler)
+         tex->sampler_index = base;
+      else
+         tex->texture_index = base;
+
+      if (index) {
+         nir_instr_rewrite_src(&tex->instr, &tex->src[i].src,
+                               nir_src_for_ssa(index));
+         tex->src[i].src_type = is_sampler ? nir_tex_src_sampler_offset :
+                                             nir_tex_src_texture_offset;
+      } else {
+         nir_tex_instr_remove_src(tex, i);
+         i--;
+      }
+      progress = true;
+   }
+
+   return progress;
+}
+
+static bool
+ics_lower_intrinsic(nir_builder *b, nir_intrinsic_instr *intrin,
+                    struct ics_bind_map *map)
+{
+   b->cursor = nir_before_instr(&intrin->instr);
+
+   nir_ssa_def *repl;
+   switch (intrin->intrinsic) {
+   case nir_intrinsic_vulkan_resource_index: {
+      const struct ics_binding *binding =
+         ics_get_binding(map, nir_intrinsic_desc_set(intrin),
+                         nir_intrinsic_binding(intrin));
+      assert(binding);
+      repl = nir_vec2(b, nir_iadd_imm(b, intrin->src[0].ssa, binding->bti),
+                         nir_imm_int(b, 0));
+      break;
+   }
+
+   case nir_intrinsic_vulkan_resource_reindex:
+      repl = nir_vec2(b, nir_iadd(b, nir_channel(b, intrin->src[0].ssa, 0),
+                                     intrin->src[1].ssa),
+                         nir_channel(b, intrin->src[0].ssa, 1));
+      break;
+
+   case nir_intrinsic_load_vulkan_descriptor:
+      repl = intrin->src[0].ssa;
+      break;
+
+   case nir_intrinsic_image_deref_load:
+   case nir_intrinsic_image_deref_store:
+   case nir_intrinsic_image_deref_atomic_add:
+   case nir_intrinsic_image_deref_atomic_imin:
+   case nir_intrinsic_image_deref_atomic_umin:
+   case nir_intrinsic_image_deref_atomic_imax:
+   case nir_intrinsic_image_deref_atomic_umax:
+   case nir_intrinsic_image_deref_atomic_and:
+   case nir_intrinsic_image_deref_atomic_or:
+   case nir_intrinsic_image_deref_atomic_xor:
+   case nir_intrinsic_image_deref_atomic_exchange:
+   case nir_intrinsic_image_deref_atomic_comp_swap:
+   case nir_intrinsic_image_deref_atomic_fadd:
+   case nir_intrinsic_image_deref_size:
+   case nir_intrinsic_image_deref_samples:
+   case nir_intrinsic_image_deref_load_raw_intel:
+   case nir_intrinsic_image_deref_store_raw_intel: {
+      unsigned base = 0;
+      nir_ssa_def *index =
+         ics_deref_index(b, nir_src_as_deref(intrin->src[0]), &base,
+                         map, false);
+      index = index ? nir_iadd_imm(b, index, base) : nir_imm_int(b, base);
+      nir_rewrite_image_intrinsic(intrin, index, false);
+      return true;
+   }
+
+   default:
+      return false;
+   }
+
+   nir_ssa_def_rewrite_uses(&intrin->dest.ssa, repl);
+   nir_instr_remove(&intrin->instr);
+   return true;
+}
+
+static bool
+ics_lower_descriptors_instr(nir_builder *b, nir_instr *instr, void *data)
+{
+   switch (instr->type) {
+   case nir_instr_type_tex:
+      return ics_lower_tex(b, nir_instr_as_tex(instr), data);
+   case nir_instr_type_intrinsic:
+      return ics_lower_intrinsic(b, nir_instr_as_intrinsic(instr), data);
+   default:
+      return false;
+   }
+}
+
+/**
+ * Turns load_push_constant into load_uniform, the same way anv does, and
+ * returns the size of the push constant range actually used.
+ */
+static unsigned
+ics_lower_push_constants(nir_shader *nir)
+{
+   unsigned push_end = 0;
+
+   nir_foreach_function(function, nir) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block) {
+            if (instr->type != nir_instr_type_intrinsic)
+               continue;
+
+            nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+            if (intrin->intrinsic != nir_intrinsic_load_push_constant)
+               continue;
+
+            intrin->intrinsic = nir_intrinsic_load_uniform;
+            push_end = MAX2(push_end, nir_intrinsic_base(intrin) +
+                                      nir_intrinsic_range(intrin));
+         }
+      }
+   }
+
+   return ALIGN(push_end, 4);
+}
+
+static void
+ics_setup_params(void *mem_ctx, nir_shader *nir,
+                 struct brw_stage_prog_data *prog_data)
+{
+   prog_data->nr_params = nir->num_uniforms / 4;
+   prog_data->param = rzalloc_array(mem_ctx, uint32_t, prog_data->nr_params);
+}
+
+static nir_shader *
+ics_spirv_to_nir(const struct brw_compiler *compiler, void *mem_ctx,
+                 const uint32_t *words, size_t word_count,
+                 gl_shader_stage stage, const char *entry_point)
+{
+   const struct intel_device_info *devinfo = compiler->devinfo;
+
+   const struct spirv_to_nir_options spirv_options = {
+      .caps = {
+         .demote_to_helper_invocation = true,
+         .derivative_group = true,
+         .descriptor_array_dynamic_indexing = true,
+         .descriptor_array_non_uniform_indexing = true,
+         .descriptor_indexing = true,
+         .draw_parameters = true,
+         .float16 = devinfo->ver >= 8,
+         .float64 = devinfo->ver >= 8,
+         .image_write_without_format = true,
+         .int8 = devinfo->ver >= 8,
+         .int16 = devinfo->ver >= 8,
+         .int64 = devinfo->ver >= 8,
+         .integer_functions2 = devinfo->ver >= 8,
+         .min_lod = true,
+         .physical_storage_buffer_address = devinfo->ver >= 8,
+         .runtime_descriptor_array = true,
+         .float_controls = devinfo->ver >= 8,
+         .shader_clock = true,
+         .shader_viewport_index_layer = true,
+         .storage_8bit = devinfo->ver >= 8,
+         .storage_16bit = devinfo->ver >= 8,
+         .subgroup_arithmetic = true,
+         .subgroup_basic = true,
+         .subgroup_ballot = true,
+         .subgroup_dispatch = true,
+         .subgroup_quad = true,
+         .subgroup_shuffle = true,
+         .subgroup_vote = true,
+         .variable_pointers = true,
+         .vk_memory_model = true,
+         .vk_memory_model_device_scope = true,
+         .workgroup_memory_explicit_layout = true,
+      },
+      .ubo_addr_format = nir_address_format_32bit_index_offset,
+      .ssbo_addr_format = nir_address_format_32bit_index_offset,
+      .phys_ssbo_addr_format = nir_address_format_64bit_global,
+      .push_const_addr_format = nir_address_format_logical,
+      .shared_addr_format = nir_address_format_32bit_offset,
+   };
+
+   nir_shader *nir =
+      spirv_to_nir(words, word_count, NULL, 0, stage, entry_point,
+                   &spirv_options, compiler->nir_options[stage]);
+   if (nir == NULL)
+      return NULL;
+
+   ralloc_steal(mem_ctx, nir);
+
+   /* Same clean-up as vk_spirv_to_nir() */
+   NIR_PASS_V(nir, nir_lower_variable_initializers, nir_var_function_temp);
+   NIR_PASS_V(nir, nir_lower_returns);
+   NIR_PASS_V(nir, nir_inline_functions);
+   NIR_PASS_V(nir, nir_copy_prop);
+   NIR_PASS_V(nir, nir_opt_deref);
+   nir_remove_non_entrypoints(nir);
+   NIR_PASS_V(nir, nir_lower_variable_initializers, ~0);
+   NIR_PASS_V(nir, nir_split_var_copies);
+   NIR_PASS_V(nir, nir_split_per_member_structs);
+   NIR_PASS_V(nir, nir_remove_dead_variables,
+              nir_var_shader_in | nir_var_shader_out | nir_var_system_value,
+              NULL);
+   NIR_PASS_V(nir, nir_propagate_invariant, false);
+
+   NIR_PASS_V(nir, nir_lower_io_to_temporaries,
+              nir_shader_get_entrypoint(nir), true, false);
+   NIR_PASS_V(nir, nir_lower_frexp);
+
+   nir->info.separate_shader = true;
+
+   return nir;
+}
+
+/**
+ * Applies the lowering a Vulkan driver would do between brw_preprocess_nir
+ * and the backend.  Returns the first unused binding table index.
+ */
+static unsigned
+ics_lower_vulkan_nir(const struct brw_compiler *compiler, void *mem_ctx,
+                     nir_shader *nir)
+{
+   struct ics_bind_map map;
+   util_dynarray_init(&map.bindings, mem_ctx);
+
+   nir_shader_gather_info(nir, nir_shader_get_entrypoint(nir));
+
+   NIR_PASS_V(nir, brw_nir_lower_storage_image, compiler->devinfo);
+
+   NIR_PASS_V(nir, nir_lower_explicit_io, nir_var_mem_global,
+              nir_address_format_64bit_global);
+   NIR_PASS_V(nir, nir_lower_explicit_io, nir_var_mem_push_const,
+              nir_address_format_32bit_offset);
+
+   /* Render targets take the first binding table entries of a fragment
+    * shader.
+    */
+   ics_build_bind_map(nir, &map, nir->info.stage == MESA_SHADER_FRAGMENT ?
+                                 BRW_MAX_DRAW_BUFFERS : 0);
+   NIR_PASS_V(nir, nir_shader_instructions_pass, ics_lower_descriptors_instr,
+              nir_metadata_block_index | nir_metadata_dominance, &map);
+
+   NIR_PASS_V(nir, nir_lower_explicit_io,
+              nir_var_mem_ubo | nir_var_mem_ssbo,
+              nir_address_format_32bit_index_offset);
+
+   NIR_PASS_V(nir, nir_copy_prop);
+   NIR_PASS_V(nir, nir_opt_constant_folding);
+
+   nir->num_uniforms = ics_lower_push_constants(nir);
+
+   if (gl_shader_stage_uses_workgroup(nir->info.stage)) {
+      if (!nir->info.shared_memory_explicit_layout) {
+         NIR_PASS_V(nir, nir_lower_vars_to_explicit_types,
+                    nir_var_mem_shared, glsl_get_natural_size_align_bytes);
+      }
+
+      NIR_PASS_V(nir, nir_lower_explicit_io,
+                 nir_var_mem_shared, nir_address_format_32bit_offset);
+   }
+
+   if (gl_shader_stage_is_compute(nir->info.stage))
+      NIR_PASS_V(nir, brw_nir_lower_cs_intrinsics);
+
+   return map.next_bti;
+}
+
+/**
+ * Finds the first entry point of a SPIR-V module that we know how to
+ * compile.
+ */
+static bool
+ics_find_entry_point(const uint32_t *words, size_t word_count,
+                     gl_shader_stage *stage, const char **name)
+{
+   for (size_t i = 5; i < word_count;) {
+      const unsigned opcode = words[i] & SpvOpCodeMask;
+      const unsigned count = words[i] >> SpvWordCountShift;
+      if (count == 0 || i + count > word_count)
+         return false;
+
+      if (opcode == SpvOpEntryPoint && count >= 4) {
+         const char *str = (const char *)&words[i + 3];
+         if (memchr(str, '\0', (count - 3) * 4) == NULL)
+            return false;
+
+         switch (words[i + 1]) {
+         case SpvExecutionModelVertex:
+            *stage = MESA_SHADER_VERTEX;
+            break;
+         case SpvExecutionModelFragment:
+            *stage = MESA_SHADER_FRAGMENT;
+            break;
+         case SpvExecutionModelGLCompute:
+            *stage = MESA_SHADER_COMPUTE;
+            break;
+         case SpvExecutionModelKernel:
+            *stage = MESA_SHADER_KERNEL;
+            break;
+         default:
+            i += count;
+            continue;
+         }
+
+         *name = str;
+         return true;
+      }
+
+      i += count;
+   }
+
+   return false;
+}
+
+static const unsigned *
+ics_compile_nir(struct ics_shader *shader, const struct brw_compiler *compiler,
+                nir_shader *nir, unsigned first_free_bti)
+{
+   const struct intel_device_info *devinfo = compiler->devinfo;
+   void *mem_ctx = shader->mem_ctx;
+   const unsigned *assembly = NULL;
+   char *error_str = NULL;
+
+   switch (nir->info.stage) {
+   case MESA_SHADER_VERTEX: {
+      struct brw_vs_prog_key key = {};
+      struct brw_vs_prog_data *prog_data =
+         rzalloc(mem_ctx, struct brw_vs_prog_data);
+
+      ics_setup_params(mem_ctx, nir, &prog_data->base.base);
+      brw_nir_analyze_ubo_ranges(compiler, nir, &key,
+                                 prog_data->base.base.ubo_ranges);
+      brw_compute_vue_map(devinfo, &prog_data->base.vue_map,
+                          nir->info.outputs_written,
+                          nir->info.separate_shader, 1);
+
+      struct brw_compile_vs_params params = {
+         .nir = nir,
+         .key = &key,
+         .prog_data = prog_data,
+         .stats = shader->stats,
+         .log_data = shader,
+      };
+      assembly = brw_compile_vs(compiler, mem_ctx, &params);
+      error_str = params.error_str;
+      shader->num_stats = 1;
+      break;
+   }
+
+   case MESA_SHADER_FRAGMENT: {
+      const unsigned color_outputs =
+         (nir->info.outputs_written >> FRAG_RESULT_DATA0) &
+         BITFIELD_MASK(BRW_MAX_DRAW_BUFFERS);
+      struct brw_wm_prog_key key = {
+         .nr_color_regions = util_last_bit(color_outputs),
+         .color_outputs_valid = color_outputs,
+         .input_slots_valid = nir->info.inputs_read | VARYING_BIT_POS,
+      };
+      struct brw_wm_prog_data *prog_data =
+         rzalloc(mem_ctx, struct brw_wm_prog_data);
+
+      ics_setup_params(mem_ctx, nir, &prog_data->base);
+      brw_nir_analyze_ubo_ranges(compiler, nir, NULL,
+                                 prog_data->base.ubo_ranges);
+
+      struct brw_compile_fs_params params = {
+         .nir = nir,
+         .key = &key,
+         .prog_data = prog_data,
+         .allow_spilling = true,
+         .stats = shader->stats,
+         .log_data = shader,
+      };
+      assembly = brw_compile_fs(compiler, mem_ctx, &params);
+      error_str = params.error_str;
+      shader->num_stats = prog_data->dispatch_8 + prog_data->dispatch_16 +
+                          prog_data->dispatch_32;
+      break;
+   }
+
+   case MESA_SHADER_COMPUTE: {
+      struct brw_cs_prog_key key = {
+         .base.subgroup_size_type = BRW_SUBGROUP_SIZE_VARYING,
+      };
+      struct brw_cs_prog_data *prog_data =
+         rzalloc(mem_ctx, struct brw_cs_prog_data);
+
+      ics_setup_params(mem_ctx, nir, &prog_data->base);
+      prog_data->binding_table.work_groups_start = first_free_bti;
+
+      struct brw_compile_cs_params params = {
+         .nir = nir,
+         .key = &key,
+         .prog_data = prog_data,
+         .stats = shader->stats,
+         .log_data = shader,
+      };
+      assembly = brw_compile_cs(compiler, mem_ctx, &params);
+      error_str = params.error_str;
+      shader->num_stats = util_bitcount(prog_data->prog_mask);
+      break;
+   }
+
+   default:
+      error_str = ralloc_asprintf(mem_ctx, "unsupported shader stage %s",
+                                  gl_shader_stage_name(nir->info.stage));
+      break;
+   }
+
+   if (assembly == NULL)
+      shader->error = error_str;
+
+   return assembly;
+}
+
+static void
+ics_compile_spirv(struct ics_shader *shader, struct brw_compiler *compiler)
+{
+   const uint32_t *words = shader->data;
+   const size_t word_count = shader->size / 4;
+   const char *entry_point = NULL;
+
+   if (!ics_find_entry_point(words, word_count, &shader->stage,
+                             &entry_point)) {
+      shader->error = "no supported entry point";
+      return;
+   }
+
+   int64_t start = os_time_get_nano();
+
+   if (shader->stage == MESA_SHADER_KERNEL) {
+      struct brw_kernel kernel = {};
+      char *error_str = NULL;
+
+      shader->compiled =
+         brw_kernel_from_spirv(compiler, NULL, &kernel, shader,
+                               shader->mem_ctx, words, shader->size,
+                               entry_point, &error_str);
+      shader->time_ns[ICS_PHASE_BACKEND] = os_time_get_nano() - start;
+      if (!shader->compiled) {
+         shader->error = error_str;
+         return;
+      }
+
+      memcpy(shader->stats, kernel.stats, sizeof(shader->stats));
+      shader->num_stats = util_bitcount(kernel.prog_data.prog_mask);
+      return;
+   }
+
+   nir_shader *nir = ics_spirv_to_nir(compiler, shader->mem_ctx, words,
+                                      word_count, shader->stage,
+                                      entry_point);
+   int64_t end = os_time_get_nano();
+   shader->time_ns[ICS_PHASE_FRONTEND] = end - start;
+   if (nir == NULL) {
+      shader->error = "spirv_to_nir failed";
+      return;
+   }
+
+   start = end;
+   brw_preprocess_nir(compiler, nir, NULL);
+   end = os_time_get_nano();
+   shader->time_ns[ICS_PHASE_PREPROCESS] = end - start;
+
+   start = end;
+   const unsigned first_free_bti =
+      ics_lower_vulkan_nir(compiler, shader->mem_ctx, nir);
+   end = os_time_get_nano();
+   shader->time_ns[ICS_PHASE_LOWER] = end - start;
+
+   start = end;
+   shader->compiled = ics_compile_nir(shader, compiler, nir,
+                                      first_free_bti) != NULL;
+   shader->time_ns[ICS_PHASE_BACKEND] = os_time_get_nano() - start;
+}
+
+static void
+ics_compile_serialized_nir(struct ics_shader *shader,
+                           struct brw_compiler *compiler)
+{
+   int64_t start = os_time_get_nano();
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, shader->data, shader->size);
+   nir_shader *nir = nir_deserialize(shader->mem_ctx, NULL, &reader);
+   if (nir == NULL || reader.overrun) {
+      shader->error = "failed to deserialize NIR";
+      return;
+   }
+
+   shader->stage = nir->info.stage;
+   nir->options = compiler->nir_options[nir->info.stage];
+
+   int64_t end = os_time_get_nano();
+   shader->time_ns[ICS_PHASE_FRONTEND] = end - start;
+
+   start = end;
+   shader->compiled = ics_compile_nir(shader, compiler, nir,
+                                      nir->info.num_ssbos +
+                                      nir->info.num_ubos +
+                                      nir->info.num_textures +
+                                      nir->info.num_images) != NULL;
+   shader->time_ns[ICS_PHASE_BACKEND] = os_time_get_nano() - start;
+}
+
+static int
+ics_worker(void *data)
+{
+   struct ics_state *state = data;
+
+   unsigned i;
+   while ((i = p_atomic_inc_return(&state->next_shader) - 1) <
+          state->num_shaders) {
+      struct ics_shader *shader = &state->shaders[i];
+
+      if (shader->size >= 4 &&
+          *(const uint32_t *)shader->data == SPIR_V_MAGIC_NUMBER)
+         ics_compile_spirv(shader, state->compiler);
+      else
+         ics_compile_serialized_nir(shader, state->compiler);
+   }
+
+   return 0;
+}
+
+static void
+ics_print_results(const struct ics_state *state)
+{
+   uint64_t total_instructions = 0, total_cycles = 0, total_sends = 0;
+   uint64_t total_spills = 0, total_fills = 0;
+   uint64_t total_time_ns[ICS_PHASE_COUNT] = { 0 };
+   unsigned failed = 0;
+
+   for (unsigned i = 0; i < state->num_shaders; i++) {
+      const struct ics_shader *shader = &state->shaders[i];
+
+      if (state->verbose && shader->log)
+         fputs(shader->log, stdout);
+
+      if (!shader->compiled) {
+         printf("%s: FAIL: %s\n", shader->path,
+                shader->error ? shader->error : "unknown error");
+         failed++;
+         continue;
+      }
+
+      for (unsigned s = 0; s < shader->num_stats; s++) {
+         const struct brw_compile_stats *stats = &shader->stats[s];
+         printf("%s: %s SIMD%u: %u inst, %u loops, %u cycles, "
+                "%u:%u spills:fills, %u sends\n",
+                shader->path, gl_shader_stage_name(shader->stage),
+                stats->dispatch_width, stats->instructions, stats->loops,
+                stats->cycles, stats->spills, stats->fills, stats->sends);
+
+         total_instructions += stats->instructions;
+         total_cycles += stats->cycles;
+         total_sends += stats->sends;
+         total_spills += stats->spills;
+         total_fills += stats->fills;
+      }
+
+      printf("%s: time:", shader->path);
+      for (unsigned p = 0; p < ICS_PHASE_COUNT; p++) {
+         printf(" %s %.3fms", ics_phase_names[p],
+                shader->time_ns[p] / 1000000.0);
+         total_time_ns[p] += shader->time_ns[p];
+      }
+      printf("\n");
+   }
+
+   printf("\nTotal: %u shaders, %u failed\n", state->num_shaders, failed);
+   printf("Total: %" PRIu64 " inst, %" PRIu64 " cycles, "
+          "%" PRIu64 ":%" PRIu64 " spills:fills, %" PRIu64 " sends\n",
+          total_instructions, total_cycles, total_spills, total_fills,
+          total_sends);
+   printf("Total time (summed over threads):");
+   for (unsigned p = 0; p < ICS_PHASE_COUNT; p++)
+      printf(" %s %.3fms", ics_phase_names[p], total_time_ns[p] / 1000000.0);
+   printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+   brw_process_intel_debug_variable();
+
+   static struct option long_options[] ={
+      {"help",       no_argument,         0, 'h'},
+      {"platform",   required_argument,   0, 'p'},
+      {"threads",    required_argument,   0, 'j'},
+      {"verbose",    no_argument,         0, 'v'},
+      {0, 0, 0, 0}
+   };
+
+   const char *platform = NULL;
+   unsigned num_threads = 0;
+   bool verbose = false;
+
+   int ch;
+   while ((ch = getopt_long(argc, argv, "hp:j:v", long_options, NULL)) != -1)
+   {
+      switch (ch)
+      {
+      case 'h':
+         print_usage(argv[0], stdout);
+         return 0;
+      case 'p':
+         platform = optarg;
+         break;
+      case 'j':
+         num_threads = strtoul(optarg, NULL, 0);
+         break;
+      case 'v':
+         verbose = true;
+         break;
+      default:
+         fprintf(stderr, "Unrecognized option \"%s\".\n", optarg);
+         print_usage(argv[0], stderr);
+         return 1;
+      }
+   }
+
+   if (optind >= argc) {
+      fprintf(stderr, "No input file(s).\n");
+      print_usage(argv[0], stderr);
+      return -1;
+   }
+
+   if (platform == NULL) {
+      fprintf(stderr, "No target platform name specified.\n");
+      print_usage(argv[0], stderr);
+      return -1;
+   }
+
+   /* Accept a PCI id as well, for devices that share a platform name. */
+   char *end;
+   int pci_id = strtol(platform, &end, 0);
+   if (*platform == '\0' || *end != '\0')
+      pci_id = intel_device_name_to_pci_device_id(platform);
+   if (pci_id < 0) {
+      fprintf(stderr, "Invalid target platform name: %s\n", platform);
+      return -1;
+   }
+
+   struct intel_device_info _devinfo, *devinfo = &_devinfo;
+   if (!intel_get_device_info_from_pci_id(pci_id, devinfo)) {
+      fprintf(stderr, "Failed to get device information.\n");
+      return -1;
+   }
+
+   void *mem_ctx = ralloc_context(NULL);
+
+   struct ics_state state = {
+      .num_shaders = argc - optind,
+      .verbose = verbose,
+   };
+   state.shaders = rzalloc_array(mem_ctx, struct ics_shader, state.num_shaders);
+
+   for (unsigned i = 0; i < state.num_shaders; i++) {
+      struct ics_shader *shader = &state.shaders[i];
+      shader->path = argv[optind + i];
+      shader->mem_ctx = ralloc_context(mem_ctx);
+
+      int fd = open(shader->path, O_RDONLY);
+      if (fd < 0) {
+         fprintf(stderr, "Failed to open %s\n", shader->path);
+         ralloc_free(mem_ctx);
+         return 1;
+      }
+
+      off_t len = lseek(fd, 0, SEEK_END);
+      const void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (map == MAP_FAILED) {
+         fprintf(stderr, "Failed to mmap %s: errno=%d, %s\n",
+                 shader->path, errno, strerror(errno));
+         ralloc_free(mem_ctx);
+         return 1;
+      }
+
+      shader->data = map;
+      shader->size = len;
+   }
+
+   state.compiler = brw_compiler_create(mem_ctx, devinfo);
+   state.compiler->shader_debug_log = compiler_log;
+   state.compiler->shader_perf_log = compiler_log;
+
+   glsl_type_singleton_init_or_ref();
+
+   if (num_threads == 0)
+      num_threads = util_get_cpu_caps()->nr_cpus;
+   num_threads = CLAMP(num_threads, 1, state.num_shaders);
+
+   thrd_t *threads = ralloc_array(mem_ctx, thrd_t, num_threads);
+   unsigned started = 0;
+   for (unsigned i = 1; i < num_threads; i++) {
+      if (thrd_create(&threads[started], ics_worker, &state) != thrd_success)
+         break;
+      started++;
+   }
+
+   /* The main thread works too, which also covers -j1 and failing to spawn
+    * any worker.
+    */
+   ics_worker(&state);
+
+   for (unsigned i = 0; i < started; i++)
+      thrd_join(threads[i], NULL);
+
+   ics_print_results(&state);
+
+   glsl_type_singleton_decref();
+
+   for (unsigned i = 0; i < state.num_shaders; i++)
+      munmap((void *)state.shaders[i].data, state.shaders[i].size);
+
+   ralloc_free(mem_ctx);
+
+   return 0;
+}
@@ -94,6 +94,7 @@ static const struct debug_control debug_control[] = {
    { "task",        DEBUG_TASK },
    { "mesh",        DEBUG_MESH },
    { "stall",       DEBUG_STALL },
+   { "noparsimd",   DEBUG_NO_PARALLEL_SIMD },
    { NULL,    0 }
 };
 
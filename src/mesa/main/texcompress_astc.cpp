@@ -1853,17 +1853,15 @@ _mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
          unsigned dst_blk_w = MIN2(blk_w, src_width  - x*blk_w);
          unsigned dst_blk_h = MIN2(blk_h, src_height - y*blk_h);
 
+         /* Narrow whole rows at a time so that the compiler can vectorize
+          * the conversion.
+          */
          for (unsigned sub_y = 0; sub_y < dst_blk_h; ++sub_y) {
-            for (unsigned sub_x = 0; sub_x < dst_blk_w; ++sub_x) {
-               uint8_t *dst = dst_row + sub_y * dst_stride +
-                              (x * blk_w + sub_x) * 4;
-               const uint16_t *src = &block_out[(sub_y * blk_w + sub_x) * 4];
-
-               dst[0] = src[0];
-               dst[1] = src[1];
-               dst[2] = src[2];
-               dst[3] = src[3];
-            }
+            uint8_t *dst = dst_row + sub_y * dst_stride + x * blk_w * 4;
+            const uint16_t *src = &block_out[sub_y * blk_w * 4];
+
+            for (unsigned i = 0; i < dst_blk_w * 4; ++i)
+               dst[i] = src[i];
          }
       }
       src_row += src_stride;
@@ -56,6 +56,7 @@
 #include "st_program.h"
 #include "st_sampler_view.h"
 #include "st_shader_cache.h"
+#include "st_texcompress.h"
 #include "st_texture.h"
 #include "st_util.h"
 #include "pipe/p_context.h"
@@ -382,6 +383,7 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
    st_destroy_pbo_helpers(st);
    st_destroy_bound_texture_handles(st);
    st_destroy_bound_image_handles(st);
+   st_destroy_texcompress(st);
 
    /* free glReadPixels cache data */
    st_invalidate_readpix_cache(st);
@@ -36,6 +36,7 @@
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "vbo/vbo.h"
 #include "util/list.h"
 #include "cso_cache/cso_context.h"
@@ -50,6 +51,7 @@ struct draw_context;
 struct draw_stage;
 struct gen_mipmap_state;
 struct st_context;
+struct st_decompress_cache;
 struct st_program;
 struct u_upload_mgr;
 
@@ -383,6 +385,15 @@ struct st_context
       struct st_zombie_shader_node list;
       simple_mtx_t mutex;
    } zombie_shaders;
+
+   /* Worker threads for decompressing formats the driver can't sample,
+    * created on first use. See st_texcompress.c.
+    */
+   struct util_queue decompress_queue;
+   bool decompress_queue_failed;
+
+   /* Cache of decoded images, created on first use. */
+   struct st_decompress_cache *decompress_cache;
 };
 
 
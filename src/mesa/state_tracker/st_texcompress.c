@@ -0,0 +1,509 @@
+/* SPDX-License-Identifier: MIT */
+
+/**
+ * Decompression of compressed formats that the driver can't sample
+ * natively (ETC1, ETC2, ASTC).
+ *
+ * All of these formats are made of independent blocks, so a large image is
+ * split into bands of whole block rows which are decoded concurrently on a
+ * small per-context thread pool. Small images are decoded on the calling
+ * thread, where the cost of waking up the workers isn't worth it.
+ *
+ * Decoded images are also kept in a cache keyed by the SHA-1 of the
+ * compressed data, so that re-uploading the same texture doesn't decode it
+ * again. The cache lives in memory, with an LRU size limit, and can
+ * optionally be backed by the on-disk shader cache so that decoded textures
+ * survive across process runs.
+ */
+
+#include "main/macros.h"
+#include "main/texcompress_astc.h"
+#include "main/texcompress_etc.h"
+
+#include "state_tracker/st_context.h"
+#include "state_tracker/st_format.h"
+#include "state_tracker/st_texcompress.h"
+
+#include "util/disk_cache.h"
+#include "util/format/u_format.h"
+#include "util/hash_table.h"
+#include "util/list.h"
+#include "util/mesa-sha1.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+
+/* Images with fewer pixels than this are decoded on the calling thread. */
+#define ST_DECOMPRESS_MIN_PIXELS_PER_JOB (128 * 128)
+
+#define ST_DECOMPRESS_MAX_THREADS 8
+
+/* Images with fewer pixels than this aren't worth caching. */
+#define ST_DECOMPRESS_CACHE_MIN_PIXELS (64 * 64)
+
+/* Don't put decoded images larger than this into the disk cache. */
+#define ST_DECOMPRESS_DISK_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+DEBUG_GET_ONCE_NUM_OPTION(st_decompress_threads, "ST_DECOMPRESS_THREADS", -1)
+DEBUG_GET_ONCE_NUM_OPTION(st_decompress_cache_size, "ST_DECOMPRESS_CACHE_SIZE", 64)
+DEBUG_GET_ONCE_BOOL_OPTION(st_decompress_disk_cache, "ST_DECOMPRESS_DISK_CACHE", false)
+
+struct st_decompress_cache_entry {
+   unsigned char sha1[20];
+   struct list_head link;  /**< in st_decompress_cache::lru */
+   size_t size;
+   uint8_t data[];         /**< tightly packed RGBA8888 rows */
+};
+
+struct st_decompress_cache {
+   struct hash_table *ht;
+   struct list_head lru;   /**< most recently used first */
+   size_t size;
+   size_t max_size;
+};
+
+struct st_decompress_job {
+   uint8_t *dst;
+   unsigned dst_stride;
+   const uint8_t *src;
+   unsigned src_stride;
+   unsigned width;
+   unsigned height;
+   mesa_format format;
+   bool bgra;
+
+   struct util_queue_fence fence;
+};
+
+static void
+decompress_rgba8888(uint8_t *dst, unsigned dst_stride,
+                    const uint8_t *src, unsigned src_stride,
+                    unsigned width, unsigned height,
+                    mesa_format format, bool bgra)
+{
+   if (format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(dst, dst_stride, src, src_stride,
+                                 width, height);
+   } else if (_mesa_is_format_etc2(format)) {
+      _mesa_unpack_etc2_format(dst, dst_stride, src, src_stride,
+                               width, height, format, bgra);
+   } else if (_mesa_is_format_astc_2d(format)) {
+      _mesa_unpack_astc_2d_ldr(dst, dst_stride, src, src_stride,
+                               width, height, format);
+   } else {
+      unreachable("unexpected format for a compressed format fallback");
+   }
+}
+
+static void
+decompress_job_execute(void *data, void *gdata, int thread_index)
+{
+   struct st_decompress_job *job = (struct st_decompress_job *)data;
+
+   decompress_rgba8888(job->dst, job->dst_stride, job->src, job->src_stride,
+                       job->width, job->height, job->format, job->bgra);
+}
+
+/**
+ * Return the number of worker threads to use, or 0 to always decode on the
+ * calling thread.
+ */
+static unsigned
+decompress_num_threads(void)
+{
+   long num_threads = debug_get_option_st_decompress_threads();
+
+   if (num_threads < 0)
+      num_threads = MIN2(util_get_cpu_caps()->nr_cpus - 1,
+                         ST_DECOMPRESS_MAX_THREADS);
+
+   return CLAMP(num_threads, 0, ST_DECOMPRESS_MAX_THREADS);
+}
+
+static bool
+decompress_queue_init(struct st_context *st)
+{
+   if (util_queue_is_initialized(&st->decompress_queue))
+      return true;
+
+   if (st->decompress_queue_failed)
+      return false;
+
+   unsigned num_threads = decompress_num_threads();
+
+   if (!num_threads ||
+       !util_queue_init(&st->decompress_queue, "st_dec", num_threads * 2,
+                        num_threads, 0, NULL)) {
+      st->decompress_queue_failed = true;
+      return false;
+   }
+
+   return true;
+}
+
+static uint32_t
+sha1_key_hash(const void *key)
+{
+   /* The key is already a good hash. */
+   uint32_t hash;
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+sha1_key_equals(const void *a, const void *b)
+{
+   return memcmp(a, b, 20) == 0;
+}
+
+static bool
+decompress_disk_cache_enabled(struct st_context *st)
+{
+   return st->ctx->Cache && debug_get_option_st_decompress_disk_cache();
+}
+
+static struct st_decompress_cache *
+decompress_cache_get(struct st_context *st)
+{
+   if (st->decompress_cache)
+      return st->decompress_cache;
+
+   long max_size_mb = debug_get_option_st_decompress_cache_size();
+   if (max_size_mb <= 0)
+      return NULL;
+
+   struct st_decompress_cache *cache = CALLOC_STRUCT(st_decompress_cache);
+   if (!cache)
+      return NULL;
+
+   cache->ht = _mesa_hash_table_create(NULL, sha1_key_hash, sha1_key_equals);
+   if (!cache->ht) {
+      FREE(cache);
+      return NULL;
+   }
+
+   list_inithead(&cache->lru);
+   cache->max_size = (size_t)max_size_mb * 1024 * 1024;
+   st->decompress_cache = cache;
+   return cache;
+}
+
+static void
+decompress_cache_evict(struct st_decompress_cache *cache,
+                       struct st_decompress_cache_entry *entry)
+{
+   _mesa_hash_table_remove_key(cache->ht, entry->sha1);
+   list_del(&entry->link);
+   cache->size -= entry->size;
+   FREE(entry);
+}
+
+static struct st_decompress_cache_entry *
+decompress_cache_entry_create(const unsigned char sha1[20], size_t size)
+{
+   struct st_decompress_cache_entry *entry = MALLOC(sizeof(*entry) + size);
+   if (!entry)
+      return NULL;
+
+   memcpy(entry->sha1, sha1, sizeof(entry->sha1));
+   entry->size = size;
+   return entry;
+}
+
+/**
+ * Add \p entry to the cache, which takes ownership of it.
+ */
+static void
+decompress_cache_insert(struct st_decompress_cache *cache,
+                        struct st_decompress_cache_entry *entry)
+{
+   if (entry->size > cache->max_size) {
+      FREE(entry);
+      return;
+   }
+
+   while (cache->size + entry->size > cache->max_size)
+      decompress_cache_evict(cache,
+                             list_last_entry(&cache->lru,
+                                             struct st_decompress_cache_entry,
+                                             link));
+
+   _mesa_hash_table_insert(cache->ht, entry->sha1, entry);
+   list_add(&entry->link, &cache->lru);
+   cache->size += entry->size;
+}
+
+/**
+ * Hash the compressed image together with everything else that affects the
+ * decoded result.
+ */
+static void
+compute_image_sha1(const uint8_t *src, unsigned src_stride,
+                   unsigned width, unsigned height,
+                   mesa_format format, bool bgra,
+                   unsigned char sha1[20])
+{
+   unsigned blk_w, blk_h;
+   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+
+   unsigned num_block_rows = DIV_ROUND_UP(height, blk_h);
+   unsigned row_size = DIV_ROUND_UP(width, blk_w) *
+                       _mesa_get_format_bytes(format);
+
+   static const char tag[] = "st_decompress";
+   uint32_t header[4] = { format, bgra, width, height };
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, tag, sizeof(tag));
+   _mesa_sha1_update(&ctx, header, sizeof(header));
+
+   if (src_stride == row_size) {
+      _mesa_sha1_update(&ctx, src, (size_t)row_size * num_block_rows);
+   } else {
+      for (unsigned i = 0; i < num_block_rows; i++)
+         _mesa_sha1_update(&ctx, src + (size_t)i * src_stride, row_size);
+   }
+
+   _mesa_sha1_final(&ctx, sha1);
+}
+
+/**
+ * Size of a decoded pixel of \p format: that of the uncompressed fallback
+ * format (e.g. R16 for ETC2 R11), or RGBA8 for images decoded before being
+ * transcoded to another compressed format.
+ */
+static unsigned
+decompressed_pixel_size(struct st_context *st, mesa_format format)
+{
+   enum pipe_format fallback = st_mesa_format_to_pipe_format(st, format);
+
+   if (util_format_is_compressed(fallback))
+      return 4;
+
+   return util_format_get_blocksize(fallback);
+}
+
+static void
+copy_rows(uint8_t *dst, unsigned dst_stride,
+          const uint8_t *src, unsigned src_stride,
+          unsigned row_size, unsigned height)
+{
+   if (dst_stride == row_size && src_stride == row_size) {
+      memcpy(dst, src, (size_t)row_size * height);
+      return;
+   }
+
+   for (unsigned y = 0; y < height; y++)
+      memcpy(dst + (size_t)y * dst_stride, src + (size_t)y * src_stride,
+             row_size);
+}
+
+/**
+ * Look up a decoded image in the memory cache, then in the disk cache.
+ * On a hit, the image is copied to \p dst.
+ */
+static bool
+decompress_cache_lookup(struct st_context *st,
+                        struct st_decompress_cache *cache,
+                        const unsigned char sha1[20],
+                        uint8_t *dst, unsigned dst_stride,
+                        unsigned row_size, unsigned height)
+{
+   size_t size = (size_t)row_size * height;
+
+   if (cache) {
+      struct hash_entry *he = _mesa_hash_table_search(cache->ht, sha1);
+
+      if (he) {
+         struct st_decompress_cache_entry *entry = he->data;
+
+         assert(entry->size == size);
+         list_del(&entry->link);
+         list_add(&entry->link, &cache->lru);
+
+         copy_rows(dst, dst_stride, entry->data, row_size, row_size, height);
+         return true;
+      }
+   }
+
+   if (!decompress_disk_cache_enabled(st))
+      return false;
+
+   struct disk_cache *disk_cache = st->ctx->Cache;
+   cache_key key;
+   size_t disk_size;
+   disk_cache_compute_key(disk_cache, sha1, 20, key);
+
+   void *data = disk_cache_get(disk_cache, key, &disk_size);
+   if (!data)
+      return false;
+
+   if (disk_size != size) {
+      free(data);
+      return false;
+   }
+
+   copy_rows(dst, dst_stride, data, row_size, row_size, height);
+
+   if (cache) {
+      struct st_decompress_cache_entry *entry =
+         decompress_cache_entry_create(sha1, size);
+
+      if (entry) {
+         memcpy(entry->data, data, size);
+         decompress_cache_insert(cache, entry);
+      }
+   }
+
+   free(data);
+   return true;
+}
+
+static void
+decompress_image(struct st_context *st,
+                 uint8_t *dst, unsigned dst_stride,
+                 const uint8_t *src, unsigned src_stride,
+                 unsigned width, unsigned height,
+                 mesa_format format, bool bgra)
+{
+   unsigned blk_w, blk_h;
+   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+
+   unsigned num_block_rows = DIV_ROUND_UP(height, blk_h);
+   unsigned num_jobs =
+      MIN2(num_block_rows,
+           (width * height) / ST_DECOMPRESS_MIN_PIXELS_PER_JOB);
+
+   if (num_jobs <= 1 || !decompress_queue_init(st)) {
+      decompress_rgba8888(dst, dst_stride, src, src_stride,
+                          width, height, format, bgra);
+      return;
+   }
+
+   /* One band per thread plus one for the calling thread. */
+   num_jobs = MIN2(num_jobs, st->decompress_queue.num_threads + 1);
+
+   struct st_decompress_job jobs[ST_DECOMPRESS_MAX_THREADS + 1];
+   unsigned rows_per_job = DIV_ROUND_UP(num_block_rows, num_jobs);
+   unsigned num_queued = 0;
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      unsigned first_row = i * rows_per_job;
+      if (first_row >= num_block_rows)
+         break;
+
+      unsigned y = first_row * blk_h;
+      struct st_decompress_job *job = &jobs[i];
+
+      job->dst = dst + (size_t)y * dst_stride;
+      job->dst_stride = dst_stride;
+      job->src = src + (size_t)first_row * src_stride;
+      job->src_stride = src_stride;
+      job->width = width;
+      job->height = MIN2(rows_per_job * blk_h, height - y);
+      job->format = format;
+      job->bgra = bgra;
+      num_queued++;
+   }
+
+   /* Queue all bands but the first, which is decoded on this thread. */
+   for (unsigned i = 1; i < num_queued; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job(&st->decompress_queue, &jobs[i], &jobs[i].fence,
+                         decompress_job_execute, NULL, 0);
+   }
+
+   decompress_job_execute(&jobs[0], NULL, 0);
+
+   for (unsigned i = 1; i < num_queued; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+/**
+ * Decompress a \p width x \p height image of \p format into the layout of
+ * its uncompressed fallback format (RGBA8888 for most formats).
+ * \p src points to the first block row, \p dst to the first pixel row.
+ */
+void
+st_decompress_fallback_image(struct st_context *st,
+                             uint8_t *dst, unsigned dst_stride,
+                             const uint8_t *src, unsigned src_stride,
+                             unsigned width, unsigned height,
+                             mesa_format format, bool bgra)
+{
+   if (width * height < ST_DECOMPRESS_CACHE_MIN_PIXELS) {
+      decompress_image(st, dst, dst_stride, src, src_stride,
+                       width, height, format, bgra);
+      return;
+   }
+
+   struct st_decompress_cache *cache = decompress_cache_get(st);
+   bool use_disk_cache = decompress_disk_cache_enabled(st);
+   unsigned char sha1[20];
+
+   if (!cache && !use_disk_cache) {
+      decompress_image(st, dst, dst_stride, src, src_stride,
+                       width, height, format, bgra);
+      return;
+   }
+
+   compute_image_sha1(src, src_stride, width, height, format, bgra, sha1);
+
+   unsigned row_size = width * decompressed_pixel_size(st, format);
+
+   if (decompress_cache_lookup(st, cache, sha1, dst, dst_stride,
+                               row_size, height))
+      return;
+
+   /* Decode into a tightly packed copy owned by the cache rather than
+    * reading back from \p dst, which may be a write-combined mapping.
+    */
+   size_t size = (size_t)row_size * height;
+   struct st_decompress_cache_entry *entry =
+      decompress_cache_entry_create(sha1, size);
+
+   if (!entry) {
+      decompress_image(st, dst, dst_stride, src, src_stride,
+                       width, height, format, bgra);
+      return;
+   }
+
+   decompress_image(st, entry->data, row_size, src, src_stride,
+                    width, height, format, bgra);
+   copy_rows(dst, dst_stride, entry->data, row_size, row_size, height);
+
+   if (use_disk_cache && size <= ST_DECOMPRESS_DISK_CACHE_MAX_SIZE) {
+      cache_key key;
+      disk_cache_compute_key(st->ctx->Cache, sha1, 20, key);
+      disk_cache_put(st->ctx->Cache, key, entry->data, size, NULL);
+   }
+
+   if (cache)
+      decompress_cache_insert(cache, entry);
+   else
+      FREE(entry);
+}
+
+static void
+delete_cache_entry(struct hash_entry *he)
+{
+   FREE(he->data);
+}
+
+void
+st_destroy_texcompress(struct st_context *st)
+{
+   if (util_queue_is_initialized(&st->decompress_queue))
+      util_queue_destroy(&st->decompress_queue);
+
+   if (st->decompress_cache) {
+      _mesa_hash_table_destroy(st->decompress_cache->ht, delete_cache_entry);
+      FREE(st->decompress_cache);
+      st->decompress_cache = NULL;
+   }
+}
@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: MIT */
+
+#ifndef ST_TEXCOMPRESS_H
+#define ST_TEXCOMPRESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main/formats.h"
+
+struct st_context;
+
+void
+st_decompress_fallback_image(struct st_context *st,
+                             uint8_t *dst, unsigned dst_stride,
+                             const uint8_t *src, unsigned src_stride,
+                             unsigned width, unsigned height,
+                             mesa_format format, bool bgra);
+
+void
+st_destroy_texcompress(struct st_context *st);
+
+#endif /* ST_TEXCOMPRESS_H */
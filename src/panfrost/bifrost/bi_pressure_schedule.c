@@ -304,6 +304,9 @@ pressure_schedule_block(bi_context *ctx, bi_block *block, struct sched_ctx *s)
                 bi_liveness_ins_update(s->live, node->instr, s->max);
         }
 
+        ctx->max_pressure = MAX2(ctx->max_pressure,
+                                 MIN2(max_pressure, orig_max_pressure));
+
         /* Bail if it looks like it's worse */
         if (max_pressure >= orig_max_pressure) {
                 free(schedule);
@@ -30,6 +30,7 @@
 #include "compiler/nir/nir_builder.h"
 #include "compiler/nir/nir_schedule.h"
 #include "util/u_debug.h"
+#include "util/os_time.h"
 
 #include "disassemble.h"
 #include "valhall/va_compiler.h"
@@ -4104,6 +4105,20 @@ bi_shader_stage_name(bi_context *ctx)
                 return gl_shader_stage_name(ctx->stage);
 }
 
+static void
+bi_gather_stats(bi_context *ctx, struct bi_stats *stats)
+{
+        bi_foreach_block(ctx, block) {
+                bi_foreach_clause_in_block(block, clause) {
+                        stats->nr_clauses++;
+                        stats->nr_tuples += clause->tuple_count;
+
+                        for (unsigned i = 0; i < clause->tuple_count; ++i)
+                                bi_count_tuple_stats(clause, &clause->tuples[i], stats);
+                }
+        }
+}
+
 static void
 bi_print_stats(bi_context *ctx, unsigned size, FILE *fp)
 {
@@ -4120,16 +4135,7 @@ bi_print_stats(bi_context *ctx, unsigned size, FILE *fp)
          * These numbers seem to match Arm Mobile Studio's heuristic. The real
          * cycle counts are surely more complicated.
          */
-
-        bi_foreach_block(ctx, block) {
-                bi_foreach_clause_in_block(block, clause) {
-                        stats.nr_clauses++;
-                        stats.nr_tuples += clause->tuple_count;
-
-                        for (unsigned i = 0; i < clause->tuple_count; ++i)
-                                bi_count_tuple_stats(clause, &clause->tuples[i], &stats);
-                }
-        }
+        bi_gather_stats(ctx, &stats);
 
         float cycles_arith = ((float) stats.nr_arith) / 24.0;
         float cycles_texture = ((float) stats.nr_texture) / 2.0;
@@ -4216,6 +4222,44 @@ va_print_stats(bi_context *ctx, unsigned size, FILE *fp)
                         ctx->loop_count, ctx->spills, ctx->fills);
 }
 
+/* Accumulate statistics for offline tools, see struct bifrost_shader_stats */
+static void
+bi_record_stats(bi_context *ctx, unsigned size,
+                struct bifrost_shader_stats *out)
+{
+        if (ctx->arch >= 9) {
+                bi_foreach_instr_global(ctx, I)
+                        out->nr_ins++;
+        } else {
+                struct bi_stats stats = { 0 };
+                bi_gather_stats(ctx, &stats);
+
+                out->nr_ins += stats.nr_ins;
+                out->nr_tuples += stats.nr_tuples;
+                out->nr_clauses += stats.nr_clauses;
+        }
+
+        out->size += size;
+        out->max_pressure = MAX2(out->max_pressure, ctx->max_pressure);
+        out->pressure_scheduled = !(bifrost_debug & BIFROST_DBG_NOPSCHED);
+        out->work_reg_count = MAX2(out->work_reg_count, ctx->info.work_reg_count);
+        out->loops += ctx->loop_count;
+        out->spills += ctx->spills;
+        out->fills += ctx->fills;
+}
+
+static void
+bi_end_phase(const struct panfrost_compile_inputs *inputs,
+             enum bifrost_compile_phase phase, int64_t *start)
+{
+        if (!inputs->stats)
+                return;
+
+        int64_t now = os_time_get_nano();
+        inputs->stats->phase_time[phase] += now - *start;
+        *start = now;
+}
+
 static int
 glsl_type_size(const struct glsl_type *type, bool bindless)
 {
@@ -4823,6 +4867,7 @@ bi_compile_variant_nir(nir_shader *nir,
                        enum bi_idvs_mode idvs)
 {
         bi_context *ctx = rzalloc(NULL, bi_context);
+        int64_t phase_start = inputs->stats ? os_time_get_nano() : 0;
 
         /* There may be another program in the dynarray, start at the end */
         unsigned offset = binary->size;
@@ -4897,6 +4942,7 @@ bi_compile_variant_nir(nir_shader *nir,
         }
 
         bi_validate(ctx, "NIR -> BIR");
+        bi_end_phase(inputs, BIFROST_PHASE_EMIT, &phase_start);
 
         /* If the shader doesn't write any colour or depth outputs, it may
          * still need an ATEST at the very end! */
@@ -5002,16 +5048,21 @@ bi_compile_variant_nir(nir_shader *nir,
                 bi_opt_fuse_dual_texture(ctx);
         }
 
+        bi_end_phase(inputs, BIFROST_PHASE_OPT, &phase_start);
+
         if (likely(!(bifrost_debug & BIFROST_DBG_NOPSCHED)))
                 bi_pressure_schedule(ctx);
 
         bi_validate(ctx, "Late lowering");
+        bi_end_phase(inputs, BIFROST_PHASE_PSCHED, &phase_start);
 
         bi_register_allocate(ctx);
 
         if (likely(optimize))
                 bi_opt_post_ra(ctx);
 
+        bi_end_phase(inputs, BIFROST_PHASE_RA, &phase_start);
+
         if (bifrost_debug & BIFROST_DBG_SHADERS && !skip_internal)
                 bi_print_shader(ctx, stdout);
 
@@ -5026,6 +5077,8 @@ bi_compile_variant_nir(nir_shader *nir,
                 bi_analyze_helper_terminate(ctx);
         }
 
+        bi_end_phase(inputs, BIFROST_PHASE_SCHED, &phase_start);
+
         if (bifrost_debug & BIFROST_DBG_SHADERS && !skip_internal)
                 bi_print_shader(ctx, stdout);
 
@@ -5035,6 +5088,11 @@ bi_compile_variant_nir(nir_shader *nir,
                 bi_pack_valhall(ctx, binary);
         }
 
+        bi_end_phase(inputs, BIFROST_PHASE_PACK, &phase_start);
+
+        if (inputs->stats)
+                bi_record_stats(ctx, binary->size - offset, inputs->stats);
+
         if (bifrost_debug & BIFROST_DBG_SHADERS && !skip_internal) {
                 if (ctx->arch <= 8) {
                         disassemble_bifrost(stdout, binary->data + offset,
@@ -5185,7 +5243,9 @@ bifrost_compile_shader_nir(nir_shader *nir,
 {
         bifrost_debug = debug_get_option_bifrost_debug();
 
+        int64_t start = inputs->stats ? os_time_get_nano() : 0;
         bi_finalize_nir(nir, inputs->gpu_id, inputs->is_blend);
+        bi_end_phase(inputs, BIFROST_PHASE_NIR, &start);
         struct hash_table_u64 *sysval_to_id =
                 panfrost_init_sysvals(&info->sysvals,
                                       inputs->fixed_sysval_layout,
@@ -24,8 +24,11 @@
  * SOFTWARE.
  */
 
+#include <dirent.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "disassemble.h"
 #include "valhall/disassemble.h"
 #include "compiler.h"
@@ -35,12 +38,29 @@
 #include "compiler/glsl/glsl_to_nir.h"
 #include "compiler/glsl/gl_nir.h"
 #include "compiler/nir_types.h"
+#include "c11/threads.h"
+#include "util/os_time.h"
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_dynarray.h"
 #include "bifrost_compile.h"
 
 unsigned gpu_id = 0x7212;
 int verbose = 0;
 
+static gl_shader_stage
+extension_to_stage(const char *ext)
+{
+        if (!strcmp(ext, ".cs") || !strcmp(ext, ".comp"))
+                return MESA_SHADER_COMPUTE;
+        else if (!strcmp(ext, ".vs") || !strcmp(ext, ".vert"))
+                return MESA_SHADER_VERTEX;
+        else if (!strcmp(ext, ".fs") || !strcmp(ext, ".frag"))
+                return MESA_SHADER_FRAGMENT;
+        else
+                return MESA_SHADER_NONE;
+}
+
 static gl_shader_stage
 filename_to_stage(const char *stage)
 {
@@ -51,18 +71,14 @@ filename_to_stage(const char *stage)
                 exit(1);
         }
 
-        if (!strcmp(ext, ".cs") || !strcmp(ext, ".comp"))
-                return MESA_SHADER_COMPUTE;
-        else if (!strcmp(ext, ".vs") || !strcmp(ext, ".vert"))
-                return MESA_SHADER_VERTEX;
-        else if (!strcmp(ext, ".fs") || !strcmp(ext, ".frag"))
-                return MESA_SHADER_FRAGMENT;
-        else {
+        gl_shader_stage s = extension_to_stage(ext);
+
+        if (s == MESA_SHADER_NONE) {
                 fprintf(stderr, "Invalid extension %s\n", ext);
                 exit(1);
         }
 
-        unreachable("Should've returned or bailed");
+        return s;
 }
 
 static int
@@ -114,6 +130,51 @@ fixup_varying_slots(nir_shader *nir, nir_variable_mode mode)
    }
 }
 
+/* Lower NIR straight out of glsl_to_nir() the way the GL driver would */
+static void
+lower_glsl_nir(nir_shader *nir, struct gl_shader_program *prog, bool first)
+{
+        if (nir->info.stage == MESA_SHADER_VERTEX) {
+                nir_assign_var_locations(nir, nir_var_shader_in, &nir->num_inputs,
+                                glsl_type_size);
+                sort_varyings(nir, nir_var_shader_out);
+                nir_assign_var_locations(nir, nir_var_shader_out, &nir->num_outputs,
+                                glsl_type_size);
+                fixup_varying_slots(nir, nir_var_shader_out);
+        } else if (nir->info.stage == MESA_SHADER_FRAGMENT) {
+                sort_varyings(nir, nir_var_shader_in);
+                nir_assign_var_locations(nir, nir_var_shader_in, &nir->num_inputs,
+                                glsl_type_size);
+                fixup_varying_slots(nir, nir_var_shader_in);
+                nir_assign_var_locations(nir, nir_var_shader_out, &nir->num_outputs,
+                                glsl_type_size);
+        }
+
+        nir_assign_var_locations(nir, nir_var_uniform, &nir->num_uniforms,
+                        glsl_type_size);
+
+        NIR_PASS_V(nir, nir_lower_global_vars_to_local);
+        NIR_PASS_V(nir, nir_lower_io_to_temporaries, nir_shader_get_entrypoint(nir), true, first);
+        NIR_PASS_V(nir, nir_opt_copy_prop_vars);
+        NIR_PASS_V(nir, nir_opt_combine_stores, nir_var_all);
+
+        NIR_PASS_V(nir, nir_lower_system_values);
+        NIR_PASS_V(nir, gl_nir_lower_samplers, prog);
+        NIR_PASS_V(nir, nir_split_var_copies);
+        NIR_PASS_V(nir, nir_lower_var_copies);
+
+        NIR_PASS_V(nir, nir_lower_io, nir_var_uniform,
+                        st_packed_uniforms_type_size,
+                        (nir_lower_io_options)0);
+        NIR_PASS_V(nir, nir_lower_uniforms_to_ubo, true, false);
+
+        /* before buffers and vars_to_ssa */
+        NIR_PASS_V(nir, gl_nir_lower_images, true);
+
+        NIR_PASS_V(nir, gl_nir_lower_buffers, prog);
+        NIR_PASS_V(nir, nir_opt_constant_folding);
+}
+
 static void
 compile_shader(int stages, char **files)
 {
@@ -150,46 +211,7 @@ compile_shader(int stages, char **files)
 
         for (unsigned i = 0; i < stages; ++i) {
                 nir[i] = glsl_to_nir(&local_ctx.Const, prog, shader_types[i], &bifrost_nir_options);
-
-                if (shader_types[i] == MESA_SHADER_VERTEX) {
-                        nir_assign_var_locations(nir[i], nir_var_shader_in, &nir[i]->num_inputs,
-                                        glsl_type_size);
-                        sort_varyings(nir[i], nir_var_shader_out);
-                        nir_assign_var_locations(nir[i], nir_var_shader_out, &nir[i]->num_outputs,
-                                        glsl_type_size);
-                        fixup_varying_slots(nir[i], nir_var_shader_out);
-                } else if (shader_types[i] == MESA_SHADER_FRAGMENT) {
-                      sort_varyings(nir[i], nir_var_shader_in);
-                      nir_assign_var_locations(nir[i], nir_var_shader_in, &nir[i]->num_inputs,
-                                      glsl_type_size);
-                      fixup_varying_slots(nir[i], nir_var_shader_in);
-                      nir_assign_var_locations(nir[i], nir_var_shader_out, &nir[i]->num_outputs,
-                                      glsl_type_size);
-                }
-
-                nir_assign_var_locations(nir[i], nir_var_uniform, &nir[i]->num_uniforms,
-                                glsl_type_size);
-
-                NIR_PASS_V(nir[i], nir_lower_global_vars_to_local);
-                NIR_PASS_V(nir[i], nir_lower_io_to_temporaries, nir_shader_get_entrypoint(nir[i]), true, i == 0);
-                NIR_PASS_V(nir[i], nir_opt_copy_prop_vars);
-                NIR_PASS_V(nir[i], nir_opt_combine_stores, nir_var_all);
-
-                NIR_PASS_V(nir[i], nir_lower_system_values);
-                NIR_PASS_V(nir[i], gl_nir_lower_samplers, prog);
-                NIR_PASS_V(nir[i], nir_split_var_copies);
-                NIR_PASS_V(nir[i], nir_lower_var_copies);
-
-                NIR_PASS_V(nir[i], nir_lower_io, nir_var_uniform,
-                                st_packed_uniforms_type_size,
-                                (nir_lower_io_options)0);
-                NIR_PASS_V(nir[i], nir_lower_uniforms_to_ubo, true, false);
-
-                /* before buffers and vars_to_ssa */
-                NIR_PASS_V(nir[i], gl_nir_lower_images, true);
-
-                NIR_PASS_V(nir[i], gl_nir_lower_buffers, prog);
-                NIR_PASS_V(nir[i], nir_opt_constant_folding);
+                lower_glsl_nir(nir[i], prog, i == 0);
 
                 struct panfrost_compile_inputs inputs = {
                         .gpu_id = gpu_id,
@@ -212,6 +234,261 @@ compile_shader(int stages, char **files)
         util_dynarray_fini(&binary);
 }
 
+/* Batch mode: walk the given files and directories for GLSL shaders, compile
+ * each one on its own for the selected GPU, and print what the backend
+ * reported through panfrost_compile_inputs::stats instead of writing out
+ * binaries. Tuple and clause counts only exist on Bifrost proper; Valhall
+ * reports instructions alone.
+ */
+
+struct batch_shader {
+        char *filename;
+        gl_shader_stage stage;
+        bool compiled;
+
+        uint64_t frontend_time;
+        struct bifrost_shader_stats stats;
+};
+
+struct batch {
+        struct util_dynarray shaders;
+        unsigned next;
+};
+
+/* Everything up to glsl_to_nir() goes through the static gl_context in
+ * batch_compile() and the standalone compiler's own globals, so it's
+ * serialized; only the Bifrost backend itself runs in parallel.
+ */
+static mtx_t glsl_lock = _MTX_INITIALIZER_NP;
+
+static const char *phase_names[BIFROST_PHASE_COUNT] = {
+        [BIFROST_PHASE_NIR]     = "nir",
+        [BIFROST_PHASE_EMIT]    = "nir->bir",
+        [BIFROST_PHASE_OPT]     = "opt",
+        [BIFROST_PHASE_PSCHED]  = "psched",
+        [BIFROST_PHASE_RA]      = "ra",
+        [BIFROST_PHASE_SCHED]   = "sched",
+        [BIFROST_PHASE_PACK]    = "pack",
+};
+
+static void
+batch_compile(struct batch_shader *s)
+{
+        static struct gl_context local_ctx;
+        struct standalone_options options = {
+                .glsl_version = 300, /* ES - needed for precision */
+                .do_link = true,
+                .lower_precision = true
+        };
+
+        int64_t start = os_time_get_nano();
+
+        mtx_lock(&glsl_lock);
+
+        struct gl_shader_program *prog =
+                standalone_compile_shader(&options, 1, &s->filename, &local_ctx);
+
+        if (!prog || !prog->_LinkedShaders[s->stage]) {
+                mtx_unlock(&glsl_lock);
+                return;
+        }
+
+        prog->_LinkedShaders[s->stage]->Program->info.stage = s->stage;
+
+        nir_shader *nir = glsl_to_nir(&local_ctx.Const, prog, s->stage, &bifrost_nir_options);
+        lower_glsl_nir(nir, prog, true);
+
+        mtx_unlock(&glsl_lock);
+
+        s->frontend_time = os_time_get_nano() - start;
+
+        struct panfrost_compile_inputs inputs = {
+                .gpu_id = gpu_id,
+                .fixed_sysval_ubo = -1,
+                .stats = &s->stats,
+        };
+        struct pan_shader_info info = { 0 };
+        struct util_dynarray binary;
+
+        util_dynarray_init(&binary, NULL);
+        bifrost_compile_shader_nir(nir, &inputs, &binary, &info);
+        util_dynarray_fini(&binary);
+
+        ralloc_free(nir);
+        s->compiled = true;
+}
+
+static int
+batch_worker(void *data)
+{
+        struct batch *batch = data;
+        unsigned count = util_dynarray_num_elements(&batch->shaders, struct batch_shader);
+        unsigned i;
+
+        while ((i = p_atomic_inc_return(&batch->next) - 1) < count)
+                batch_compile(util_dynarray_element(&batch->shaders, struct batch_shader, i));
+
+        return 0;
+}
+
+static void
+batch_add(struct batch *batch, const char *path, bool explicit)
+{
+        struct stat st;
+
+        if (stat(path, &st) != 0) {
+                fprintf(stderr, "Couldn't stat %s\n", path);
+                return;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+                DIR *dir = opendir(path);
+                if (!dir)
+                        return;
+
+                struct dirent *entry;
+                while ((entry = readdir(dir)) != NULL) {
+                        if (entry->d_name[0] == '.')
+                                continue;
+
+                        char *child = NULL;
+                        asprintf(&child, "%s/%s", path, entry->d_name);
+                        assert(child != NULL);
+                        batch_add(batch, child, false);
+                        free(child);
+                }
+
+                closedir(dir);
+                return;
+        }
+
+        const char *ext = strrchr(path, '.');
+        gl_shader_stage stage = ext ? extension_to_stage(ext) : MESA_SHADER_NONE;
+
+        /* Silently skip unrelated files found while walking directories */
+        if (stage == MESA_SHADER_NONE) {
+                if (explicit)
+                        fprintf(stderr, "Skipping %s: unknown extension\n", path);
+                return;
+        }
+
+        struct batch_shader s = {
+                .filename = strdup(path),
+                .stage = stage,
+        };
+
+        util_dynarray_append(&batch->shaders, struct batch_shader, s);
+}
+
+static void
+batch_print(struct batch *batch)
+{
+        struct bifrost_shader_stats total = { 0 };
+        uint64_t total_frontend = 0;
+        unsigned count = 0, failed = 0;
+
+        util_dynarray_foreach(&batch->shaders, struct batch_shader, s) {
+                const struct bifrost_shader_stats *st = &s->stats;
+                count++;
+
+                if (!s->compiled) {
+                        printf("%s: FAIL\n", s->filename);
+                        failed++;
+                        continue;
+                }
+
+                /* With BIFROST_MESA_DEBUG=nopsched nothing measures it */
+                char pressure[16] = "n/a";
+                if (st->pressure_scheduled)
+                        snprintf(pressure, sizeof(pressure), "%u", st->max_pressure);
+
+                printf("%s - %s shader: %u inst, %u tuples, %u clauses, "
+                       "%u quadwords, %s pressure, %u regs, %u loops, "
+                       "%u:%u spills:fills\n",
+                       s->filename, gl_shader_stage_name(s->stage),
+                       st->nr_ins, st->nr_tuples, st->nr_clauses,
+                       st->size / 16, pressure, st->work_reg_count,
+                       st->loops, st->spills, st->fills);
+
+                printf("%s - time: frontend %.3fms", s->filename,
+                       s->frontend_time / 1000000.0);
+
+                for (unsigned p = 0; p < BIFROST_PHASE_COUNT; ++p) {
+                        printf(", %s %.3fms", phase_names[p],
+                               st->phase_time[p] / 1000000.0);
+                        total.phase_time[p] += st->phase_time[p];
+                }
+
+                printf("\n");
+
+                total.nr_ins += st->nr_ins;
+                total.nr_tuples += st->nr_tuples;
+                total.nr_clauses += st->nr_clauses;
+                total.size += st->size;
+                total.spills += st->spills;
+                total.fills += st->fills;
+                total_frontend += s->frontend_time;
+        }
+
+        printf("\ntotal: %u shaders, %u failed\n", count, failed);
+        printf("total: %u inst, %u tuples, %u clauses, %u quadwords, "
+               "%u:%u spills:fills\n",
+               total.nr_ins, total.nr_tuples, total.nr_clauses,
+               total.size / 16, total.spills, total.fills);
+        printf("total time: frontend %.3fms", total_frontend / 1000000.0);
+
+        for (unsigned p = 0; p < BIFROST_PHASE_COUNT; ++p)
+                printf(", %s %.3fms", phase_names[p], total.phase_time[p] / 1000000.0);
+
+        printf("\n");
+}
+
+static int
+run_batch(int count, char **paths, unsigned num_threads)
+{
+        struct batch batch = { 0 };
+        util_dynarray_init(&batch.shaders, NULL);
+
+        for (int i = 0; i < count; ++i)
+                batch_add(&batch, paths[i], true);
+
+        unsigned nr_shaders =
+                util_dynarray_num_elements(&batch.shaders, struct batch_shader);
+
+        if (nr_shaders == 0) {
+                fprintf(stderr, "No shaders found\n");
+                return 1;
+        }
+
+        if (num_threads == 0)
+                num_threads = util_get_cpu_caps()->nr_cpus;
+        num_threads = CLAMP(num_threads, 1, nr_shaders);
+
+        thrd_t *threads = calloc(num_threads, sizeof(thrd_t));
+        unsigned started = 0;
+
+        for (unsigned i = 1; i < num_threads; ++i) {
+                if (thrd_create(&threads[started], batch_worker, &batch) != thrd_success)
+                        break;
+
+                started++;
+        }
+
+        batch_worker(&batch);
+
+        for (unsigned i = 0; i < started; ++i)
+                thrd_join(threads[i], NULL);
+
+        batch_print(&batch);
+
+        util_dynarray_foreach(&batch.shaders, struct batch_shader, s)
+                free(s->filename);
+
+        util_dynarray_fini(&batch.shaders);
+        free(threads);
+        return 0;
+}
+
 #define BI_FOURCC(ch0, ch1, ch2, ch3) ( \
   (uint32_t)(ch0)        | (uint32_t)(ch1) << 8 | \
   (uint32_t)(ch2) << 16  | (uint32_t)(ch3) << 24)
@@ -271,6 +548,7 @@ main(int argc, char **argv)
                 { "id", optional_argument, NULL, 'i' },
                 { "gpu", optional_argument, NULL, 'g' },
                 { "verbose", no_argument, &verbose, 'v' },
+                { "threads", required_argument, NULL, 'j' },
                 { NULL, 0, NULL, 0 }
         };
 
@@ -292,9 +570,19 @@ main(int argc, char **argv)
                 { "G78AE", 9, 5 },
         };
 
-        while ((c = getopt_long(argc, argv, "v:", longopts, NULL)) != -1) {
+        unsigned num_threads = 0;
+
+        while ((c = getopt_long(argc, argv, "v:j:", longopts, NULL)) != -1) {
 
                 switch (c) {
+                case 'j':
+                        if (atoi(optarg) < 1) {
+                                fprintf(stderr, "Expected thread count, got %s\n", optarg);
+                                return 1;
+                        }
+
+                        num_threads = atoi(optarg);
+                        break;
                 case 'i':
                         gpu_id = atoi(optarg);
 
@@ -335,8 +623,10 @@ main(int argc, char **argv)
                 compile_shader(argc - optind - 1, &argv[optind + 1]);
         else if (strcmp(argv[optind], "disasm") == 0)
                 disassemble(argv[optind + 1]);
+        else if (strcmp(argv[optind], "batch") == 0)
+                return run_batch(argc - optind - 1, &argv[optind + 1], num_threads);
         else {
-                fprintf(stderr, "Unknown command. Valid: compile/disasm\n");
+                fprintf(stderr, "Unknown command. Valid: compile/disasm/batch\n");
                 return 1;
         }
 
@@ -777,6 +777,7 @@ typedef struct {
        unsigned loop_count;
        unsigned spills;
        unsigned fills;
+       unsigned max_pressure;
 } bi_context;
 
 static inline void
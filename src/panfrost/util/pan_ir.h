@@ -175,6 +175,8 @@ pan_lookup_sysval(struct hash_table_u64 *sysval_to_id,
 int
 panfrost_sysval_for_instr(nir_instr *instr, nir_dest *dest);
 
+struct bifrost_shader_stats;
+
 struct panfrost_compile_inputs {
         unsigned gpu_id;
         bool is_blend, is_blit;
@@ -189,6 +191,11 @@ struct panfrost_compile_inputs {
         bool no_idvs;
         bool no_ubo_to_push;
 
+        /* If set, the Bifrost compiler accumulates statistics about the
+         * compiled shader here, for offline tools.
+         */
+        struct bifrost_shader_stats *stats;
+
         enum pipe_format rt_formats[8];
         uint8_t raw_fmt_mask;
         unsigned nr_cbufs;
@@ -258,6 +265,38 @@ struct bifrost_shader_info {
         struct bifrost_message_preload messages[2];
 };
 
+/* Compilation phases timed in struct bifrost_shader_stats */
+enum bifrost_compile_phase {
+        BIFROST_PHASE_NIR,      /* NIR finalization */
+        BIFROST_PHASE_EMIT,     /* NIR -> BIR */
+        BIFROST_PHASE_OPT,      /* BIR optimization and lowering */
+        BIFROST_PHASE_PSCHED,   /* Pre-RA pressure scheduling */
+        BIFROST_PHASE_RA,
+        BIFROST_PHASE_SCHED,    /* Clause scheduling, Bifrost only */
+        BIFROST_PHASE_PACK,
+        BIFROST_PHASE_COUNT
+};
+
+/*
+ * Statistics for offline tools. With IDVS, counts are summed over the position
+ * and varying shaders, and register usage is the maximum of the two.
+ */
+struct bifrost_shader_stats {
+        unsigned nr_ins, nr_tuples, nr_clauses;
+        unsigned size;
+
+        /* Peak register pressure estimated by the pre-RA scheduler, relative
+         * to the values live out of each block. Only meaningful when
+         * pressure_scheduled is set, the scheduler is what measures it.
+         */
+        unsigned max_pressure;
+        bool pressure_scheduled;
+        unsigned work_reg_count;
+        unsigned loops, spills, fills;
+
+        uint64_t phase_time[BIFROST_PHASE_COUNT];
+};
+
 struct midgard_shader_info {
         unsigned first_tag;
 };
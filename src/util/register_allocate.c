@@ -487,27 +487,89 @@ ra_get_adjacency_bit_index(unsigned n1, unsigned n2)
    return ra_get_num_adjacency_bits(k1) + k2;
 }
 
+/* Above this many nodes the triangular adjacency bitset (4MB at this size)
+ * costs more to allocate and clear than the interference checks it speeds up,
+ * so we switch to a hash set of the edges instead.
+ */
+#define RA_DENSE_ADJACENCY_MAX_NODES 8192
+
+static uint64_t
+ra_get_adjacency_key(unsigned n1, unsigned n2)
+{
+   assert(n1 != n2);
+   return ((uint64_t)MAX2(n1, n2) << 32) | MIN2(n1, n2);
+}
+
 static bool
-ra_test_adjacency_bit(struct ra_graph *g, unsigned n1, unsigned n2)
+ra_test_adjacency(struct ra_graph *g, unsigned n1, unsigned n2)
 {
+   if (g->adjacency_set) {
+      return _mesa_hash_table_u64_search(g->adjacency_set,
+                                         ra_get_adjacency_key(n1, n2)) != NULL;
+   }
+
    uint64_t index = ra_get_adjacency_bit_index(n1, n2);
    return BITSET_TEST(g->adjacency, index);
 }
 
 static void
-ra_set_adjacency_bit(struct ra_graph *g, unsigned n1, unsigned n2)
+ra_set_adjacency(struct ra_graph *g, unsigned n1, unsigned n2)
 {
-   unsigned index = ra_get_adjacency_bit_index(n1, n2);
+   if (g->adjacency_set) {
+      _mesa_hash_table_u64_insert(g->adjacency_set,
+                                  ra_get_adjacency_key(n1, n2), g);
+      return;
+   }
+
+   uint64_t index = ra_get_adjacency_bit_index(n1, n2);
    BITSET_SET(g->adjacency, index);
 }
 
 static void
-ra_clear_adjacency_bit(struct ra_graph *g, unsigned n1, unsigned n2)
+ra_clear_adjacency(struct ra_graph *g, unsigned n1, unsigned n2)
 {
-   unsigned index = ra_get_adjacency_bit_index(n1, n2);
+   if (g->adjacency_set) {
+      _mesa_hash_table_u64_remove(g->adjacency_set,
+                                  ra_get_adjacency_key(n1, n2));
+      return;
+   }
+
+   uint64_t index = ra_get_adjacency_bit_index(n1, n2);
    BITSET_CLEAR(g->adjacency, index);
 }
 
+static void
+ra_graph_destructor(void *data)
+{
+   struct ra_graph *g = data;
+   _mesa_hash_table_u64_destroy(g->adjacency_set);
+}
+
+/**
+ * Moves the interferences of the first g->alloc nodes from the adjacency
+ * bitset into adjacency_set.  The adjacency lists hold every edge twice, so
+ * only the half where the neighbor has the lower index is inserted.
+ */
+static void
+ra_make_adjacency_sparse(struct ra_graph *g)
+{
+   /* The set isn't ralloc'ed, since its backing table would be freed before
+    * the graph's destructor gets to run.
+    */
+   g->adjacency_set = _mesa_hash_table_u64_create(NULL);
+   ralloc_set_destructor(g, ra_graph_destructor);
+
+   for (unsigned n = 0; n < g->alloc; n++) {
+      util_dynarray_foreach(&g->nodes[n].adjacency_list, unsigned int, n2p) {
+         if (*n2p < n)
+            ra_set_adjacency(g, n, *n2p);
+      }
+   }
+
+   ralloc_free(g->adjacency);
+   g->adjacency = NULL;
+}
+
 static void
 ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
@@ -524,7 +586,7 @@ static void
 ra_node_remove_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
    assert(n1 != n2);
-   ra_clear_adjacency_bit(g, n1, n2);
+   ra_clear_adjacency(g, n1, n2);
 
    int n1_class = g->nodes[n1].class;
    int n2_class = g->nodes[n2].class;
@@ -546,9 +608,14 @@ ra_realloc_interference_graph(struct ra_graph *g, unsigned int alloc)
    assert(g->alloc % BITSET_WORDBITS == 0);
    alloc = align64(alloc, BITSET_WORDBITS);
    g->nodes = rerzalloc(g, g->nodes, struct ra_node, g->alloc, alloc);
-   g->adjacency = rerzalloc(g, g->adjacency, BITSET_WORD,
-                            BITSET_WORDS(ra_get_num_adjacency_bits(g->alloc)),
-                            BITSET_WORDS(ra_get_num_adjacency_bits(alloc)));
+
+   if (alloc > RA_DENSE_ADJACENCY_MAX_NODES && !g->adjacency_set) {
+      ra_make_adjacency_sparse(g);
+   } else if (!g->adjacency_set) {
+      g->adjacency = rerzalloc(g, g->adjacency, BITSET_WORD,
+                               BITSET_WORDS(ra_get_num_adjacency_bits(g->alloc)),
+                               BITSET_WORDS(ra_get_num_adjacency_bits(alloc)));
+   }
 
    /* Initialize new nodes. */
    for (unsigned i = g->alloc; i < alloc; i++) {
@@ -636,8 +703,8 @@ ra_add_node_interference(struct ra_graph *g,
                          unsigned int n1, unsigned int n2)
 {
    assert(n1 < g->count && n2 < g->count);
-   if (n1 != n2 && !ra_test_adjacency_bit(g, n1, n2)) {
-      ra_set_adjacency_bit(g, n1, n2);
+   if (n1 != n2 && !ra_test_adjacency(g, n1, n2)) {
+      ra_set_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n2, n1);
    }
@@ -846,6 +913,12 @@ ra_find_conflicting_neighbor(struct ra_graph *g, unsigned int n, unsigned int r)
    return NULL;
 }
 
+/* Nodes with more neighbors than this are colored from the bitset computed by
+ * ra_compute_available_regs() rather than by searching for a conflicting
+ * neighbor for each candidate register.
+ */
+#define RA_SELECT_MAX_NEIGHBOR_WALK 64
+
 /* Computes a bitfield of what regs are available for a given register
  * selection.
  *
@@ -899,10 +972,8 @@ static bool
 ra_select(struct ra_graph *g)
 {
    int start_search_reg = 0;
-   BITSET_WORD *select_regs = NULL;
-
-   if (g->select_reg_callback)
-      select_regs = malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
+   BITSET_WORD *select_regs =
+      malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
 
    while (g->tmp.stack_count != 0) {
       unsigned int ri;
@@ -923,6 +994,23 @@ ra_select(struct ra_graph *g)
 
          r = g->select_reg_callback(n, select_regs, g->select_reg_callback_data);
          assert(r < g->regs->count);
+      } else if (util_dynarray_num_elements(&g->nodes[n].adjacency_list,
+                                            unsigned int) > RA_SELECT_MAX_NEIGHBOR_WALK) {
+         /* With this many neighbors, walking the adjacency list for every
+          * candidate reg is quadratic, so gather the free regs in one walk
+          * instead and pick the first one at or after start_search_reg.
+          */
+         ra_compute_available_regs(g, n, select_regs);
+         for (ri = 0; ri < g->regs->count; ri++) {
+            r = (start_search_reg + ri) % g->regs->count;
+            if (BITSET_TEST(select_regs, r))
+               break;
+         }
+
+         if (ri >= g->regs->count) {
+            free(select_regs);
+            return false;
+         }
       } else {
          /* Find the lowest-numbered reg which is not used by a member
           * of the graph adjacent to us.
@@ -949,8 +1037,10 @@ ra_select(struct ra_graph *g)
             }
          }
 
-         if (ri >= g->regs->count)
+         if (ri >= g->regs->count) {
+            free(select_regs);
             return false;
+         }
       }
 
       g->nodes[n].reg = r;
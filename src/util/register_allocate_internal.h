@@ -30,6 +30,7 @@
 
 #include <stdbool.h>
 #include "util/bitset.h"
+#include "util/hash_table.h"
 #include "util/u_dynarray.h"
 
 #ifdef __cplusplus
@@ -130,7 +131,16 @@ struct ra_graph {
     * the variables that need register allocation.
     */
    struct ra_node *nodes;
+
+   /**
+    * Triangular bitset of which pairs of nodes interfere, used to reject
+    * duplicate interferences.  Its size is quadratic in the number of nodes,
+    * so once the graph grows past RA_DENSE_ADJACENCY_MAX_NODES it is replaced
+    * by adjacency_set, which only stores the edges that exist.
+    */
    BITSET_WORD *adjacency;
+   struct hash_table_u64 *adjacency_set;
+
    unsigned int count; /**< count of nodes. */
 
    unsigned int alloc; /**< count of nodes allocated. */
@@ -279,3 +279,99 @@ TEST_F(ra_test, serialization_roundtrip)
    blob_finish(&blob);
 }
 
+
+/* Builds an interval graph of "count" live ranges, each interfering with the
+ * ranges that start in the following "width" slots, with a deterministic mix
+ * of single and double register nodes.
+ */
+static struct ra_graph *
+build_interval_graph(struct ra_regs *regs, unsigned count, unsigned width,
+                     unsigned extra_nodes)
+{
+   struct ra_class *c1 = ra_get_class_from_index(regs, 0);
+   struct ra_class *c2 = ra_get_class_from_index(regs, 1);
+
+   struct ra_graph *g = ra_alloc_interference_graph(regs, count);
+   for (unsigned i = 0; i < count; i++)
+      ra_set_node_class(g, i, (i * 7) % 5 == 0 ? c2 : c1);
+
+   for (unsigned i = 0; i < count; i++) {
+      unsigned len = 1 + (i * 13) % width;
+      for (unsigned j = i + 1; j < MIN2(count, i + len); j++) {
+         ra_add_node_interference(g, i, j);
+         /* Duplicates must not be counted twice. */
+         ra_add_node_interference(g, j, i);
+      }
+   }
+
+   /* Isolated nodes are pushed first and popped last, so they don't affect
+    * the registers chosen for the rest of the graph, but they do move the
+    * graph past the size where the sparse adjacency representation is used.
+    */
+   for (unsigned i = 0; i < extra_nodes; i++)
+      ra_add_node(g, c1);
+
+   return g;
+}
+
+static void
+check_allocation(struct ra_regs *regs, struct ra_graph *g, unsigned count,
+                 unsigned width)
+{
+   for (unsigned i = 0; i < count; i++) {
+      unsigned len = 1 + (i * 13) % width;
+      for (unsigned j = i + 1; j < MIN2(count, i + len); j++) {
+         ASSERT_FALSE(ra_class_allocations_conflict(ra_get_node_class(g, i),
+                                                    ra_get_node_reg(g, i),
+                                                    ra_get_node_class(g, j),
+                                                    ra_get_node_reg(g, j)));
+      }
+   }
+}
+
+TEST_F(ra_test, sparse_adjacency)
+{
+   const unsigned count = 2000, width = 48;
+
+   struct ra_regs *regs = ra_alloc_reg_set(mem_ctx, 128, false);
+   struct ra_class *c1 = ra_alloc_contig_reg_class(regs, 1);
+   struct ra_class *c2 = ra_alloc_contig_reg_class(regs, 2);
+   for (unsigned i = 0; i < 128; i++) {
+      ra_class_add_reg(c1, i);
+      if (i % 2 == 0 && i + 1 < 128)
+         ra_class_add_reg(c2, i);
+   }
+   ra_set_finalize(regs, NULL);
+
+   struct ra_graph *dense = build_interval_graph(regs, count, width, 0);
+   struct ra_graph *sparse = build_interval_graph(regs, count, width, 20000);
+   ASSERT_NE(dense->adjacency, nullptr);
+   ASSERT_EQ(sparse->adjacency, nullptr);
+   ASSERT_NE(sparse->adjacency_set, nullptr);
+
+   for (unsigned i = 0; i < count; i++)
+      ASSERT_EQ(dense->nodes[i].q_total, sparse->nodes[i].q_total);
+
+   ASSERT_TRUE(ra_allocate(dense));
+   ASSERT_TRUE(ra_allocate(sparse));
+   check_allocation(regs, sparse, count, width);
+   for (unsigned i = 0; i < count; i++)
+      ASSERT_EQ(ra_get_node_reg(dense, i), ra_get_node_reg(sparse, i));
+
+   /* Resetting a node must drop its edges from the sparse set as well, so
+    * that they can be added back.
+    */
+   unsigned q_total = sparse->nodes[101].q_total;
+   ra_reset_node_interference(sparse, 100);
+   ASSERT_LT(sparse->nodes[101].q_total, q_total);
+   for (unsigned j = 101; j < 100 + 1 + (100 * 13) % width; j++)
+      ra_add_node_interference(sparse, 100, j);
+   for (unsigned j = 0; j < 100; j++) {
+      if (j + 1 + (j * 13) % width > 100)
+         ra_add_node_interference(sparse, j, 100);
+   }
+   ASSERT_EQ(sparse->nodes[101].q_total, q_total);
+
+   ralloc_free(dense);
+   ralloc_free(sparse);
+}